@@ -166,6 +166,9 @@ void Options::Validate()
 
     if (GetMountPath().empty())
         throw MissingOptionException("mountpath");
+
+    if (mConfigOptions.cacheType == ConfigOptions::CacheType::DISK && mCacheOptions.diskPath.empty())
+        throw MissingOptionException("disk-cache");
 }
 
 } // namespace AndromedaFuse
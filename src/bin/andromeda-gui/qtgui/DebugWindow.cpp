@@ -126,7 +126,9 @@ void DebugWindow::UpdateCacheStats()
     const CacheManager::Stats cacheStats { mCacheManager->GetStats() };
     QString cacheText; QTextStream(&cacheText)
         << "currentTotal: " << StringUtil::bytesToStringF(cacheStats.currentTotal).c_str() 
+            << " (" << StringUtil::bytesToStringF(cacheStats.memoryLimit).c_str() << " limit)"
             << " (" << cacheStats.totalPages << " pages)"
+            << " (" << StringUtil::bytesToStringF(cacheStats.tableMemory).c_str() << " tables)"
         << ", currentDirty: " << StringUtil::bytesToStringF(cacheStats.currentDirty).c_str() 
             << " (" << StringUtil::bytesToStringF(cacheStats.dirtyLimit).c_str() << " limit)"
             << " (" << cacheStats.dirtyPages << " pages)";
@@ -137,6 +139,8 @@ void DebugWindow::UpdateCacheStats()
         << "curAlloc: " << StringUtil::bytesToStringF(allocStats.curAlloc).c_str()
             << " (" << StringUtil::bytesToStringF(allocStats.maxAlloc).c_str() << " max)"
         << ", curFree: " << StringUtil::bytesToStringF(allocStats.curFree).c_str()
+            << " (" << StringUtil::bytesToStringF(allocStats.largestFree).c_str() << " largest)"
+            << " (" << allocStats.freeBlocks << " blocks)"
         << ", allocs: " << allocStats.allocs << ", recycles: " << allocStats.recycles;
     mQtUi->cacheAllocStats->setText(allocText);
 }
@@ -4,8 +4,12 @@
 #define EHOSTDOWN EIO
 #endif // WIN32
 
+#include <algorithm>
 #include <bitset>
+#include <fstream>
 #include <functional>
+#include <stdexcept>
+#include <string>
 
 #include "FuseAdapter.hpp"
 #include "FuseOperations.hpp"
@@ -56,6 +60,35 @@ inline File::ScopeLocked GetFileByPath(const std::string& path)
     return GetFuseAdapter().GetRootFolder()->GetFileByPath(path);
 }
 
+/*****************************************************/
+/** Returns the name of the process with the given ID, or empty if unknown */
+std::string GetProcessName(const pid_t pid)
+{
+#if LINUX
+    std::ifstream comm("/proc/"+std::to_string(pid)+"/comm");
+    std::string name; std::getline(comm, name);
+    return name;
+#else // !LINUX
+    return "";
+#endif // LINUX
+}
+
+/*****************************************************/
+/** 
+ * Assigns the given file's cache class from its path and the calling process, if there are any rules
+ * A file opened by several processes keeps the highest priority class (see CacheManager::MergeCacheClass)
+ */
+void SetCacheClass(File& file, const std::string& path)
+{
+    CacheManager* const cacheMgr { file.GetBackend().GetCacheManager() };
+    if (cacheMgr == nullptr || !cacheMgr->HasCacheRules()) return;
+
+    const fuse_context* fuse_context { fuse_get_context() };
+    const std::string process { cacheMgr->HasProcessRules() ? GetProcessName(fuse_context->pid) : "" };
+    const size_t cacheClass { cacheMgr->GetCacheClass(path, fuse_context->uid, process) };
+    file.SetCacheClass(cacheMgr->MergeCacheClass(file.GetCacheClass(), cacheClass));
+}
+
 /*****************************************************/
 inline Folder::ScopeLocked GetFolderByPath(const std::string& path)
 {
@@ -159,11 +192,19 @@ void* FuseOperations::init(struct fuse_conn_info* conn, struct fuse_config* cfg)
     SDBG_INFO("... conn->caps: " << std::bitset<32>(conn->capable));
     SDBG_INFO("... conn->want: " << std::bitset<32>(conn->want));
 
+    FuseAdapter& adapter { GetFuseAdapter() };
+
 #if !LIBFUSE2
     conn->want &= ~static_cast<decltype(conn->want)>(FUSE_CAP_HANDLE_KILLPRIV); // don't support setuid and setgid flags
-#endif // !LIBFUSE2
 
-    FuseAdapter& adapter { GetFuseAdapter() };
+    // libfuse's high-level API free()s any buffer returned from read_buf() so we can't hand it
+    // our pages directly - instead make each request (path lookup, file lock, memcpy) cover more
+    // max_write also sets the max pages per request for reads - libfuse/kernel cap it as needed
+    // (buffered reads are also limited by the kernel's readahead, see read_ahead_kb in sysfs)
+    // libfuse starts it at UINT_MAX and caps it to its buffer size after init, so smaller values are honored
+    conn->max_write = adapter.GetOptions().maxRequestSize;
+    SDBG_INFO("... max_write:" << conn->max_write);
+#endif // !LIBFUSE2
 
     adapter.SignalInit();
     return static_cast<void*>(&adapter);
@@ -294,7 +335,11 @@ int FuseOperations::open(const char* const path, struct fuse_file_info* const fi
     return CatchAsErrno(__func__,[&]()->int
     {
         File::ScopeLocked file { GetFileByPath(path) };
+        file->InformOpen(); // before locking, may prefetch siblings
+        if (fi->flags & O_TRUNC) file->CancelFetches(); // NOLINT(hicpp-signed-bitwise)
+
         const SharedLockW fileLock { file->GetWriteLock() };
+        SetCacheClass(*file, path);
 
         // TODO need to handle O_APPEND?
 
@@ -425,10 +470,17 @@ int FuseOperations::create(const char* fullpath, mode_t mode, struct fuse_file_i
 
     return CatchAsErrno(__func__,[&]()->int
     {
-        Folder::ScopeLocked parent { GetFolderByPath(path) };
-        const SharedLockW parentLock { parent->GetWriteLock() };
+        { // lock scope
+            Folder::ScopeLocked parent { GetFolderByPath(path) };
+            const SharedLockW parentLock { parent->GetWriteLock() };
+            parent->CreateFile(name, parentLock);
+        }
 
-        parent->CreateFile(name, parentLock); return FUSE_SUCCESS;
+        const CacheManager* const cacheMgr { GetFuseAdapter().GetRootFolder()->GetBackend().GetCacheManager() };
+        if (cacheMgr != nullptr && cacheMgr->HasCacheRules()) // not opened after create
+            SetCacheClass(*GetFileByPath(fullpath), fullpath);
+
+        return FUSE_SUCCESS;
     }, fullpath);
 }
 
@@ -586,9 +638,11 @@ int FuseOperations::flush(const char* const path, struct fuse_file_info* const f
     return CatchAsErrno(__func__,[&]()->int
     {
         File::ScopeLocked file { GetFileByPath(path) };
-        const SharedLockW fileLock { file->GetWriteLock() };
+        { const SharedLockW fileLock { file->GetWriteLock() };
+            file->FlushCache(fileLock); }
 
-        file->FlushCache(fileLock); return FUSE_SUCCESS;
+        // close() must see write-back errors, wait without blocking other users of the file
+        file->WaitFlush(); return FUSE_SUCCESS;
     }, path);
 }
 
@@ -601,9 +655,11 @@ int FuseOperations::fsync(const char* const path, int datasync, struct fuse_file
     return CatchAsErrno(__func__,[&]()->int
     {
         File::ScopeLocked file { GetFileByPath(path) };
-        const SharedLockW fileLock { file->GetWriteLock() };
+        { const SharedLockW fileLock { file->GetWriteLock() };
+            file->FlushCache(fileLock); }
 
-        file->FlushCache(fileLock); return FUSE_SUCCESS;
+        // wait for the write-back without blocking other users of the file
+        file->WaitFlush(); return FUSE_SUCCESS;
     }, path);
 }
 
@@ -634,6 +690,8 @@ int FuseOperations::release(const char* const path, struct fuse_file_info* const
     return CatchAsErrno(__func__,[&]()->int
     {
         File::ScopeLocked file { GetFileByPath(path) };
+        // don't wait on read-ahead nobody is left to use (other handles just fetch again)
+        file->CancelFetches();
         const SharedLockW fileLock { file->GetWriteLock() };
 
         file->FlushCache(fileLock); return FUSE_SUCCESS;
@@ -655,6 +713,7 @@ int FuseOperations::truncate(const char* const path, off_t size, struct fuse_fil
     return CatchAsErrno(__func__,[&]()->int
     {
         File::ScopeLocked file { GetFileByPath(path) };
+        file->CancelFetches(static_cast<uint64_t>(size)); // before waiting on them
         const SharedLockW fileLock { file->GetWriteLock() };
 
         file->Truncate(static_cast<uint64_t>(size), fileLock); return FUSE_SUCCESS;
@@ -701,4 +760,68 @@ int FuseOperations::chown(const char* const path, uid_t uid, gid_t gid, struct f
     }, path);
 }
 
+/*****************************************************/
+#ifdef APPLE
+int FuseOperations::setxattr(const char* const path, const char* const name, const char* const value, size_t size, int flags, uint32_t position)
+#else
+int FuseOperations::setxattr(const char* const path, const char* const name, const char* const value, size_t size, int flags)
+#endif // APPLE
+{
+    if (path == nullptr || name == nullptr || value == nullptr) return -EINVAL;
+
+    // the only attributes are cache hints for applications, e.g. setfattr -n user.andromeda.willneed -v 0:64M
+    const std::string prefix { "user.andromeda." };
+    if (!StringUtil::startsWith(name, prefix)) return -ENOTSUP;
+    const std::string hint { std::string(name).substr(prefix.size()) };
+    const std::string hintValue { StringUtil::trim(std::string(value, size)) };
+
+    SDBG_INFO("(path:" << path << ", hint:" << hint << ", value:" << hintValue << ")");
+
+    if (hint == "advice") // how the file will be read from now on
+    {
+        File::Advice advice { File::Advice::NORMAL };
+        if (hintValue == "sequential") advice = File::Advice::SEQUENTIAL;
+        else if (hintValue == "random") advice = File::Advice::RANDOM;
+        else if (hintValue == "nocache") advice = File::Advice::NOCACHE;
+        else if (hintValue != "normal") return -EINVAL;
+
+        return CatchAsErrno(__func__,[&]()->int
+        {
+            File::ScopeLocked file { GetFileByPath(path) };
+            const SharedLockR fileLock { file->GetReadLock() };
+
+            file->SetAdvice(advice, fileLock); return FUSE_SUCCESS;
+        }, path);
+    }
+    else if (hint == "willneed" || hint == "dontneed")
+    {
+        // value is offset:length, each with an optional unit - an empty length is up to the end
+        uint64_t offset { 0 }; uint64_t length { 0 };
+        try
+        {
+            const StringUtil::StringPair range { StringUtil::split(hintValue, ":") };
+            offset = StringUtil::stringToBytes(range.first);
+            length = StringUtil::stringToBytes(range.second);
+        }
+        catch (const std::logic_error& e) { return -EINVAL; }
+
+        return CatchAsErrno(__func__,[&]()->int
+        {
+            File::ScopeLocked file { GetFileByPath(path) };
+            if (hint == "willneed")
+            {
+                const SharedLockR fileLock { file->GetReadLock() };
+                file->Prefetch(offset, length, fileLock);
+            }
+            else
+            {
+                const SharedLockW fileLock { file->GetWriteLock() };
+                file->DropCache(offset, length, fileLock);
+            }
+            return FUSE_SUCCESS;
+        }, path);
+    }
+    else return -ENOTSUP;
+}
+
 } // namespace AndromedaFuse
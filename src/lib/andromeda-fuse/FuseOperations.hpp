@@ -24,6 +24,12 @@ struct FuseOperations
     static int fsyncdir(const char* path, int datasync, struct fuse_file_info* fi);
     static int release(const char* path, struct fuse_file_info* fi);
 
+    #ifdef APPLE
+    static int setxattr(const char* path, const char* name, const char* value, size_t size, int flags, uint32_t position);
+    #else // !APPLE
+    static int setxattr(const char* path, const char* name, const char* value, size_t size, int flags);
+    #endif // APPLE
+
     #if LIBFUSE2
     static void* init(struct fuse_conn_info* conn);
     static int getattr(const char* path, struct stat* stbuf);
@@ -70,6 +76,7 @@ struct a2fuse_operations : public fuse_operations
         fsyncdir = AndromedaFuse::FuseOperations::fsyncdir;
         init = AndromedaFuse::FuseOperations::init;
         create = AndromedaFuse::FuseOperations::create;
+        setxattr = AndromedaFuse::FuseOperations::setxattr;
     }
 };
 
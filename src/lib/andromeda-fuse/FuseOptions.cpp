@@ -1,5 +1,6 @@
 
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 #include "FuseOptions.hpp"
@@ -7,6 +8,8 @@
 
 #include "andromeda/BaseOptions.hpp"
 using Andromeda::BaseOptions;
+#include "andromeda/StringUtil.hpp"
+using Andromeda::StringUtil;
 
 namespace AndromedaFuse {
 
@@ -24,6 +27,7 @@ std::string FuseOptions::HelpText()
     #endif // !OPENBSD
     #if !LIBFUSE2
         << " [--fuse-max-idle-threads uint32(" << optDefault.maxIdleThreads << ")]"
+        << " [--fuse-max-request bytes32(" << StringUtil::bytesToString(optDefault.maxRequestSize) << ")]"
     #endif // !LIBFUSE2
         << " [-o fuseoption]+"; 
     
@@ -99,6 +103,17 @@ bool FuseOptions::AddOption(const std::string& option, const std::string& value)
         catch (const std::logic_error& e) { 
             throw BaseOptions::BadValueException(option); }
     }
+    else if (option == "fuse-max-request")
+    {
+        uint64_t bytes { 0 };
+        try { bytes = StringUtil::stringToBytes(value); }
+        catch (const std::logic_error& e) { 
+            throw BaseOptions::BadValueException(option); }
+
+        if (bytes < MIN_REQUEST_SIZE || bytes > std::numeric_limits<decltype(maxRequestSize)>::max())
+            throw BaseOptions::BadValueException(option);
+        maxRequestSize = static_cast<decltype(maxRequestSize)>(bytes);
+    }
 #endif // !LIBFUSE2
     else return false; // not used
 
@@ -53,6 +53,17 @@ struct FuseOptions
 #if !LIBFUSE2
     /** Maximum number of FUSE idle threads */
     uint32_t maxIdleThreads { 10 }; // FUSE's default
+
+    /** 
+     * Maximum size of a single FUSE read/write request (bytes)
+     * Each request does a path lookup and takes the file lock, so larger requests mean
+     * less overhead per byte for streaming I/O.  Smaller values are honored, larger
+     * ones are further limited by the kernel and libfuse (usually to 1M)
+     */
+    uint32_t maxRequestSize { 1024*1024 };
+
+    /** The minimum maxRequestSize (the kernel won't go below a page) */
+    static constexpr uint32_t MIN_REQUEST_SIZE { 4096 };
 #endif // !LIBFUSE2
 };
 
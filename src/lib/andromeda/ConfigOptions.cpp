@@ -18,9 +18,10 @@ std::string ConfigOptions::HelpText()
     const size_t stBits { sizeof(size_t)*8 };
 
     using std::endl; output 
-        << "Advanced:        [-q|--quiet] [-r|--read-only] [--dir-refresh secs(" << defRefresh << ")] [--cachemode none|memory|normal] [--backend-runners uint"<<stBits<<"(" << optDefault.runnerPoolSize << ")]" << endl
+        << "Advanced:        [-q|--quiet] [-r|--read-only] [--dir-refresh secs(" << defRefresh << ")] [--cachemode none|memory|normal|disk] [--backend-runners uint"<<stBits<<"(" << optDefault.runnerPoolSize << ")]" << endl
         << "Data Advanced:   [--pagesize bytes"<<stBits<<"(" << StringUtil::bytesToString(optDefault.pageSize) << ")] [--read-ahead ms(" << defReadAhead << ")]"
-            << " [--read-max-cache-frac uint32(" << optDefault.readMaxCacheFrac << ")] [--read-ahead-buffer pages(" << optDefault.readAheadBuffer << ")]";
+            << " [--read-max-cache-frac uint32(" << optDefault.readMaxCacheFrac << ")] [--read-ahead-buffer pages(" << optDefault.readAheadBuffer << ")]"
+            << " [--fetch-streams uint"<<stBits<<"(" << optDefault.fetchStreams << ")] [--prefetch-siblings files(" << optDefault.prefetchSiblings << ")]";
 
     return output.str();
 }
@@ -45,6 +46,7 @@ bool ConfigOptions::AddOption(const std::string& option, const std::string& valu
         if      (value == "none")   cacheType = ConfigOptions::CacheType::NONE;
         else if (value == "memory") cacheType = ConfigOptions::CacheType::MEMORY;
         else if (value == "normal") cacheType = ConfigOptions::CacheType::NORMAL;
+        else if (value == "disk")   cacheType = ConfigOptions::CacheType::DISK;
         else throw BaseOptions::BadValueException(option);
     }
     else if (option == "dir-refresh")
@@ -89,6 +91,20 @@ bool ConfigOptions::AddOption(const std::string& option, const std::string& valu
         catch (const std::logic_error& e) { 
             throw BaseOptions::BadValueException(option); }
     }
+    else if (option == "fetch-streams")
+    {
+        try { fetchStreams = static_cast<decltype(fetchStreams)>(stoul(value)); }
+        catch (const std::logic_error& e) { 
+            throw BaseOptions::BadValueException(option); }
+
+        if (!fetchStreams) throw BaseOptions::BadValueException(option);
+    }
+    else if (option == "prefetch-siblings")
+    {
+        try { prefetchSiblings = static_cast<decltype(prefetchSiblings)>(stoul(value)); }
+        catch (const std::logic_error& e) { 
+            throw BaseOptions::BadValueException(option); }
+    }
     else return false; // not used
 
     return true; 
@@ -33,7 +33,8 @@ struct ConfigOptions
     {
         /** read/write directly to server */  NONE,
         /** never contact server (testing) */ MEMORY,
-        /** normal read/write in pages */     NORMAL
+        /** normal read/write in pages */     NORMAL,
+        /** normal + local disk page cache */ DISK
     };
 
     /** The client cache type (debug) */
@@ -57,8 +58,9 @@ struct ConfigOptions
     size_t pageSize { 131072 }; // 128K
 
     /** 
-     * The target transfer time for each read-ahead page fetch 
-     * Uses bandwidth measuring to convert this time target to an actual page count
+     * The maximum transfer time for each read-ahead page fetch 
+     * Fetches are sized from the measured bandwidth and latency of the backend (a multiple of the
+     * bandwidth-delay product), this limits the size if the latency is high or unknown
      */
     std::chrono::milliseconds readAheadTime { 2000 };
 
@@ -77,7 +79,24 @@ struct ConfigOptions
      */
     size_t readAheadBuffer { 2 };
 
-    /** The maximum number of concurrent backend runners, never zero! */
+    /** 
+     * The maximum number of concurrent requests (each on its own runner) to split a large read-ahead into
+     * Helps fill high-latency links where one stream can't, the count used is sized by measured
+     * per-stream bandwidth and is also limited by runnerPoolSize. 1 disables splitting.
+     */
+    size_t fetchStreams { 1 };
+
+    /** 
+     * The number of following files in a folder to prefetch when files are being opened in order (e.g. cp -r)
+     * Each gets up to one read-ahead request worth (the whole file if small), all limited by readMaxCacheFrac.
+     * Turns scans of many small files from latency-bound to bandwidth-bound. 0 disables.
+     */
+    size_t prefetchSiblings { 4 };
+
+    /** 
+     * The maximum number of concurrent backend runners, never zero!
+     * If more than one, a quarter (at least one) are reserved for foreground requests (see RunnerPool)
+     */
     size_t runnerPoolSize { 1 }; // TODO server has threading issues
 };
 
@@ -0,0 +1,181 @@
+#ifndef LIBA2_RANGEMAP_H_
+#define LIBA2_RANGEMAP_H_
+
+#include <iterator>
+#include <map>
+#include <utility>
+
+namespace Andromeda {
+
+/** Placeholder value type for a RangeMap that is only used as a set (see RangeSet) */
+struct RangeMapNoValue
+{
+    bool operator==(const RangeMapNoValue&) const noexcept { return true; }
+};
+
+/**
+ * An ordered map of non-overlapping [start,end) key ranges to values
+ * Adjacent ranges with equal values are coalesced, so a large contiguous range
+ * is always a single entry no matter how it was inserted.  Lookups are O(log n)
+ * in the number of ranges, not the number of keys they cover.
+ * @tparam Key an unsigned integral type used for the range bounds
+ * @tparam Value the type mapped to by each range (must have operator==)
+ */
+template<typename Key, typename Value>
+class RangeMap
+{
+public:
+
+    /** A range's exclusive end key and its value (the start is the map key) */
+    struct Range
+    {
+        Key end;
+        Value value;
+    };
+
+    using RangeImpl = std::map<Key, Range>;
+    using const_iterator = typename RangeImpl::const_iterator;
+
+    /** Returns a const iterator pointing to the first range */
+    [[nodiscard]] inline const_iterator cbegin() const noexcept { return mRanges.cbegin(); }
+    /** Returns a const iterator pointing to the past-the-end range */
+    [[nodiscard]] inline const_iterator cend() const noexcept { return mRanges.cend(); }
+    /** Returns the number of ranges (NOT keys) in the map (O(1)) */
+    [[nodiscard]] inline size_t size() const noexcept { return mRanges.size(); }
+    /** Returns true iff the map is empty (O(1)) */
+    [[nodiscard]] inline bool empty() const noexcept { return mRanges.empty(); }
+    /** Empties the map */
+    inline void clear() noexcept { mRanges.clear(); }
+
+    /**
+     * Returns an iterator to the range containing the given key, or cend() if not found
+     * Complexity: O(log n)
+     */
+    [[nodiscard]] const_iterator find(const Key& key) const
+    {
+        const_iterator it { mRanges.upper_bound(key) };
+        if (it == mRanges.cbegin()) return mRanges.cend();
+        --it; return (key < it->second.end) ? it : mRanges.cend();
+    }
+
+    /** Returns true if the given key is within any range (O(log n)) */
+    [[nodiscard]] bool contains(const Key& key) const
+    {
+        return find(key) != mRanges.cend();
+    }
+
+    /**
+     * Returns an iterator to the first range that contains or starts after the given key
+     * @return cend() if there are no ranges at or after key
+     * Complexity: O(log n)
+     */
+    [[nodiscard]] const_iterator lower_bound(const Key& key) const
+    {
+        const const_iterator it { mRanges.upper_bound(key) };
+        if (it != mRanges.cbegin())
+        {
+            const const_iterator prev { std::prev(it) };
+            if (key < prev->second.end) return prev;
+        }
+        return it;
+    }
+
+    /**
+     * Returns an iterator to the first range that starts after the given key
+     * The range before it (if any) is the last one starting at or before key
+     * Complexity: O(log n)
+     */
+    [[nodiscard]] const_iterator upper_bound(const Key& key) const
+    {
+        return mRanges.upper_bound(key);
+    }
+
+    /**
+     * Sets the value for the range [start,start+count), overwriting any existing values
+     * Complexity: O(log n + number of ranges overwritten)
+     */
+    void insert(const Key& start, const Key& count, const Value& value = Value())
+    {
+        if (!count) return;
+        erase(start, count);
+
+        const Key end { start + count };
+        const typename RangeImpl::iterator it { mRanges.emplace(start, Range{end, value}).first };
+
+        const typename RangeImpl::iterator next { std::next(it) };
+        if (next != mRanges.end() && next->first == end && next->second.value == value)
+        {
+            it->second.end = next->second.end;
+            mRanges.erase(next);
+        }
+
+        if (it != mRanges.begin())
+        {
+            const typename RangeImpl::iterator prev { std::prev(it) };
+            if (prev->second.end == start && prev->second.value == value)
+            {
+                prev->second.end = it->second.end;
+                mRanges.erase(it);
+            }
+        }
+    }
+
+    /**
+     * Removes the range [start,start+count), splitting any partially covered ranges
+     * @return the number of keys (NOT ranges) that were removed
+     * Complexity: O(log n + number of ranges removed)
+     */
+    Key erase(const Key& start, const Key& count)
+    {
+        if (!count) return 0;
+        const Key end { start + count };
+        Key erased { 0 };
+
+        typename RangeImpl::iterator it { mRanges.lower_bound(start) };
+        if (it != mRanges.begin())
+        {
+            // previous range starts before start and might overlap
+            const typename RangeImpl::iterator prev { std::prev(it) };
+            if (prev->second.end > start)
+            {
+                if (prev->second.end > end) // split off the tail
+                {
+                    mRanges.emplace_hint(it, end, Range{prev->second.end, prev->second.value});
+                    prev->second.end = end;
+                }
+                erased += prev->second.end - start;
+                prev->second.end = start;
+            }
+        }
+
+        while (it != mRanges.end() && it->first < end)
+        {
+            if (it->second.end > end) // keep the tail, re-keyed at end
+            {
+                erased += end - it->first;
+                Range tail { std::move(it->second) };
+                it = mRanges.erase(it);
+                mRanges.emplace_hint(it, end, std::move(tail));
+                break; // ranges don't overlap
+            }
+
+            erased += it->second.end - it->first;
+            it = mRanges.erase(it);
+        }
+
+        return erased;
+    }
+
+private:
+
+    /** Map of range start key to range end/value */
+    RangeImpl mRanges;
+};
+
+/** A coalescing set of non-overlapping [start,end) key ranges (see RangeMap) */
+template<typename Key>
+using RangeSet = RangeMap<Key, RangeMapNoValue>;
+
+} // namespace Andromeda
+
+#endif // LIBA2_RANGEMAP_H_
@@ -0,0 +1,205 @@
+
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+
+namespace Andromeda {
+
+namespace { // anonymous
+/** The pool that owns the current thread, if it's a worker */
+thread_local const ThreadPool* tPool { nullptr };
+/** The worker index of the current thread, if it's a worker */
+thread_local size_t tWorkerIdx { 0 };
+} // namespace
+
+/*****************************************************/
+bool ThreadPool::Task::TryRun()
+{
+    { // lock scope
+        const std::lock_guard<std::mutex> lock(mMutex);
+        if (mState != State::QUEUED) return false;
+        mState = State::RUNNING;
+    }
+
+    mFunc(); // not locked!
+
+    { // lock scope
+        const std::lock_guard<std::mutex> lock(mMutex);
+        mState = State::DONE;
+        mFunc = nullptr; // release captures
+    }
+    mDoneCV.notify_all();
+    return true;
+}
+
+/*****************************************************/
+bool ThreadPool::Task::Cancel()
+{
+    { // lock scope
+        const std::lock_guard<std::mutex> lock(mMutex);
+        if (mState != State::QUEUED) return false;
+        mState = State::DONE;
+        mFunc = nullptr; // release captures
+    }
+    mDoneCV.notify_all();
+    return true;
+}
+
+/*****************************************************/
+void ThreadPool::Task::Wait()
+{
+    if (TryRun()) return; // was not started
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (mState != State::DONE)
+        mDoneCV.wait(lock);
+}
+
+/*****************************************************/
+bool ThreadPool::Task::isStarted() const
+{
+    const std::lock_guard<std::mutex> lock(mMutex);
+    return mState != State::QUEUED;
+}
+
+/*****************************************************/
+bool ThreadPool::Task::isDone() const
+{
+    const std::lock_guard<std::mutex> lock(mMutex);
+    return mState == State::DONE;
+}
+
+/*****************************************************/
+ThreadPool::ThreadPool(const size_t maxWorkers) :
+    mDebug(__func__,this)
+{
+    MDBG_INFO("(maxWorkers:" << maxWorkers << ")");
+
+    for (size_t idx { 0 }; idx < std::max(maxWorkers, static_cast<size_t>(1)); ++idx)
+        mWorkers.emplace_back(std::make_unique<Worker>());
+}
+
+/*****************************************************/
+ThreadPool::~ThreadPool()
+{
+    MDBG_INFO("()");
+
+    { // lock scope
+        const UniqueLock lock(mMutex);
+        mRunning.store(false);
+    }
+    mWorkCV.notify_all();
+
+    for (const std::unique_ptr<Worker>& worker : mWorkers)
+        if (worker->mThread.joinable())
+            worker->mThread.join();
+
+    // wake up anyone waiting on a task that will never run
+    for (const std::unique_ptr<Worker>& worker : mWorkers)
+        for (const TaskPtr& task : worker->mTasks)
+            task->Cancel();
+
+    MDBG_INFO("... return");
+}
+
+/*****************************************************/
+size_t ThreadPool::GetWorkerCount(const size_t runnerPoolSize)
+{
+    const size_t cpuCount { std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1)) };
+    return std::max(std::min(runnerPoolSize, cpuCount*2), MIN_WORKERS);
+}
+
+/*****************************************************/
+ThreadPool::TaskPtr ThreadPool::Submit(Task::Func func)
+{
+    TaskPtr task { std::make_shared<Task>(std::move(func)) };
+    ++mSubmits;
+
+    const UniqueLock lock(mMutex);
+    MaybeStartWorker(lock);
+
+    // tasks submitted from a worker go on its own queue (likely related to what it's doing)
+    const size_t workerIdx { (tPool == this) ? tWorkerIdx : (mNextWorker++ % mStarted.load()) };
+    MDBG_INFO("(workerIdx:" << workerIdx << ")");
+
+    Worker& worker { *mWorkers[workerIdx] };
+    { // lock scope
+        const UniqueLock wlock(worker.mMutex);
+        worker.mTasks.push_back(task);
+    }
+
+    ++mQueued;
+    mWorkCV.notify_one();
+    return task;
+}
+
+/*****************************************************/
+void ThreadPool::MaybeStartWorker(const UniqueLock& lock)
+{
+    const size_t started { mStarted.load() };
+    if (mIdle || started >= mWorkers.size()) return;
+
+    MDBG_INFO("... starting worker:" << started);
+    mWorkers[started]->mThread = std::thread(&ThreadPool::WorkerMain, this, started);
+    ++mStarted; // after the thread object is set
+}
+
+/*****************************************************/
+ThreadPool::TaskPtr ThreadPool::GetNextTask(const size_t workerIdx)
+{
+    { // own queue, oldest first
+        Worker& worker { *mWorkers[workerIdx] };
+        const UniqueLock wlock(worker.mMutex);
+        if (!worker.mTasks.empty())
+        {
+            TaskPtr task { std::move(worker.mTasks.front()) };
+            worker.mTasks.pop_front();
+            --mQueued; return task;
+        }
+    }
+
+    const size_t started { mStarted.load() };
+    for (size_t offset { 1 }; offset < started; ++offset)
+    {
+        // steal from others, newest first (least likely to be waited on soon)
+        Worker& victim { *mWorkers[(workerIdx+offset) % started] };
+        const UniqueLock wlock(victim.mMutex);
+        if (!victim.mTasks.empty())
+        {
+            TaskPtr task { std::move(victim.mTasks.back()) };
+            victim.mTasks.pop_back();
+            --mQueued; ++mSteals; return task;
+        }
+    }
+
+    return nullptr;
+}
+
+/*****************************************************/
+void ThreadPool::WorkerMain(const size_t workerIdx)
+{
+    MDBG_INFO("(workerIdx:" << workerIdx << ")");
+    tPool = this; tWorkerIdx = workerIdx;
+
+    while (true)
+    {
+        const TaskPtr task { GetNextTask(workerIdx) };
+        if (task != nullptr)
+        {
+            // might have been run inline or cancelled already
+            task->TryRun(); continue;
+        }
+
+        UniqueLock lock(mMutex);
+        ++mIdle;
+        while (mRunning.load() && !mQueued.load())
+            mWorkCV.wait(lock);
+        --mIdle;
+
+        if (!mRunning.load()) break;
+    }
+
+    MDBG_INFO("... exiting workerIdx:" << workerIdx);
+}
+
+} // namespace Andromeda
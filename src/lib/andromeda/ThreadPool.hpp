@@ -0,0 +1,172 @@
+
+#ifndef LIBA2_THREADPOOL_H_
+#define LIBA2_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "Debug.hpp"
+
+namespace Andromeda {
+
+/**
+ * A bounded work-stealing pool of worker threads for running background jobs
+ * Each worker has its own task queue - it runs its own tasks in order and
+ * steals other workers' newest tasks when it runs out of work.
+ * Workers are started on demand (up to the max) so an idle pool costs nothing.
+ * Submit() returns a Task handle that can be waited on, cancelled, or run inline
+ * by a thread that needs the result NOW (avoids deadlock if all workers are blocked)
+ * THREAD SAFE (INTERNAL LOCKS)
+ */
+class ThreadPool
+{
+public:
+
+    /** Handle to a submitted job, shared between the pool and the submitter */
+    class Task
+    {
+    public:
+        using Func = std::function<void()>;
+
+        explicit Task(Func&& func) : mFunc(std::move(func)) { }
+        DELETE_COPY(Task)
+        DELETE_MOVE(Task)
+
+        /**
+         * Runs the task on the calling thread if no worker has started it yet
+         * @return true if the task was run, false if it was already started/cancelled
+         */
+        bool TryRun();
+
+        /** Cancels the task if it has not started yet, returns true if cancelled */
+        bool Cancel();
+
+        /** Waits for the task to finish if it was started, else runs it on the calling thread */
+        void Wait();
+
+        /** Returns true if the task has been started (or cancelled) */
+        [[nodiscard]] bool isStarted() const;
+
+        /** Returns true if the task has finished running or was cancelled */
+        [[nodiscard]] bool isDone() const;
+
+    private:
+
+        enum class State : uint8_t { QUEUED, RUNNING, DONE };
+
+        /** The function to run (cleared once done) */
+        Func mFunc;
+        /** The current state of the task */
+        State mState { State::QUEUED };
+        /** Mutex protecting mState */
+        mutable std::mutex mMutex;
+        /** CV signaled when the task is done */
+        std::condition_variable mDoneCV;
+    };
+
+    using TaskPtr = std::shared_ptr<Task>;
+
+    /** @param maxWorkers the maximum number of worker threads (never zero) */
+    explicit ThreadPool(size_t maxWorkers);
+
+    /** Stops and joins all workers - tasks that have not started will never run! */
+    virtual ~ThreadPool();
+    DELETE_COPY(ThreadPool)
+    DELETE_MOVE(ThreadPool)
+
+    /**
+     * Returns the worker count to use for a backend given its runner pool size
+     * Each background I/O job that goes to the backend occupies a runner, so scale with the runners
+     * (limited to a multiple of the CPU count in case of a huge pool), but never go below MIN_WORKERS
+     * so that one slow job (e.g. a flush waiting on a runner) can't hold up all other files' jobs
+     * (disk cache reads, queued read-aheads, flushes that free memory)
+     */
+    static size_t GetWorkerCount(size_t runnerPoolSize);
+
+    /** The minimum worker count returned by GetWorkerCount() */
+    static constexpr size_t MIN_WORKERS { 4 };
+
+    /** Submits a function to be run on a worker thread and returns its handle */
+    TaskPtr Submit(Task::Func func);
+
+    /** Returns the maximum number of worker threads */
+    [[nodiscard]] size_t GetMaxWorkers() const { return mWorkers.size(); }
+
+    /** A copy of some member variables for debugging */
+    struct Stats
+    {
+        size_t started;
+        uint64_t submits;
+        uint64_t steals;
+    };
+    /** Returns a copy of some member variables for debugging */
+    inline Stats GetStats() const
+    {
+        return { mStarted.load(), mSubmits.load(), mSteals.load() };
+    }
+
+private:
+
+    using UniqueLock = std::unique_lock<std::mutex>;
+
+    /** A worker thread and its task deque */
+    struct Worker
+    {
+        /** The worker's thread (not joinable if not started) */
+        std::thread mThread;
+        /** Queue of tasks assigned to this worker */
+        std::deque<TaskPtr> mTasks;
+        /** Mutex protecting mTasks */
+        std::mutex mMutex;
+    };
+
+    /** The main loop for a worker thread */
+    void WorkerMain(size_t workerIdx);
+
+    /**
+     * Returns the next task for the given worker, own tasks first, then stealing
+     * @return nullptr if there are no tasks queued anywhere
+     */
+    TaskPtr GetNextTask(size_t workerIdx);
+
+    /** Starts a new worker thread if all are busy and not at the max */
+    void MaybeStartWorker(const UniqueLock& lock);
+
+    mutable Debug mDebug;
+
+    /** Array of workers (the max count, not all may be started) */
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    /** Mutex protecting worker startup and sleeping */
+    std::mutex mMutex;
+    /** CV for waking up sleeping workers */
+    std::condition_variable mWorkCV;
+
+    /** The number of workers that have been started */
+    std::atomic<size_t> mStarted { 0 };
+    /** The number of workers that are currently idle (under mMutex) */
+    size_t mIdle { 0 };
+    /** The number of tasks in worker queues (may include tasks run inline) */
+    std::atomic<size_t> mQueued { 0 };
+    /** The next worker to assign an external submit to (round-robin) */
+    std::atomic<size_t> mNextWorker { 0 };
+    /** Set to false to stop the workers */
+    std::atomic<bool> mRunning { true };
+
+    /** The total number of tasks submitted (debug) */
+    std::atomic<uint64_t> mSubmits { 0 };
+    /** The number of tasks run by a worker other than the one it was queued on (debug) */
+    std::atomic<uint64_t> mSteals { 0 };
+};
+
+} // namespace Andromeda
+
+#endif // LIBA2_THREADPOOL_H_
@@ -0,0 +1,119 @@
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "RangeMap.hpp"
+
+namespace Andromeda {
+namespace { // anonymous
+
+using TestS = RangeSet<uint64_t>;
+using TestM = RangeMap<uint64_t, std::string>;
+using Ranges = std::vector<std::pair<uint64_t, uint64_t>>; // start, end
+
+template<typename T>
+Ranges GetRanges(const T& rmap)
+{
+    Ranges ret;
+    for (typename T::const_iterator it { rmap.cbegin() }; it != rmap.cend(); ++it)
+        ret.emplace_back(it->first, it->second.end);
+    return ret;
+}
+
+/*****************************************************/
+TEST_CASE("TestBasic", "[RangeMap]")
+{
+    TestS testS;
+    REQUIRE(testS.empty());
+    REQUIRE(!testS.contains(0));
+    REQUIRE(testS.lower_bound(0) == testS.cend());
+
+    testS.insert(10, 5); // [10,15)
+    REQUIRE(testS.size() == 1);
+    REQUIRE(!testS.contains(9));
+    REQUIRE(testS.contains(10));
+    REQUIRE(testS.contains(14));
+    REQUIRE(!testS.contains(15));
+
+    REQUIRE(testS.lower_bound(0)->first == 10);
+    REQUIRE(testS.lower_bound(12)->first == 10);
+    REQUIRE(testS.lower_bound(15) == testS.cend());
+
+    testS.insert(20, 5); // [20,25)
+    REQUIRE(testS.lower_bound(15)->first == 20);
+    REQUIRE(testS.find(17) == testS.cend());
+    REQUIRE(testS.find(21)->first == 20);
+
+    testS.clear();
+    REQUIRE(testS.empty());
+}
+
+/*****************************************************/
+TEST_CASE("TestCoalesce", "[RangeMap]")
+{
+    TestS testS;
+    testS.insert(10, 5);
+    testS.insert(20, 5);
+    REQUIRE(GetRanges(testS) == Ranges{{10,15},{20,25}});
+
+    testS.insert(15, 5); // fills the gap
+    REQUIRE(GetRanges(testS) == Ranges{{10,25}});
+
+    testS.insert(5, 10); // overlaps the start
+    REQUIRE(GetRanges(testS) == Ranges{{5,25}});
+
+    testS.insert(0, 0); // no-op
+    REQUIRE(GetRanges(testS) == Ranges{{5,25}});
+
+    TestM testM;
+    testM.insert(0, 10, "a");
+    testM.insert(10, 10, "b"); // different value, not merged
+    testM.insert(20, 10, "b"); // same value, merged
+    REQUIRE(GetRanges(testM) == Ranges{{0,10},{10,30}});
+    REQUIRE(testM.find(25)->second.value == "b");
+
+    testM.insert(5, 10, "c"); // overwrite across both
+    REQUIRE(GetRanges(testM) == Ranges{{0,5},{5,15},{15,30}});
+    REQUIRE(testM.find(4)->second.value == "a");
+    REQUIRE(testM.find(5)->second.value == "c");
+    REQUIRE(testM.find(14)->second.value == "c");
+    REQUIRE(testM.find(15)->second.value == "b");
+}
+
+/*****************************************************/
+TEST_CASE("TestErase", "[RangeMap]")
+{
+    TestS testS;
+    testS.insert(10, 20); // [10,30)
+
+    REQUIRE(testS.erase(0, 5) == 0);
+    REQUIRE(testS.erase(10, 0) == 0);
+
+    REQUIRE(testS.erase(10, 1) == 1); // front
+    REQUIRE(GetRanges(testS) == Ranges{{11,30}});
+
+    REQUIRE(testS.erase(29, 5) == 1); // back
+    REQUIRE(GetRanges(testS) == Ranges{{11,29}});
+
+    REQUIRE(testS.erase(15, 5) == 5); // middle split
+    REQUIRE(GetRanges(testS) == Ranges{{11,15},{20,29}});
+
+    REQUIRE(testS.erase(12, 10) == 5); // across both
+    REQUIRE(GetRanges(testS) == Ranges{{11,12},{22,29}});
+
+    REQUIRE(testS.erase(0, 100) == 8); // everything
+    REQUIRE(testS.empty());
+
+    TestM testM;
+    testM.insert(0, 10, "a");
+    REQUIRE(testM.erase(3, 4) == 4); // split keeps the value
+    REQUIRE(GetRanges(testM) == Ranges{{0,3},{7,10}});
+    REQUIRE(testM.find(8)->second.value == "a");
+}
+
+} // namespace
+} // namespace Andromeda
@@ -0,0 +1,134 @@
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "ThreadPool.hpp"
+
+namespace Andromeda {
+namespace { // anonymous
+
+/*****************************************************/
+TEST_CASE("Basic", "[ThreadPool]")
+{
+    ThreadPool pool(4);
+    REQUIRE(pool.GetMaxWorkers() == 4);
+
+    std::atomic<size_t> count { 0 };
+    std::vector<ThreadPool::TaskPtr> tasks;
+    for (size_t i { 0 }; i < 100; ++i)
+        tasks.emplace_back(pool.Submit([&]{ ++count; }));
+
+    for (const ThreadPool::TaskPtr& task : tasks)
+    {
+        task->Wait();
+        REQUIRE(task->isStarted());
+        REQUIRE(task->isDone());
+    }
+
+    REQUIRE(count == 100);
+    REQUIRE(pool.GetStats().submits == 100);
+    REQUIRE(pool.GetStats().started >= 1);
+    REQUIRE(pool.GetStats().started <= 4);
+}
+
+/*****************************************************/
+TEST_CASE("RunInline", "[ThreadPool]")
+{
+    ThreadPool pool(1);
+
+    // block the only worker so the next task stays queued
+    std::promise<void> block; std::shared_future<void> blockFut { block.get_future() };
+    const ThreadPool::TaskPtr blocker { pool.Submit([blockFut]{ blockFut.wait(); }) };
+
+    bool ran { false };
+    const ThreadPool::TaskPtr task { pool.Submit([&]{ ran = true; }) };
+    REQUIRE(!task->isStarted());
+
+    REQUIRE(task->TryRun()); // runs on this thread
+    REQUIRE(ran);
+    REQUIRE(task->isDone());
+    REQUIRE(!task->TryRun()); // only once
+
+    block.set_value();
+    blocker->Wait();
+    REQUIRE(blocker->isDone());
+}
+
+/*****************************************************/
+TEST_CASE("Cancel", "[ThreadPool]")
+{
+    ThreadPool pool(1);
+
+    std::promise<void> block; std::shared_future<void> blockFut { block.get_future() };
+    const ThreadPool::TaskPtr blocker { pool.Submit([blockFut]{ blockFut.wait(); }) };
+
+    bool ran { false };
+    const ThreadPool::TaskPtr task { pool.Submit([&]{ ran = true; }) };
+    REQUIRE(task->Cancel());
+    REQUIRE(task->isDone());
+    REQUIRE(!task->Cancel());
+    REQUIRE(!task->TryRun());
+
+    block.set_value();
+    blocker->Wait();
+    task->Wait(); // no-op
+    REQUIRE(!ran);
+}
+
+/*****************************************************/
+TEST_CASE("Nested", "[ThreadPool]")
+{
+    ThreadPool pool(2);
+
+    // tasks submitted from a worker can be waited on by that worker
+    std::atomic<size_t> count { 0 };
+    std::vector<ThreadPool::TaskPtr> tasks;
+    for (size_t i { 0 }; i < 10; ++i)
+    {
+        tasks.emplace_back(pool.Submit([&]
+        {
+            const ThreadPool::TaskPtr inner { pool.Submit([&]{ ++count; }) };
+            inner->Wait(); ++count;
+        }));
+    }
+
+    for (const ThreadPool::TaskPtr& task : tasks)
+        task->Wait();
+    REQUIRE(count == 20);
+}
+
+/*****************************************************/
+TEST_CASE("WorkerCount", "[ThreadPool]")
+{
+    // a single backend runner doesn't mean a single worker
+    REQUIRE(ThreadPool::GetWorkerCount(1) == ThreadPool::MIN_WORKERS);
+
+    const size_t cpuCount { std::max(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1)) };
+    REQUIRE(ThreadPool::GetWorkerCount(1000) == std::max(cpuCount*2, ThreadPool::MIN_WORKERS));
+}
+
+/*****************************************************/
+TEST_CASE("Destruct", "[ThreadPool]")
+{
+    ThreadPool::TaskPtr task;
+    { // pool scope
+        ThreadPool pool(1);
+
+        std::promise<void> block; std::shared_future<void> blockFut { block.get_future() };
+        const ThreadPool::TaskPtr blocker { pool.Submit([blockFut]{ blockFut.wait(); }) };
+        task = pool.Submit([]{ });
+        block.set_value();
+    }
+
+    // the queued task either ran or was cancelled
+    REQUIRE(task->isDone());
+    task->Wait(); // no hang
+}
+
+} // namespace
+} // namespace Andromeda
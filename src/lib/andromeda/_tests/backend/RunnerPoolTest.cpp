@@ -0,0 +1,90 @@
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/ConfigOptions.hpp"
+#include "andromeda/backend/BaseRunner.hpp"
+#include "andromeda/backend/RunnerPool.hpp"
+
+namespace Andromeda {
+namespace Backend {
+namespace { // anonymous
+
+/** Runner that does nothing, for testing the pool */
+class FakeRunner : public BaseRunner
+{
+public:
+    [[nodiscard]] std::unique_ptr<BaseRunner> Clone() const override { return std::make_unique<FakeRunner>(); }
+    [[nodiscard]] std::string GetHostname() const override { return "fake"; }
+    std::string RunAction_Read(const RunnerInput& input) override { return ""; }
+    std::string RunAction_Write(const RunnerInput& input) override { return ""; }
+    std::string RunAction_FilesIn(const RunnerInput_FilesIn& input) override { return ""; }
+    std::string RunAction_StreamIn(const RunnerInput_StreamIn& input) override { return ""; }
+    void RunAction_StreamOut(const RunnerInput_StreamOut& input) override { }
+    [[nodiscard]] bool RequiresSession() const override { return false; }
+};
+
+/*****************************************************/
+TEST_CASE("PriorityScope", "[RunnerPool]")
+{
+    REQUIRE(RunnerPool::GetPriority() == RunnerPool::Priority::FOREGROUND);
+
+    { const RunnerPool::PriorityScope readAhead(RunnerPool::Priority::READAHEAD);
+        REQUIRE(RunnerPool::GetPriority() == RunnerPool::Priority::READAHEAD);
+
+        { const RunnerPool::PriorityScope writeBack(RunnerPool::Priority::WRITEBACK);
+            REQUIRE(RunnerPool::GetPriority() == RunnerPool::Priority::READAHEAD); } // never lowered
+
+        { const RunnerPool::PriorityScope foreground(RunnerPool::Priority::FOREGROUND);
+            REQUIRE(RunnerPool::GetPriority() == RunnerPool::Priority::FOREGROUND); }
+
+        REQUIRE(RunnerPool::GetPriority() == RunnerPool::Priority::READAHEAD);
+    }
+
+    REQUIRE(RunnerPool::GetPriority() == RunnerPool::Priority::FOREGROUND);
+}
+
+/*****************************************************/
+TEST_CASE("Reserved", "[RunnerPool]")
+{
+    FakeRunner runner;
+    ConfigOptions options;
+
+    options.runnerPoolSize = 1; // nothing to reserve
+    REQUIRE(RunnerPool(runner, options).GetReserved() == 0);
+
+    options.runnerPoolSize = 2;
+    RunnerPool pool(runner, options);
+    REQUIRE(pool.GetReserved() == 1);
+
+    std::atomic<bool> gotRunner { false };
+    std::thread background; { // lock scope
+        const RunnerPool::PriorityScope priority(RunnerPool::Priority::WRITEBACK);
+        const RunnerPool::LockedRunner runner1 { pool.GetRunner() };
+
+        background = std::thread([&]()
+        {
+            const RunnerPool::PriorityScope threadPriority(RunnerPool::Priority::READAHEAD);
+            const RunnerPool::LockedRunner runner2 { pool.GetRunner() };
+            gotRunner = true;
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE(!gotRunner); // the other runner is reserved
+
+        { const RunnerPool::PriorityScope foreground(RunnerPool::Priority::FOREGROUND);
+            const RunnerPool::LockedRunner runner3 { pool.GetRunner() }; } // doesn't block
+        REQUIRE(!gotRunner);
+    }
+
+    background.join(); // gets one once runner1 is released
+    REQUIRE(gotRunner);
+}
+
+} // namespace
+} // namespace Backend
+} // namespace Andromeda
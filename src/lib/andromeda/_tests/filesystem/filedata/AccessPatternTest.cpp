@@ -0,0 +1,139 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/filesystem/filedata/AccessPattern.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+using Pattern = AccessPattern::Pattern;
+
+/*****************************************************/
+TEST_CASE("Sequential", "[AccessPattern]")
+{
+    AccessPattern pattern;
+    REQUIRE(pattern.RecordAccess(10).pattern == Pattern::UNKNOWN);
+    REQUIRE(pattern.RecordAccess(10).pattern == Pattern::UNKNOWN); // same page
+    REQUIRE(pattern.RecordAccess(11).pattern == Pattern::UNKNOWN);
+    REQUIRE(pattern.RecordAccess(12).pattern == Pattern::SEQUENTIAL);
+    REQUIRE(pattern.RecordAccess(14).pattern == Pattern::SEQUENTIAL); // small skip
+
+    // window grows the longer the stream goes on
+    const AccessPattern::Access first { pattern.RecordAccess(15) };
+    for (uint64_t idx { 16 }; idx < 40; ++idx) pattern.RecordAccess(idx);
+    const AccessPattern::Access later { pattern.RecordAccess(40) };
+    REQUIRE(later.pattern == Pattern::SEQUENTIAL);
+    REQUIRE(AccessPattern::GetWindow(later, 10) > AccessPattern::GetWindow(first, 10));
+    REQUIRE(AccessPattern::GetWindow(later, 10) <= 40);
+}
+
+/*****************************************************/
+TEST_CASE("ReverseStrided", "[AccessPattern]")
+{
+    AccessPattern reverse;
+    reverse.RecordAccess(50); reverse.RecordAccess(49);
+    const AccessPattern::Access access { reverse.RecordAccess(48) };
+    REQUIRE(access.pattern == Pattern::REVERSE);
+    REQUIRE(access.stride == -1);
+
+    AccessPattern strided;
+    strided.RecordAccess(0); strided.RecordAccess(8); strided.RecordAccess(16);
+    const AccessPattern::Access access2 { strided.RecordAccess(24) };
+    REQUIRE(access2.pattern == Pattern::STRIDED);
+    REQUIRE(access2.stride == 8);
+    REQUIRE(AccessPattern::GetWindow(access2, 100) < 100); // limited
+}
+
+/*****************************************************/
+TEST_CASE("Interleaved", "[AccessPattern]")
+{
+    AccessPattern pattern;
+    // two sequential readers far apart in the same file
+    for (uint64_t idx { 0 }; idx < 3; ++idx)
+    {
+        pattern.RecordAccess(100+idx);
+        pattern.RecordAccess(5000+idx);
+    }
+    REQUIRE(pattern.RecordAccess(103).pattern == Pattern::SEQUENTIAL);
+    REQUIRE(pattern.RecordAccess(5003).pattern == Pattern::SEQUENTIAL);
+    REQUIRE(pattern.RecordAccess(104).pattern == Pattern::SEQUENTIAL);
+}
+
+/*****************************************************/
+TEST_CASE("Random", "[AccessPattern]")
+{
+    AccessPattern pattern;
+    const uint64_t indexes[] { 1000, 20, 7000, 300, 90000, 4000, 55555, 123 };
+    AccessPattern::Access access { };
+    for (const uint64_t idx : indexes) access = pattern.RecordAccess(idx);
+    REQUIRE(access.pattern == Pattern::RANDOM);
+    REQUIRE(AccessPattern::GetWindow(access, 10) == 1);
+
+    // a new stream is eventually trusted again
+    for (uint64_t idx { 200 }; idx < 210; ++idx) access = pattern.RecordAccess(idx);
+    REQUIRE(access.pattern == Pattern::SEQUENTIAL);
+}
+
+/*****************************************************/
+TEST_CASE("Override", "[AccessPattern]")
+{
+    AccessPattern pattern;
+    pattern.SetOverride(Pattern::SEQUENTIAL);
+    const AccessPattern::Access access { pattern.RecordAccess(500) };
+    REQUIRE(access.pattern == Pattern::SEQUENTIAL);
+    REQUIRE(AccessPattern::GetWindow(access, 10) > 10); // full window from the start
+
+    pattern.SetOverride(Pattern::RANDOM);
+    REQUIRE(pattern.RecordAccess(501).pattern == Pattern::RANDOM);
+    REQUIRE(pattern.RecordAccess(502).pattern == Pattern::RANDOM);
+
+    // the stream was still tracked underneath
+    pattern.SetOverride(Pattern::UNKNOWN);
+    REQUIRE(pattern.RecordAccess(503).pattern == Pattern::SEQUENTIAL);
+}
+
+/*****************************************************/
+TEST_CASE("ReadAheadStats", "[AccessPattern]")
+{
+    AccessPattern pattern;
+    pattern.AddReadAhead(10, 10); // 10-19
+    pattern.RecordAccess(10);
+    pattern.RecordAccess(11);
+    pattern.RecordAccess(30); // not read ahead
+    pattern.CancelReadAhead(18, 2); // failed fetch
+    pattern.RemovePages(12, 6); // evicted 12-17 unused
+    pattern.RemovePages(10, 2); // evicted after use
+
+    const AccessPattern::Stats stats { pattern.GetStats() };
+    REQUIRE(stats.accesses == 3);
+    REQUIRE(stats.readAheadPages == 8);
+    REQUIRE(stats.readAheadHits == 2);
+    REQUIRE(stats.readAheadWasted == 6);
+}
+
+/*****************************************************/
+TEST_CASE("RecentStream", "[AccessPattern]")
+{
+    AccessPattern pattern;
+    for (uint64_t idx { 100 }; idx < 104; ++idx) pattern.RecordAccess(idx);
+    pattern.AddReadAhead(106, 8);
+    REQUIRE(pattern.isReadAhead(110));
+    REQUIRE(!pattern.isReadAhead(104));
+
+    REQUIRE(pattern.HasRecentStream(106, 8, 4)); // heading there
+    REQUIRE(!pattern.HasRecentStream(106, 8, 2)); // too far ahead
+    REQUIRE(!pattern.HasRecentStream(5000, 8, 4));
+
+    // the reader seeks elsewhere, the old stream is eventually abandoned
+    for (uint64_t idx { 5000 }; idx < 5004; ++idx) pattern.RecordAccess(idx);
+    REQUIRE(pattern.HasRecentStream(106, 8, 4));
+    for (uint64_t idx { 5004 }; idx < 5010; ++idx) pattern.RecordAccess(idx);
+    REQUIRE(!pattern.HasRecentStream(106, 8, 4));
+    REQUIRE(pattern.HasRecentStream(5010, 8, 4));
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
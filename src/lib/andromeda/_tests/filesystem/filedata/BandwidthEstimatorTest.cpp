@@ -0,0 +1,78 @@
+
+#include <array>
+#include <chrono>
+#include <cmath>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/filesystem/filedata/BandwidthEstimator.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+constexpr size_t MiB { static_cast<size_t>(1024)*1024 };
+
+/** Returns true if value is within the given fraction of expect */
+bool isNear(const double value, const double expect, const double frac)
+{
+    return std::abs(value-expect) <= expect*frac;
+}
+
+/*****************************************************/
+TEST_CASE("Empty", "[BandwidthEstimator]")
+{
+    const BandwidthEstimator estimator("test");
+    REQUIRE(!estimator.HasSamples());
+    REQUIRE(estimator.GetTimeBytes(milliseconds(1000)) == 0);
+    REQUIRE(estimator.GetRequestBytes(milliseconds(1000)) == 0);
+}
+
+/*****************************************************/
+TEST_CASE("Throughput", "[BandwidthEstimator]")
+{
+    BandwidthEstimator estimator("test");
+    estimator.AddSample(0, milliseconds(100)); // ignored
+    REQUIRE(!estimator.HasSamples());
+
+    // the same size every time, can't tell latency from bandwidth
+    for (size_t i { 0 }; i < 8; ++i)
+        estimator.AddSample(4*MiB, milliseconds(400));
+
+    REQUIRE(estimator.HasSamples());
+    REQUIRE(estimator.GetLatency() == 0);
+    REQUIRE(isNear(estimator.GetBandwidth(), 10.0*MiB, 0.001));
+    REQUIRE(isNear(static_cast<double>(estimator.GetTimeBytes(milliseconds(2000))), 20*MiB, 0.001));
+    REQUIRE(isNear(static_cast<double>(estimator.GetRequestBytes(milliseconds(2000))), 20*MiB, 0.001));
+}
+
+/*****************************************************/
+TEST_CASE("Latency", "[BandwidthEstimator]")
+{
+    BandwidthEstimator estimator("test");
+
+    // 50ms latency then 10MiB/s
+    const std::array<size_t,4> sizes { MiB/8, MiB, 4*MiB, MiB/2 };
+    for (size_t i { 0 }; i < 40; ++i)
+    {
+        const size_t size { sizes[i%sizes.size()] };
+        estimator.AddSample(size, microseconds(50000 + size*100000/MiB));
+    }
+
+    REQUIRE(isNear(estimator.GetLatency(), 0.05, 0.05));
+    REQUIRE(isNear(estimator.GetBandwidth(), 10.0*MiB, 0.05));
+
+    // 4x the bandwidth-delay product of 0.5MiB, unless limited by time
+    REQUIRE(isNear(static_cast<double>(estimator.GetRequestBytes(milliseconds(2000))), 2*MiB, 0.1));
+    REQUIRE(isNear(static_cast<double>(estimator.GetRequestBytes(milliseconds(150))), MiB, 0.1));
+    REQUIRE(isNear(static_cast<double>(estimator.GetTimeBytes(milliseconds(1050))), 10*MiB, 0.1));
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,152 @@
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "testBackend.hpp"
+#include "andromeda/ConfigOptions.hpp"
+#include "andromeda/filesystem/File.hpp"
+#include "andromeda/filesystem/filedata/CacheManager.hpp"
+#include "andromeda/filesystem/filedata/CacheOptions.hpp"
+#include "andromeda/filesystem/filedata/PageManager.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+constexpr size_t TEST_PAGE_SIZE { 4096 };
+
+/** Returns options for a cache of the given number of pages */
+CacheOptions GetCacheOptions(const size_t pages)
+{
+    CacheOptions options;
+    options.memoryLimit = pages*TEST_PAGE_SIZE;
+    options.pressureSource = CacheOptions::PressureSource::NONE;
+    return options;
+}
+
+/** Returns options for a backend using TEST_PAGE_SIZE pages */
+ConfigOptions GetConfigOptions()
+{
+    ConfigOptions options;
+    options.pageSize = TEST_PAGE_SIZE;
+    return options;
+}
+
+/** Waits for the background evict thread to bring the cache under the given size */
+void WaitEvict(const CacheManager& cacheMgr, const size_t maxBytes)
+{
+    for (size_t tries { 0 }; tries < 500; ++tries)
+    {
+        const CacheManager::Stats stats { cacheMgr.GetStats() };
+        if (stats.currentTotal + stats.tableMemory <= maxBytes) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    FAIL("timed out waiting for evict");
+}
+
+/*****************************************************/
+TEST_CASE("CacheRules", "[CacheManager]")
+{
+    CacheOptions options { GetCacheOptions(16) };
+    options.cacheClasses = { {"default", 0, 0, 1}, {"indexer", 0, 0, 0}, {"editor", 0, 0, 2} };
+    options.cacheRules = { {CacheOptions::CacheRule::Type::PATH, "/index/", 1} };
+
+    { const CacheManager cacheMgr(options, false, nullptr);
+    REQUIRE(cacheMgr.HasCacheRules());
+    REQUIRE(!cacheMgr.HasProcessRules()); }
+
+    options.cacheRules.push_back({CacheOptions::CacheRule::Type::UID, "1000", 2});
+    options.cacheRules.push_back({CacheOptions::CacheRule::Type::PROCESS, "vim", 2});
+    const CacheManager cacheMgr(options, false, nullptr);
+    REQUIRE(cacheMgr.HasProcessRules());
+
+    REQUIRE(cacheMgr.GetCacheClass("/index/a", 1000, "vim") == 1); // first match wins
+    REQUIRE(cacheMgr.GetCacheClass("/docs/a", 1000, "") == 2);
+    REQUIRE(cacheMgr.GetCacheClass("/docs/a", 0, "vim") == 2);
+    REQUIRE(cacheMgr.GetCacheClass("/docs/a", 0, "") == 0);
+
+    // the higher priority class wins, a tie goes to the new open
+    REQUIRE(cacheMgr.MergeCacheClass(PageManager::NO_CACHE_CLASS, 1) == 1);
+    REQUIRE(cacheMgr.MergeCacheClass(2, 1) == 2);
+    REQUIRE(cacheMgr.MergeCacheClass(1, 2) == 2);
+    REQUIRE(cacheMgr.MergeCacheClass(0, 0) == 0);
+    REQUIRE(cacheMgr.MergeCacheClass(1, 5) == 1); // invalid class
+}
+
+/*****************************************************/
+TEST_CASE("CacheClassMax", "[CacheManager]")
+{
+    CacheOptions options { GetCacheOptions(64) };
+    options.cacheClasses = { {"default", 0, 0, 0}, {"stream", 0, 8*TEST_PAGE_SIZE, 0} };
+    CacheManager cacheMgr(options, true, nullptr);
+
+    TestBackend backend(GetConfigOptions());
+    backend.GetBackend().SetCacheManager(&cacheMgr);
+
+    const std::unique_ptr<File> file1 { backend.MakeFile("file1", 8*TEST_PAGE_SIZE) };
+    const std::unique_ptr<File> file2 { backend.MakeFile("file2", 32*TEST_PAGE_SIZE) };
+    file2->SetCacheClass(1);
+
+    REQUIRE(backend.ReadFile(*file1) > 0);
+    REQUIRE(backend.ReadFile(*file2) > 0);
+
+    // the stream class evicts its own pages while there is room for both
+    WaitEvict(cacheMgr, 16*TEST_PAGE_SIZE + cacheMgr.GetStats().tableMemory);
+    REQUIRE(backend.ReadFile(*file1) == 0);
+}
+
+/*****************************************************/
+TEST_CASE("CacheClassMin", "[CacheManager]")
+{
+    CacheOptions options { GetCacheOptions(64) };
+    options.cacheClasses = { {"default", 0, 0, 1}, {"editor", 16*TEST_PAGE_SIZE, 0, 0} };
+    CacheManager cacheMgr(options, true, nullptr);
+
+    TestBackend backend(GetConfigOptions());
+    backend.GetBackend().SetCacheManager(&cacheMgr);
+
+    const std::unique_ptr<File> file1 { backend.MakeFile("file1", 16*TEST_PAGE_SIZE) };
+    const std::unique_ptr<File> file2 { backend.MakeFile("file2", 128*TEST_PAGE_SIZE) };
+    file1->SetCacheClass(1);
+
+    REQUIRE(backend.ReadFile(*file1) > 0);
+    REQUIRE(backend.ReadFile(*file2) > 0);
+
+    // lowest priority, but not evicted below its minimum
+    WaitEvict(cacheMgr, cacheMgr.GetMemoryLimit());
+    REQUIRE(backend.ReadFile(*file1) == 0);
+}
+
+/*****************************************************/
+TEST_CASE("CacheClassPriority", "[CacheManager]")
+{
+    CacheOptions options { GetCacheOptions(64) };
+    options.cacheClasses = { {"default", 0, 0, 1}, {"batch", 0, 0, 0} };
+    CacheManager cacheMgr(options, true, nullptr);
+
+    TestBackend backend(GetConfigOptions());
+    backend.GetBackend().SetCacheManager(&cacheMgr);
+
+    const std::unique_ptr<File> file1 { backend.MakeFile("file1", 16*TEST_PAGE_SIZE) };
+    const std::unique_ptr<File> file2 { backend.MakeFile("file2", 40*TEST_PAGE_SIZE) };
+    const std::unique_ptr<File> file3 { backend.MakeFile("file3", 24*TEST_PAGE_SIZE) };
+    file2->SetCacheClass(1);
+
+    REQUIRE(backend.ReadFile(*file1) > 0);
+    REQUIRE(backend.ReadFile(*file2) > 0);
+    REQUIRE(backend.ReadFile(*file3) > 0);
+
+    // the batch class is evicted first though file1 was used least recently
+    WaitEvict(cacheMgr, cacheMgr.GetMemoryLimit());
+    REQUIRE(backend.ReadFile(*file1) == 0);
+    REQUIRE(backend.ReadFile(*file3) == 0);
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,122 @@
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/filesystem/filedata/CachingAllocator.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+/*****************************************************/
+TEST_CASE("Recycle", "[CachingAllocator]")
+{
+    CachingAllocator alloc(0);
+
+    void* const ptr1 { alloc.alloc(4) };
+    void* const ptr2 { alloc.alloc(4) };
+    REQUIRE(alloc.GetStats().curAlloc == 8*alloc.getPageSize());
+
+    alloc.free(ptr1, 4);
+    alloc.free(ptr2, 4);
+    REQUIRE(alloc.alloc(4) == ptr2); // most recent first
+    REQUIRE(alloc.alloc(4) == ptr1);
+
+    alloc.free(ptr1, 4);
+    alloc.free(ptr2, 4);
+}
+
+/*****************************************************/
+TEST_CASE("ThreadExit", "[CachingAllocator]")
+{
+    CachingAllocator alloc(0);
+    const size_t pageSize { alloc.getPageSize() };
+
+    std::vector<void*> ptrs;
+    for (size_t i { 0 }; i < 4; ++i) 
+        ptrs.push_back(alloc.alloc(2));
+
+    // frees on another thread go to its magazine, then the pool when it exits
+    std::thread thread([&]() { for (void* ptr : ptrs) alloc.free(ptr, 2); });
+    thread.join();
+    REQUIRE(alloc.GetStats().curAlloc == 0);
+    REQUIRE(alloc.GetStats().curFree == 8*pageSize);
+
+    // this thread refills from the pool
+    std::vector<void*> ptrs2;
+    for (size_t i { 0 }; i < 4; ++i) 
+        ptrs2.push_back(alloc.alloc(2));
+    REQUIRE(alloc.GetStats().curFree == 0);
+    REQUIRE(std::is_permutation(ptrs.begin(), ptrs.end(), ptrs2.begin()));
+
+    for (void* ptr : ptrs2) alloc.free(ptr, 2);
+}
+
+/*****************************************************/
+TEST_CASE("Concurrent", "[CachingAllocator]")
+{
+    CachingAllocator alloc(0);
+    const size_t pageSize { alloc.getPageSize() };
+
+    std::vector<std::thread> threads;
+    for (size_t thread { 0 }; thread < 4; ++thread)
+        threads.emplace_back([&alloc,pageSize,thread]()
+    {
+        const size_t pages { 1 + thread%2 };
+        std::vector<char*> ptrs;
+        for (size_t i { 0 }; i < 2000; ++i)
+        {
+            ptrs.push_back(static_cast<char*>(alloc.alloc(pages)));
+            std::memset(ptrs.back(), static_cast<int>(thread), pages*pageSize);
+            if (i % 3 == 0) // hold some, free some
+            {
+                alloc.free(ptrs.front(), pages);
+                ptrs.erase(ptrs.begin());
+            }
+        }
+        for (char* ptr : ptrs) alloc.free(ptr, pages);
+    });
+    for (std::thread& thread : threads) thread.join();
+
+    REQUIRE(alloc.GetStats().curAlloc == 0);
+}
+
+/*****************************************************/
+TEST_CASE("Coalesce", "[CachingAllocator]")
+{
+    CachingAllocator alloc(0);
+    const size_t pageSize { alloc.getPageSize() };
+
+    uint8_t* const ptr1 { static_cast<uint8_t*>(alloc.alloc(12)) };
+    uint8_t* const ptr2 { static_cast<uint8_t*>(alloc.alloc(4)) };
+
+    // free the pieces out of order on another thread, they go to the pool when it exits
+    std::thread thread([&]() { 
+        alloc.free(ptr1+8*pageSize, 4); alloc.free(ptr1, 4);
+        alloc.free(ptr2, 4); alloc.free(ptr1+4*pageSize, 4); });
+    thread.join();
+
+    // neighbors are merged, but never across separate allocations
+    CachingAllocator::Stats stats { alloc.GetStats() };
+    REQUIRE(stats.curFree == 16*pageSize);
+    REQUIRE(stats.largestFree == 12*pageSize);
+    REQUIRE(stats.freeBlocks == 2);
+
+    // the merged block can satisfy a larger alloc
+    REQUIRE(alloc.alloc(8) == ptr1);
+    stats = alloc.GetStats();
+    REQUIRE(stats.largestFree == 4*pageSize);
+    REQUIRE(stats.freeBlocks == 2);
+
+    alloc.free(ptr1, 8);
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
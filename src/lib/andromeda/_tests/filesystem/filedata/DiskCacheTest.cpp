@@ -0,0 +1,200 @@
+
+#include <atomic>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/TempPath.hpp"
+#include "andromeda/filesystem/filedata/DiskCache.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+using FileInfo = DiskCache::FileInfo;
+
+/** TempPath for a cache directory, removed recursively */
+class TempDir : public TempPath
+{
+public:
+    explicit TempDir(const std::string& suffix) : TempPath(suffix) { }
+    ~TempDir() override { std::filesystem::remove_all(Get()); }
+    DELETE_COPY(TempDir)
+    DELETE_MOVE(TempDir)
+};
+
+/*****************************************************/
+TEST_CASE("StoreRead", "[DiskCache]")
+{
+    const TempDir tmpdir("test_diskcache");
+    DiskCache cache(tmpdir.Get(), 1024);
+
+    const FileInfo info { 10, 1.5, 4 }; // pages 0-1 are 4, page 2 is 2
+    std::string buf(4, '\0');
+
+    REQUIRE(!cache.HasPage("id1", 0, info));
+    REQUIRE(!cache.ReadPage("id1", 0, info, buf.data(), 4));
+
+    cache.StorePage("id1", 1, info, "abcd", 4);
+    cache.StorePage("id1", 2, info, "ef", 2);
+    cache.StorePage("id1", 0, info, "xy", 2); // partial page ignored
+    REQUIRE(!cache.HasPage("id1", 0, info));
+    REQUIRE(cache.HasPage("id1", 1, info));
+
+    REQUIRE(cache.ReadPage("id1", 1, info, buf.data(), 4));
+    REQUIRE(buf == "abcd");
+    REQUIRE(cache.ReadPage("id1", 2, info, buf.data(), 2));
+    REQUIRE(buf.substr(0,2) == "ef");
+
+    cache.RemovePages("id1", 2, 5);
+    REQUIRE(!cache.HasPage("id1", 2, info));
+    REQUIRE(cache.HasPage("id1", 1, info));
+
+    const DiskCache::Stats stats { cache.GetStats() };
+    REQUIRE(stats.currentSize == 4);
+    REQUIRE(stats.pages == 1);
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.misses == 1);
+}
+
+/*****************************************************/
+TEST_CASE("Validate", "[DiskCache]")
+{
+    const TempDir tmpdir("test_diskcache");
+    DiskCache cache(tmpdir.Get(), 1024);
+
+    const FileInfo info { 8, 1.5, 4 };
+    cache.StorePage("id1", 0, info, "abcd", 4);
+    cache.StorePage("id2", 0, info, "efgh", 4);
+
+    cache.Validate("id1", info);
+    REQUIRE(cache.HasPage("id1", 0, info));
+
+    const FileInfo newInfo { 8, 2.5, 4 }; // modified on the backend
+    cache.Validate("id1", newInfo);
+    REQUIRE(!cache.HasPage("id1", 0, info));
+    REQUIRE(cache.HasPage("id2", 0, info));
+    REQUIRE(!cache.HasPage("id2", 0, newInfo)); // also drops it
+    REQUIRE(cache.GetStats().files == 0);
+}
+
+/*****************************************************/
+TEST_CASE("Evict", "[DiskCache]")
+{
+    const TempDir tmpdir("test_diskcache");
+    DiskCache cache(tmpdir.Get(), 12);
+
+    const FileInfo info { 100, 1.5, 4 };
+    std::string buf(4, '\0');
+    cache.StorePage("id1", 0, info, "aaaa", 4);
+    cache.StorePage("id1", 1, info, "bbbb", 4);
+    cache.StorePage("id2", 0, info, "cccc", 4);
+    REQUIRE(cache.ReadPage("id1", 0, info, buf.data(), 4)); // now most recent
+
+    cache.StorePage("id2", 1, info, "dddd", 4); // evicts id1 page 1
+    REQUIRE(cache.HasPage("id1", 0, info));
+    REQUIRE(!cache.HasPage("id1", 1, info));
+    REQUIRE(cache.HasPage("id2", 1, info));
+
+    const DiskCache::Stats stats { cache.GetStats() };
+    REQUIRE(stats.currentSize == 12);
+    REQUIRE(stats.evicts == 1);
+}
+
+/*****************************************************/
+TEST_CASE("Persist", "[DiskCache]")
+{
+    const TempDir tmpdir("test_diskcache");
+    const FileInfo info { 100, 1.5, 4 };
+    const std::string fileID { "dir/id\x01" }; // not a valid filename
+
+    {
+        DiskCache cache(tmpdir.Get(), 1024);
+        cache.StorePage(fileID, 3, info, "abcd", 4);
+        cache.StorePage(fileID, 5, info, "efgh", 4);
+    }
+
+    { // reload, with a smaller limit
+        DiskCache cache(tmpdir.Get(), 4);
+        REQUIRE(cache.GetStats().pages == 1);
+        REQUIRE(cache.GetStats().currentSize == 4);
+    }
+
+    DiskCache cache(tmpdir.Get(), 1024);
+    std::string buf(4, '\0');
+    const bool has3 { cache.ReadPage(fileID, 3, info, buf.data(), 4) };
+    REQUIRE((has3 ? (buf == "abcd") : cache.ReadPage(fileID, 5, info, buf.data(), 4)));
+    if (!has3) { REQUIRE(buf == "efgh"); }
+}
+
+/*****************************************************/
+TEST_CASE("Journal", "[DiskCache]")
+{
+    const TempDir tmpdir("test_diskcache");
+    const FileInfo info { 4096, 1.5, 4 };
+
+    { // enough add/remove churn to compact the index
+        DiskCache cache(tmpdir.Get(), 1024);
+        for (uint64_t round { 0 }; round < DiskCache::JOURNAL_BATCH; ++round)
+        {
+            for (uint64_t index { 0 }; index < 8; ++index)
+                cache.StorePage("id1", index, info, "abcd", 4);
+            cache.RemovePages("id1", 2, 4);
+        }
+        cache.RemovePages("id1", 7, 1); // not written until closed
+    }
+
+    DiskCache cache(tmpdir.Get(), 1024);
+    REQUIRE(cache.GetStats().pages == 3);
+    REQUIRE(cache.HasPage("id1", 0, info));
+    REQUIRE(cache.HasPage("id1", 6, info));
+    REQUIRE(!cache.HasPage("id1", 2, info));
+    REQUIRE(!cache.HasPage("id1", 7, info));
+
+    std::string buf(4, '\0');
+    REQUIRE(cache.ReadPage("id1", 1, info, buf.data(), 4));
+    REQUIRE(buf == "abcd");
+}
+
+/*****************************************************/
+TEST_CASE("Concurrent", "[DiskCache]")
+{
+    const TempDir tmpdir("test_diskcache");
+    DiskCache cache(tmpdir.Get(), 64*4); // constant eviction
+
+    const FileInfo info { 4096, 1.5, 4 };
+    std::atomic<bool> badData { false };
+
+    // each page holds its own index, a read must never return anything else
+    std::vector<std::thread> threads;
+    for (size_t thread { 0 }; thread < 4; ++thread)
+    {
+        threads.emplace_back([&, thread]()
+        {
+            std::string buf(4, '\0');
+            for (uint64_t iter { 0 }; iter < 2000; ++iter)
+            {
+                const uint64_t index { (iter*7 + thread*13) % 128 };
+                const std::string data(4, static_cast<char>(index));
+                const std::string fileID { (iter % 3) ? "id1" : "id2" };
+
+                if (iter % 5 == 0) cache.RemovePages(fileID, index, 1);
+                else if (iter % 2) cache.StorePage(fileID, index, info, data.data(), 4);
+                else if (cache.ReadPage(fileID, index, info, buf.data(), 4) && buf != data) badData = true;
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    REQUIRE(!badData);
+    REQUIRE(cache.GetStats().currentSize <= 64*4);
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,211 @@
+
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/filesystem/filedata/CachingAllocator.hpp"
+#include "andromeda/filesystem/filedata/EvictPolicy.hpp"
+#include "andromeda/filesystem/filedata/Page.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+/** Returns a key for the given file number and page index (no real PageManager) */
+PageKey GetKey(const uint64_t file, const uint64_t index)
+{
+    return PageKey{nullptr, (file << 32U) | index};
+}
+
+/** Returns true if the given key is in file 0 (the working set) */
+bool IsWorkingSet(const PageKey& key)
+{
+    return (key.index >> 32U) == 0;
+}
+
+/**
+ * Replays a trace of page accesses through a cache of the given number of (1-byte) pages
+ * @return the fraction of working set accesses (file 0) that were hits
+ */
+double RunTrace(EvictPolicy& policy, const std::vector<PageKey>& trace, const size_t capacity)
+{
+    CachingAllocator alloc(0);
+    std::unordered_map<PageKey, std::unique_ptr<Page>> pages;
+    std::unordered_map<const Page*, PageKey> keys;
+
+    size_t hits { 0 };
+    size_t accesses { 0 };
+    uint64_t epoch { 0 };
+    for (const PageKey& key : trace)
+    {
+        if (IsWorkingSet(key)) ++accesses;
+
+        const decltype(pages)::iterator pageIt { pages.find(key) };
+        if (pageIt != pages.end())
+        {
+            if (IsWorkingSet(key)) ++hits;
+            policy.AccessPage(*pageIt->second, 1, epoch);
+            continue;
+        }
+
+        const Page& page { *pages.emplace(key, std::make_unique<Page>(0, alloc)).first->second };
+        keys.emplace(&page, key);
+        policy.AddPage(page, key, 1, epoch++);
+
+        while (pages.size() > capacity)
+        {
+            const Page* const victim { policy.GetVictim() };
+            REQUIRE(victim != nullptr);
+            policy.RemovePage(*victim);
+            pages.erase(keys.at(victim));
+            keys.erase(victim);
+        }
+    }
+    return static_cast<double>(hits)/static_cast<double>(accesses);
+}
+
+/**
+ * Returns a trace of random accesses to a working set of hotPages (mostly) and warmPages,
+ * with a one-time sequential read of scanPages (each read readsPerPage times) every scanEvery accesses
+ */
+std::vector<PageKey> GetTrace(const size_t accesses, const uint64_t hotPages, const uint64_t warmPages,
+    const size_t scanEvery, const uint64_t scanPages, const size_t readsPerPage)
+{
+    std::mt19937_64 rng(1234); // NOLINT(cert-msc32-c,cert-msc51-cpp) deterministic
+    std::uniform_int_distribution<uint64_t> hotDist(0, hotPages-1);
+    std::uniform_int_distribution<uint64_t> warmDist(0, warmPages-1);
+    std::bernoulli_distribution isHot(0.9);
+
+    std::vector<PageKey> trace;
+    uint64_t scanFile { 1 };
+    for (size_t access { 0 }; access < accesses; ++access)
+    {
+        // file 0 is the working set (warm pages after the hot ones), 1.. are scans
+        trace.push_back(isHot(rng) ? GetKey(0, hotDist(rng)) : GetKey(0, hotPages+warmDist(rng)));
+
+        if (scanEvery && access % scanEvery == scanEvery-1)
+        {
+            for (uint64_t index { 0 }; index < scanPages; ++index)
+                for (size_t read { 0 }; read < readsPerPage; ++read)
+                    trace.push_back(GetKey(scanFile, index));
+            ++scanFile;
+        }
+    }
+    return trace;
+}
+
+/*****************************************************/
+TEST_CASE("Lru", "[EvictPolicy]")
+{
+    CachingAllocator alloc(0);
+    const Page page1(0, alloc), page2(0, alloc), page3(0, alloc);
+
+    LruEvictPolicy policy;
+    REQUIRE(policy.GetVictim() == nullptr);
+
+    policy.AddPage(page1, GetKey(0,1), 10, 0);
+    policy.AddPage(page2, GetKey(0,2), 10, 10);
+    policy.AddPage(page3, GetKey(0,3), 10, 20);
+    REQUIRE(policy.GetVictim() == &page1);
+
+    policy.AccessPage(page1, 10, 30);
+    REQUIRE(policy.GetVictims(15) == std::vector<const Page*>{&page2, &page3});
+    REQUIRE(policy.GetVictims(100) == std::vector<const Page*>{&page2, &page3, &page1});
+
+    policy.RemovePage(page2);
+    REQUIRE(policy.GetVictim() == &page3);
+
+    policy.DemotePage(page1);
+    REQUIRE(policy.GetVictims(100) == std::vector<const Page*>{&page1, &page3});
+}
+
+/*****************************************************/
+TEST_CASE("TwoQueue", "[EvictPolicy]")
+{
+    CachingAllocator alloc(0);
+    const Page page1(0, alloc), page2(0, alloc), page3(0, alloc), page4(0, alloc);
+
+    TwoQueueEvictPolicy policy(40); // in target 10, ghost target 20
+    policy.AddPage(page1, GetKey(0,1), 4, 0);
+    policy.AddPage(page2, GetKey(0,2), 4, 4);
+    policy.AccessPage(page1, 4, 8); // correlated, not promoted
+    REQUIRE(policy.GetVictim() == &page1);
+
+    policy.AddPage(page3, GetKey(0,3), 4, 8);
+    REQUIRE(policy.GetVictim() == &page1);
+
+    // evicted, then used again (same key, new Page object)
+    policy.RemovePage(page1);
+    policy.AddPage(page4, GetKey(0,1), 4, 12);
+    REQUIRE(policy.GetGhostHits() == 1);
+
+    // new pages are under their target, so the main queue is evicted first
+    REQUIRE(policy.GetVictims(12) == std::vector<const Page*>{&page4, &page2, &page3});
+
+    // new pages are over their target, so the oldest is evicted first
+    policy.AddPage(page1, GetKey(0,5), 4, 16);
+    REQUIRE(policy.GetVictims(12) == std::vector<const Page*>{&page2, &page4, &page3});
+
+    // used again after the correlated period, promoted
+    policy.AccessPage(page2, 4, 20);
+    REQUIRE(policy.GetVictims(100) == std::vector<const Page*>{&page4, &page2, &page3, &page1});
+
+    // demoted from A1in, evicted before the rest of Am
+    policy.DemotePage(page1);
+    REQUIRE(policy.GetVictims(100) == std::vector<const Page*>{&page1, &page4, &page2, &page3});
+
+    // removing every page leaves nothing to evict
+    policy.RemovePage(page2);
+    policy.RemovePage(page3);
+    policy.RemovePage(page1);
+    policy.RemovePage(page4);
+    REQUIRE(policy.GetVictim() == nullptr);
+}
+
+/*****************************************************/
+TEST_CASE("SetCapacity", "[EvictPolicy]")
+{
+    CachingAllocator alloc(0);
+    const Page page1(0, alloc), page2(0, alloc), page3(0, alloc);
+
+    TwoQueueEvictPolicy policy(40); // in target 10, ghost target 20
+    policy.AddPage(page3, GetKey(0,3), 4, 0);
+    policy.AccessPage(page3, 4, 100); // promoted
+    policy.AddPage(page1, GetKey(0,1), 4, 100);
+    policy.AddPage(page2, GetKey(0,2), 4, 104);
+    REQUIRE(policy.GetVictim() == &page3); // new pages are under their target
+
+    policy.SetCapacity(20); // in target 5, ghost target 10
+    REQUIRE(policy.GetVictim() == &page1); // new pages are now over their target
+
+    policy.RemovePage(page1);
+    policy.RemovePage(page2);
+    policy.SetCapacity(8); // ghost target 4, forgets the oldest ghost
+
+    policy.AddPage(page1, GetKey(0,1), 4, 108);
+    REQUIRE(policy.GetGhostHits() == 0);
+    policy.AddPage(page2, GetKey(0,2), 4, 112);
+    REQUIRE(policy.GetGhostHits() == 1);
+}
+
+/*****************************************************/
+TEST_CASE("ScanResistance", "[EvictPolicy]")
+{
+    // the working set fits, but scans larger than the cache come through regularly
+    const std::vector<PageKey> trace { GetTrace(20000, 100, 900, 2000, 1000, 4) };
+
+    LruEvictPolicy lru;
+    TwoQueueEvictPolicy twoq(400);
+    const double lruHits { RunTrace(lru, trace, 400) };
+    const double twoqHits { RunTrace(twoq, trace, 400) };
+    REQUIRE(twoqHits > lruHits);
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,89 @@
+
+#include <cstring>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/filesystem/filedata/MemoryAllocator.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+constexpr size_t ARENA_SIZE { MemoryAllocator::ARENA_SIZE };
+
+/*****************************************************/
+TEST_CASE("Basic", "[MemoryAllocator]")
+{
+    MemoryAllocator alloc;
+    REQUIRE(alloc.alloc(0) == nullptr);
+
+    char* const ptr { static_cast<char*>(alloc.alloc(3)) };
+    REQUIRE(ptr != nullptr);
+    std::memset(ptr, 1, 3*alloc.getPageSize());
+
+    alloc.free(ptr+alloc.getPageSize(), 1); // partial
+    alloc.free(ptr, 1);
+    alloc.free(ptr+2*alloc.getPageSize(), 1);
+    REQUIRE(alloc.getArenaBytes() == 0);
+}
+
+/*****************************************************/
+TEST_CASE("Arenas", "[MemoryAllocator]")
+{
+    HugePageOptions options; options.enable = true;
+    MemoryAllocator alloc(options);
+    const size_t pageSize { alloc.getPageSize() };
+    REQUIRE(alloc.getArenaBytes() == 0);
+
+    char* const ptr1 { static_cast<char*>(alloc.alloc(3)) };
+    char* const ptr2 { static_cast<char*>(alloc.alloc(5)) };
+    REQUIRE(alloc.getArenaBytes() == ARENA_SIZE);
+    REQUIRE(ptr2 == ptr1+3*pageSize); // carved from the same arena
+    std::memset(ptr1, 1, 8*pageSize);
+
+    alloc.free(ptr1+pageSize, 1); // partial
+    char* const ptr3 { static_cast<char*>(alloc.alloc(1)) };
+    REQUIRE(ptr3 == ptr1+pageSize); // re-used
+
+    // too big for an arena
+    char* const big { static_cast<char*>(alloc.alloc(ARENA_SIZE/pageSize+1)) };
+    REQUIRE(big != nullptr);
+    REQUIRE(alloc.getArenaBytes() == ARENA_SIZE);
+    alloc.free(big, ARENA_SIZE/pageSize+1);
+
+    alloc.free(ptr1, 1);
+    alloc.free(ptr3, 1);
+    alloc.free(ptr1+2*pageSize, 1);
+    REQUIRE(alloc.getArenaBytes() == ARENA_SIZE);
+    alloc.free(ptr2, 5); // now unused
+    REQUIRE(alloc.getArenaBytes() == 0);
+}
+
+/*****************************************************/
+TEST_CASE("Reserve", "[MemoryAllocator]")
+{
+    HugePageOptions options; options.enable = true;
+    options.reserve = ARENA_SIZE+1; // rounds up
+    MemoryAllocator alloc(options);
+    REQUIRE(alloc.getArenaBytes() == 2*ARENA_SIZE);
+
+    // fill both reserved arenas
+    const size_t arenaPages { ARENA_SIZE/alloc.getPageSize() };
+    void* const ptr1 { alloc.alloc(arenaPages) };
+    void* const ptr2 { alloc.alloc(arenaPages) };
+    REQUIRE(alloc.getArenaBytes() == 2*ARENA_SIZE);
+
+    void* const ptr3 { alloc.alloc(1) };
+    REQUIRE(alloc.getArenaBytes() == 3*ARENA_SIZE);
+
+    alloc.free(ptr1, arenaPages);
+    alloc.free(ptr2, arenaPages);
+    alloc.free(ptr3, 1); // only the non-reserved is unmapped
+    REQUIRE(alloc.getArenaBytes() == 2*ARENA_SIZE);
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
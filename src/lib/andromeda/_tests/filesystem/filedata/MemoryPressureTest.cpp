@@ -0,0 +1,88 @@
+
+#include <memory>
+#include <sstream>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/filesystem/filedata/CacheManager.hpp"
+#include "andromeda/filesystem/filedata/CacheOptions.hpp"
+#include "andromeda/filesystem/filedata/MemoryPressure.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+constexpr size_t MiB { static_cast<size_t>(1024)*1024 };
+
+/** Memory pressure source that returns whatever reading the test sets */
+class FakePressure : public MemoryPressure
+{
+public:
+    explicit FakePressure(const Reading& reading) : mReading(reading) { }
+    bool Read(Reading& reading) override { reading = mReading; return true; }
+private:
+    const Reading& mReading;
+};
+
+/*****************************************************/
+TEST_CASE("ParseMeminfo", "[MemoryPressure]")
+{
+    std::istringstream meminfo("MemTotal:       16303136 kB\nMemFree:         1021680 kB\nMemAvailable:    9475800 kB\n");
+    uint64_t total { 0 }, available { 0 };
+    REQUIRE(SystemMemoryPressure::ParseMeminfo(meminfo, total, available));
+    REQUIRE(total == 16303136ULL*1024);
+    REQUIRE(available == 9475800ULL*1024);
+
+    std::istringstream old("MemTotal:       16303136 kB\nMemFree:         1021680 kB\n"); // before Linux 3.14
+    REQUIRE(!SystemMemoryPressure::ParseMeminfo(old, total, available));
+}
+
+/*****************************************************/
+TEST_CASE("ParsePressure", "[MemoryPressure]")
+{
+    std::istringstream psi("some avg10=1.53 avg60=0.87 avg300=0.29 total=12345\nfull avg10=0.50 avg60=0.10 avg300=0.00 total=678\n");
+    double stall { 0 };
+    REQUIRE(SystemMemoryPressure::ParsePressure(psi, stall));
+    REQUIRE(stall == 1.53);
+
+    std::istringstream empty("");
+    REQUIRE(!SystemMemoryPressure::ParsePressure(empty, stall));
+}
+
+/*****************************************************/
+TEST_CASE("DynamicLimit", "[MemoryPressure]")
+{
+    CacheOptions options;
+    options.memoryLimit = 160*MiB; // step is 10M
+    options.evictSizeFrac = 16;
+    options.memoryMin = 20*MiB;
+
+    MemoryPressure::Reading reading { 1000*MiB, 900*MiB, 0 }; // reserve is 100M
+    CacheManager cacheMgr(options, false, std::make_unique<FakePressure>(reading));
+    cacheMgr.UpdateMemoryLimit();
+    REQUIRE(cacheMgr.GetMemoryLimit() == 160*MiB); // plenty free, stays at the max
+
+    reading.available = 90*MiB; // below the reserve, shrink right away
+    cacheMgr.UpdateMemoryLimit();
+    REQUIRE(cacheMgr.GetMemoryLimit() == 20*MiB);
+
+    reading.available = 150*MiB; // half of the spare 50M
+    cacheMgr.UpdateMemoryLimit();
+    REQUIRE(cacheMgr.GetMemoryLimit() == 25*MiB);
+
+    reading.available = 900*MiB; // grows a step at a time
+    cacheMgr.UpdateMemoryLimit();
+    REQUIRE(cacheMgr.GetMemoryLimit() == 35*MiB);
+    cacheMgr.UpdateMemoryLimit();
+    REQUIRE(cacheMgr.GetStats().memoryLimit == 45*MiB);
+
+    reading.stall = 5.0; // tasks are stalled on memory even though some is available
+    cacheMgr.UpdateMemoryLimit();
+    REQUIRE(cacheMgr.GetMemoryLimit() == 20*MiB);
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,172 @@
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "testBackend.hpp"
+#include "andromeda/common.hpp"
+#include "andromeda/ConfigOptions.hpp"
+#include "andromeda/SharedMutex.hpp"
+#include "andromeda/ThreadPool.hpp"
+#include "andromeda/backend/BackendException.hpp"
+#include "andromeda/filesystem/File.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+constexpr size_t TEST_PAGE_SIZE { 4096 };
+
+/** Returns options for a backend using TEST_PAGE_SIZE pages */
+ConfigOptions GetConfigOptions()
+{
+    ConfigOptions options;
+    options.pageSize = TEST_PAGE_SIZE;
+    return options;
+}
+
+/** Occupies all of a thread pool's workers while in scope, so new tasks stay queued */
+class PoolBlocker
+{
+public:
+    explicit PoolBlocker(ThreadPool& pool)
+    {
+        const std::shared_future<void> blockFut { mBlock.get_future() };
+        for (size_t worker { 0 }; worker < pool.GetMaxWorkers(); ++worker)
+        {
+            mTasks.emplace_back(pool.Submit([this, blockFut]{ ++mRunning; blockFut.wait(); }));
+            while (mRunning.load() <= worker) std::this_thread::yield(); // starts a new worker
+        }
+    }
+
+    ~PoolBlocker()
+    {
+        mBlock.set_value();
+        for (const ThreadPool::TaskPtr& task : mTasks) task->Wait();
+    }
+
+    DELETE_COPY(PoolBlocker)
+    DELETE_MOVE(PoolBlocker)
+
+private:
+    std::promise<void> mBlock;
+    std::atomic<size_t> mRunning { 0 };
+    std::vector<ThreadPool::TaskPtr> mTasks;
+};
+
+/** Writes the first page of the given file with the given character and starts its flush */
+void WriteFlush(File& file, const char val)
+{
+    const std::string data(TEST_PAGE_SIZE, val);
+    const SharedLockW fileLock { file.GetWriteLock() };
+    file.WriteBytes(data.data(), 0, data.size(), fileLock);
+    file.FlushCache(fileLock);
+}
+
+/*****************************************************/
+TEST_CASE("CancelQueuedFetch", "[PageManager]")
+{
+    TestBackend backend(GetConfigOptions());
+    const std::unique_ptr<File> file { backend.MakeFile("file1", 8*TEST_PAGE_SIZE) };
+
+    const PoolBlocker blocker(backend.GetBackend().GetThreadPool());
+    { const SharedLockR fileLock { file->GetReadLock() };
+        file->Prefetch(0, 0, fileLock); } // queued
+    file->CancelFetches(0);
+
+    // the cancelled read-ahead frees its pages, the read starts a new fetch of just its own
+    std::string buf(TEST_PAGE_SIZE, '\0');
+    { const SharedLockR fileLock { file->GetReadLock() };
+        file->ReadBytes(buf.data(), 0, buf.size(), fileLock); }
+
+    REQUIRE(buf == std::string(TEST_PAGE_SIZE, 'a'));
+    REQUIRE(backend.GetRunner().GetDownloads() == 1);
+    REQUIRE(backend.GetRunner().GetDownloaded(0) == TEST_PAGE_SIZE);
+}
+
+/*****************************************************/
+TEST_CASE("CancelStreamingFetch", "[PageManager]")
+{
+    TestBackend backend(GetConfigOptions());
+    const std::unique_ptr<File> file { backend.MakeFile("file1", 16*TEST_PAGE_SIZE) };
+
+    // cancel the read-ahead part way through its download
+    FakeRunner& runner { backend.GetRunner() };
+    runner.SetChunkSize(TEST_PAGE_SIZE);
+    runner.SetChunkFunc([&](const size_t download, const uint64_t offset){
+        if (!download && offset == 4*TEST_PAGE_SIZE) file->CancelFetches(4*TEST_PAGE_SIZE); });
+
+    { const SharedLockR fileLock { file->GetReadLock() };
+        file->Prefetch(0, 0, fileLock); }
+
+    backend.ReadFile(*file); // doesn't wait on the cancelled pages
+
+    REQUIRE(runner.GetDownloaded(0) < 16*TEST_PAGE_SIZE); // aborted
+    REQUIRE(runner.GetDownloads() >= 2); // fetched the rest again
+}
+
+/*****************************************************/
+TEST_CASE("DestroyDuringFetch", "[PageManager]")
+{
+    TestBackend backend(GetConfigOptions());
+    std::unique_ptr<File> file { backend.MakeFile("file1", 16*TEST_PAGE_SIZE) };
+
+    // the file is destroyed while its read-ahead is still streaming
+    std::promise<void> started;
+    FakeRunner& runner { backend.GetRunner() };
+    runner.SetChunkSize(TEST_PAGE_SIZE);
+    runner.SetChunkFunc([&](const size_t download, const uint64_t offset){
+        if (!download && offset == TEST_PAGE_SIZE) started.set_value();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+
+    { const SharedLockR fileLock { file->GetReadLock() };
+        file->Prefetch(0, 0, fileLock); }
+    started.get_future().wait();
+    file.reset(); // waits for the fetch, which still uses the file's backend
+
+    REQUIRE(runner.GetDownloads() == 1);
+}
+
+/*****************************************************/
+TEST_CASE("WaitFlushFailure", "[PageManager]")
+{
+    TestBackend backend(GetConfigOptions());
+    const std::unique_ptr<File> file { backend.MakeFile("file1", 4*TEST_PAGE_SIZE) };
+    FakeRunner& runner { backend.GetRunner() };
+
+    runner.SetWriteFailures(1);
+    WriteFlush(*file, 'b');
+    REQUIRE_THROWS_AS(file->WaitFlush(), Backend::BackendException);
+    REQUIRE_NOTHROW(file->WaitFlush()); // reported once
+
+    // the failed page is dirty again, the next flush writes it
+    { const SharedLockW fileLock { file->GetWriteLock() };
+        file->FlushCache(fileLock); }
+    REQUIRE_NOTHROW(file->WaitFlush());
+    REQUIRE(runner.GetWrites() == 2);
+}
+
+/*****************************************************/
+TEST_CASE("RetryFailedFlush", "[PageManager]")
+{
+    TestBackend backend(GetConfigOptions());
+    FakeRunner& runner { backend.GetRunner() };
+
+    { const std::unique_ptr<File> file { backend.MakeFile("file1", 4*TEST_PAGE_SIZE) };
+        runner.SetWriteFailures(1);
+        WriteFlush(*file, 'b'); } // never waited on
+
+    REQUIRE(runner.GetWrites() == 2); // retried rather than dropped
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,250 @@
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/filesystem/filedata/PageTable.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+using TestTable = PageTable<std::string>;
+constexpr uint64_t NONE { TestTable::NONE };
+
+/*****************************************************/
+TEST_CASE("Basic", "[PageTable]")
+{
+    TestTable table;
+    REQUIRE(table.empty());
+    REQUIRE(table.find(0) == nullptr);
+    REQUIRE(table.next(0) == NONE);
+    REQUIRE(table.prev(1000) == NONE);
+
+    const std::pair<std::string*, bool> ins { table.try_emplace(5, "five") };
+    REQUIRE(ins.second);
+    REQUIRE(*ins.first == "five");
+    REQUIRE(!table.try_emplace(5, "other").second); // already present
+    REQUIRE(*table.find(5) == "five");
+    REQUIRE(table.contains(5));
+    REQUIRE(!table.contains(4));
+    REQUIRE(&table.at(5) == table.find(5));
+    REQUIRE_THROWS_AS(table.at(4), std::out_of_range);
+
+    table.try_emplace(1000, "thousand"); // another leaf
+    REQUIRE(table.size() == 2);
+    REQUIRE(ins.first == table.find(5)); // address is stable
+
+    REQUIRE(table.next(0) == 5);
+    REQUIRE(table.next(5) == 5);
+    REQUIRE(table.next(6) == 1000);
+    REQUIRE(table.next(1001) == NONE);
+    REQUIRE(table.prev(5) == NONE);
+    REQUIRE(table.prev(6) == 5);
+    REQUIRE(table.prev(1000) == 5);
+    REQUIRE(table.prev(1001) == 1000);
+    REQUIRE(table.prev(99999) == 1000);
+
+    REQUIRE(table.erase(1000));
+    REQUIRE(!table.erase(1000));
+    REQUIRE(table.next(6) == NONE);
+    REQUIRE(table.size() == 1);
+}
+
+/*****************************************************/
+TEST_CASE("Dirty", "[PageTable]")
+{
+    TestTable table;
+    for (uint64_t idx { 250 }; idx < 270; ++idx) table.try_emplace(idx);
+
+    table.setDirty(100); // not present, ignored
+    REQUIRE(!table.isDirty(100));
+    REQUIRE(table.nextDirty(0) == NONE);
+
+    for (uint64_t idx { 254 }; idx < 260; ++idx) table.setDirty(idx); // crosses a leaf
+    table.setDirty(265);
+    REQUIRE(table.nextDirty(0) == 254);
+    REQUIRE(table.nextDirty(257) == 257);
+    REQUIRE(table.nextDirty(260) == 265);
+    REQUIRE(table.isDirty(258));
+
+    table.setDirty(258, false);
+    REQUIRE(table.nextDirty(258) == 259);
+    table.erase(265); // clears the dirty bit
+    table.try_emplace(265);
+    REQUIRE(!table.isDirty(265));
+
+    std::map<uint64_t, std::string> seen;
+    table.forEach([&](const uint64_t index, const std::string& value){ seen.emplace(index, value); });
+    REQUIRE(seen.size() == 20);
+    REQUIRE(seen.begin()->first == 250);
+    REQUIRE(seen.rbegin()->first == 269);
+}
+
+/*****************************************************/
+TEST_CASE("Random", "[PageTable]")
+{
+    TestTable table;
+    std::map<uint64_t, std::string> model;
+    std::mt19937_64 rng(1234); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+
+    // mostly dense indexes, some spread far apart (multiple tree levels)
+    const auto randIndex { [&](const uint64_t max){ const uint64_t index { rng() % max };
+        return (index % 8) ? index : index << 24; } };
+
+    for (size_t iter { 0 }; iter < 5000; ++iter)
+    {
+        const uint64_t index { randIndex(2000) };
+        if (rng() % 3)
+        {
+            table.try_emplace(index, std::to_string(index));
+            model.emplace(index, std::to_string(index));
+        }
+        else
+        {
+            REQUIRE(table.erase(index) == (model.erase(index) > 0));
+        }
+
+        const uint64_t probe { randIndex(2100) };
+        const std::map<uint64_t, std::string>::const_iterator nextIt { model.lower_bound(probe) };
+        REQUIRE(table.next(probe) == ((nextIt == model.end()) ? NONE : nextIt->first));
+        REQUIRE(table.prev(probe) == ((nextIt == model.begin()) ? NONE : std::prev(nextIt)->first));
+        REQUIRE(table.size() == model.size());
+    }
+}
+
+/*****************************************************/
+TEST_CASE("Sparse", "[PageTable]")
+{
+    TestTable table;
+    const uint64_t far { static_cast<uint64_t>(1) << 40 };
+    const uint64_t last { NONE-1 };
+
+    table.try_emplace(far, "far"); // only allocates the path to it
+    REQUIRE(table.memory() < 4096);
+    table.try_emplace(3, "three"); // grows a new root above
+    table.try_emplace(last, "last");
+    REQUIRE(*table.find(far) == "far");
+    REQUIRE(*table.findShared(far) == "far");
+    REQUIRE(*table.findShared(last) == "last");
+    REQUIRE(table.find(far+1) == nullptr);
+
+    REQUIRE(table.next(4) == far);
+    REQUIRE(table.next(far+1) == last);
+    REQUIRE(table.next(last) == last);
+    REQUIRE(table.prev(far) == 3);
+    REQUIRE(table.prev(last) == far);
+    REQUIRE(table.prev(NONE) == last);
+    table.setDirty(last);
+    REQUIRE(table.nextDirty(0) == last);
+
+    REQUIRE(table.erase(far));
+    REQUIRE(table.next(4) == last);
+    REQUIRE(table.erase(last));
+    REQUIRE(table.erase(3));
+    REQUIRE(table.empty());
+    REQUIRE(table.memory() == 0); // all nodes freed
+    REQUIRE(table.next(0) == NONE);
+}
+
+/*****************************************************/
+TEST_CASE("Memory", "[PageTable]")
+{
+    std::atomic<size_t> total { 0 };
+    {
+        TestTable table1(&total);
+        TestTable table2(&total);
+        table1.try_emplace(0, "zero");
+        REQUIRE(table1.memory() > sizeof(std::string));
+        REQUIRE(table1.memory() < 2048); // no large fixed leaf
+        REQUIRE(total.load() == table1.memory());
+
+        for (uint64_t index { 0 }; index < 1000; ++index)
+            table2.try_emplace(index*7, std::to_string(index));
+        REQUIRE(total.load() == table1.memory() + table2.memory());
+
+        const size_t before { table2.memory() };
+        for (uint64_t index { 0 }; index < 500; ++index) table2.erase(index*7);
+        REQUIRE(table2.memory() < before);
+        REQUIRE(total.load() == table1.memory() + table2.memory());
+
+        table1.clear();
+        REQUIRE(table1.memory() == 0);
+        REQUIRE(total.load() == table2.memory());
+    }
+    REQUIRE(total.load() == 0);
+}
+
+/*****************************************************/
+TEST_CASE("Hidden", "[PageTable]")
+{
+    TestTable table;
+    table.try_emplace(3, "three");
+    REQUIRE(*table.findShared(3) == "three");
+
+    table.emplaceHidden(4, "four");
+    REQUIRE(table.find(4) != nullptr);
+    REQUIRE(table.findShared(4) == nullptr);
+    table.publish(4);
+    REQUIRE(*table.findShared(4) == "four");
+
+    table.emplaceHidden(1000, "thousand"); // own leaf, kept when erased
+    REQUIRE(table.erase(1000));
+    REQUIRE(table.next(5) == NONE);
+    REQUIRE(table.findShared(1000) == nullptr);
+    table.try_emplace(1000, "again");
+    REQUIRE(*table.findShared(1000) == "again");
+
+    table.clear();
+    REQUIRE(table.findShared(3) == nullptr);
+    REQUIRE(table.empty());
+}
+
+/*****************************************************/
+TEST_CASE("Shared", "[PageTable]")
+{
+    // readers use findShared() while one writer inserts (growing the tree) and publishes
+    constexpr uint64_t count { 20000 };
+    TestTable table;
+    std::atomic<bool> done { false };
+
+    std::vector<std::thread> readers;
+    std::atomic<size_t> errors { 0 };
+    for (size_t thread { 0 }; thread < 4; ++thread) readers.emplace_back([&, thread]()
+    {
+        std::mt19937_64 rng(thread); // NOLINT(cert-msc32-c,cert-msc51-cpp)
+        while (!done.load())
+        {
+            const uint64_t index { rng() % count };
+            const std::string* const value { table.findShared(index) };
+            if (value != nullptr && *value != std::to_string(index)) ++errors;
+        }
+    });
+
+    for (uint64_t index { 0 }; index < count; ++index)
+    {
+        if (index % 2) table.try_emplace(index, std::to_string(index));
+        else { table.emplaceHidden(index, std::to_string(index)); table.publish(index); }
+    }
+    done.store(true);
+    for (std::thread& reader : readers) reader.join();
+
+    REQUIRE(errors.load() == 0);
+    REQUIRE(table.size() == count);
+    for (uint64_t index { 0 }; index < count; ++index) 
+        { REQUIRE(table.findShared(index) != nullptr); }
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,107 @@
+
+#include <cstring>
+#include <string>
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/filesystem/filedata/CachingAllocator.hpp"
+#include "andromeda/filesystem/filedata/Page.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+/** Returns the page's data as a string */
+std::string GetData(const Page& page)
+{
+    return std::string(page.data(), page.size());
+}
+
+/*****************************************************/
+TEST_CASE("DirtyRanges", "[Page]")
+{
+    CachingAllocator alloc(0);
+    Page page(16, alloc);
+    REQUIRE(!page.isDirty());
+    REQUIRE(page.getDirtyRanges().empty());
+
+    page.addDirty(2, 3);
+    page.addDirty(5, 2);
+    page.addDirty(10, 4);
+    REQUIRE(page.isDirty());
+    REQUIRE(page.getDirtyRanges().size() == 2); // coalesced
+
+    page.resize(12); // drops ranges past the end
+    REQUIRE(page.getDirtyRanges().size() == 2);
+    REQUIRE(page.getDirtyRanges().find(11) != page.getDirtyRanges().cend());
+    REQUIRE(page.getDirtyRanges().find(12) == page.getDirtyRanges().cend());
+
+    page.setDirty(false);
+    REQUIRE(!page.isDirty());
+    REQUIRE(page.getDirtyRanges().empty());
+
+    page.setDirty(); // no ranges, all dirty
+    REQUIRE(page.isDirty());
+    REQUIRE(page.getDirtyRanges().empty());
+}
+
+/*****************************************************/
+TEST_CASE("Partial", "[Page]")
+{
+    CachingAllocator alloc(0);
+    Page page(8, alloc);
+    std::memset(page.data(), 0, page.size());
+    REQUIRE(!page.isPartial());
+    REQUIRE(page.isValid(0, 8));
+
+    page.setPartial(6); // backend has 6 bytes
+    REQUIRE(page.isPartial());
+    REQUIRE(page.isValid(6, 2));
+    REQUIRE(!page.isValid(0, 1));
+
+    std::memcpy(page.data()+1, "ab", 2); page.addDirty(1, 2);
+    REQUIRE(page.isValid(1, 2));
+    REQUIRE(!page.isValid(1, 3));
+    REQUIRE(page.isValid(0, 0));
+
+    page.resize(10); // new bytes are past the backend's data
+    REQUIRE(page.isValid(6, 4));
+
+    Page backend(6, alloc);
+    std::memcpy(backend.data(), "012345", 6);
+    page.resolve(backend);
+    REQUIRE(!page.isPartial());
+    REQUIRE(page.isValid(0, 10));
+    REQUIRE(GetData(page) == std::string("0ab345\0\0\0\0", 10));
+    REQUIRE(page.isDirty()); // resolving doesn't change the dirty state
+}
+
+/*****************************************************/
+TEST_CASE("MoveCopy", "[Page]")
+{
+    CachingAllocator alloc(0);
+    Page page(4, alloc);
+    std::memcpy(page.data(), "wxyz", 4);
+    page.setPartial(4);
+    page.addDirty(0, 2);
+
+    Page moved(std::move(page));
+    REQUIRE(page.size() == 0); // NOLINT(bugprone-use-after-move)
+    REQUIRE(!page.isPartial()); // NOLINT(bugprone-use-after-move)
+    REQUIRE(moved.isPartial());
+    REQUIRE(moved.isValid(0, 2));
+    REQUIRE(moved.getDirtyRanges().size() == 1);
+
+    page.copyFrom(moved); // NOLINT(bugprone-use-after-move)
+    REQUIRE(GetData(page) == "wxyz");
+    REQUIRE(page.isPartial());
+    REQUIRE(page.isValid(0, 2));
+    REQUIRE(!page.isValid(2, 1));
+    REQUIRE(page.getDirtyRanges().empty()); // not copied
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,57 @@
+
+#include "catch2/catch_test_macros.hpp"
+
+#include "andromeda/filesystem/filedata/SiblingPattern.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+namespace { // anonymous
+
+/*****************************************************/
+TEST_CASE("InOrder", "[SiblingPattern]")
+{
+    SiblingPattern pattern;
+    REQUIRE(!pattern.RecordOpen("a"));
+    REQUIRE(!pattern.RecordOpen("b"));
+    REQUIRE(pattern.RecordOpen("d")); // skipping some is still in order
+    REQUIRE(pattern.GetOpenRun() == SiblingPattern::OPEN_RUN);
+
+    REQUIRE(pattern.StartPrefetch("e"));
+    REQUIRE(pattern.StartPrefetch("f"));
+    REQUIRE(!pattern.StartPrefetch("e")); // already started
+
+    // the run continues, only the new siblings need starting
+    REQUIRE(pattern.RecordOpen("e"));
+    REQUIRE(!pattern.StartPrefetch("f"));
+    REQUIRE(pattern.StartPrefetch("g"));
+}
+
+/*****************************************************/
+TEST_CASE("OutOfOrder", "[SiblingPattern]")
+{
+    SiblingPattern pattern;
+    pattern.RecordOpen("a"); pattern.RecordOpen("b");
+    REQUIRE(pattern.RecordOpen("c"));
+    REQUIRE(pattern.StartPrefetch("d"));
+
+    // going back starts a new run and forgets what was prefetched
+    REQUIRE(!pattern.RecordOpen("b"));
+    REQUIRE(pattern.GetOpenRun() == 1);
+    REQUIRE(!pattern.RecordOpen("b")); // the same file again is not in order
+    REQUIRE(!pattern.RecordOpen("c"));
+    REQUIRE(pattern.RecordOpen("x"));
+    REQUIRE(pattern.StartPrefetch("y"));
+
+    SiblingPattern again;
+    again.RecordOpen("a"); again.RecordOpen("b"); again.RecordOpen("c");
+    REQUIRE(again.StartPrefetch("d"));
+    again.RecordOpen("a"); again.RecordOpen("b");
+    REQUIRE(again.RecordOpen("c"));
+    REQUIRE(again.StartPrefetch("d")); // prefetched before the reset, started again
+}
+
+} // namespace
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,189 @@
+
+#ifndef LIBA2_TESTBACKEND_H_
+#define LIBA2_TESTBACKEND_H_
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "nlohmann/json.hpp"
+
+#include "andromeda/common.hpp"
+#include "andromeda/ConfigOptions.hpp"
+#include "andromeda/SharedMutex.hpp"
+#include "andromeda/backend/BackendImpl.hpp"
+#include "andromeda/backend/BaseRunner.hpp"
+#include "andromeda/backend/Config.hpp"
+#include "andromeda/backend/RunnerInput.hpp"
+#include "andromeda/backend/RunnerPool.hpp"
+#include "andromeda/filesystem/File.hpp"
+#include "andromeda/filesystem/folders/SuperRoot.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/** Runner that answers just enough for a backend with files to read and write, recording the transfers */
+class FakeRunner : public Backend::BaseRunner
+{
+public:
+    /** Function called before each chunk of a download is streamed, with the download number and chunk offset */
+    using ChunkFunc = std::function<void (size_t, uint64_t)>;
+
+    FakeRunner() = default;
+
+    [[nodiscard]] std::unique_ptr<BaseRunner> Clone() const override { return std::unique_ptr<BaseRunner>(new FakeRunner(mState)); }
+    [[nodiscard]] std::string GetHostname() const override { return "fake"; }
+    [[nodiscard]] bool RequiresSession() const override { return false; }
+
+    std::string RunAction_Read(const Backend::RunnerInput& input) override
+    {
+        nlohmann::json appdata;
+        if (input.app == "core" && input.action == "getconfig")
+            appdata = {{"apiver", std::to_string(Backend::Config::API_MAJOR_VERSION)+".0"},
+                {"apps", {{"core",""}, {"accounts",""}, {"files",""}}}, {"read_only", false}};
+        else if (input.app == "files" && input.action == "getconfig")
+            appdata = {{"upload_maxbytes", nullptr}};
+        else if (input.app == "files" && input.action == "getstorage")
+            appdata = {{"chunksize", nullptr}, {"readonly", false}, {"sttype", "Local"}};
+        return nlohmann::json{{"ok", true}, {"appdata", appdata}}.dump();
+    }
+
+    std::string RunAction_Write(const Backend::RunnerInput& input) override { return ""; }
+    std::string RunAction_FilesIn(const Backend::RunnerInput_FilesIn& input) override { return ""; }
+
+    std::string RunAction_StreamIn(const Backend::RunnerInput_StreamIn& input) override
+    {
+        { const std::lock_guard<std::mutex> lock(mState->mMutex);
+            ++mState->mWrites;
+            if (mState->mWriteFailures) { --mState->mWriteFailures;
+                return nlohmann::json{{"ok", false}, {"code", 500}, {"message", "WRITE_FAILED"}}.dump(); } }
+
+        for (const Backend::RunnerInput_StreamIn::FileStreams::value_type& fstream : input.fstreams)
+        {
+            std::string buf(4096, '\0');
+            size_t offset { 0 }; size_t read { 0 };
+            while (fstream.second.streamer(offset, buf.data(), buf.size(), read)) offset += read;
+        }
+        return nlohmann::json{{"ok", true}, {"appdata", {{"id", input.plainParams.at("file")}}}}.dump();
+    }
+
+    void RunAction_StreamOut(const Backend::RunnerInput_StreamOut& input) override
+    {
+        const size_t length { std::stoul(input.dataParams.at("flast")) - std::stoul(input.dataParams.at("fstart")) + 1 };
+        size_t download { 0 }; { // lock scope
+            const std::lock_guard<std::mutex> lock(mState->mMutex);
+            download = mState->mDownloads.size();
+            mState->mDownloads.push_back(0); }
+
+        const std::string data(mState->mChunkSize ? std::min(mState->mChunkSize, length) : length, 'a');
+        for (size_t offset { 0 }; offset < length; offset += data.size())
+        {
+            if (mState->mChunkFunc) mState->mChunkFunc(download, offset);
+            const size_t chunk { std::min(data.size(), length-offset) };
+            { const std::lock_guard<std::mutex> lock(mState->mMutex);
+                mState->mDownloads[download] += chunk; }
+            if (!input.streamer(offset, data.data(), chunk)) return; // cancelled
+        }
+    }
+
+    /** Returns the number of file downloads started (by this runner and its clones) */
+    [[nodiscard]] size_t GetDownloads() const
+    {
+        const std::lock_guard<std::mutex> lock(mState->mMutex);
+        return mState->mDownloads.size();
+    }
+
+    /** Returns the number of bytes streamed by the given download */
+    [[nodiscard]] size_t GetDownloaded(const size_t download) const
+    {
+        const std::lock_guard<std::mutex> lock(mState->mMutex);
+        return mState->mDownloads.at(download);
+    }
+
+    /** Returns the number of file writes run */
+    [[nodiscard]] size_t GetWrites() const
+    {
+        const std::lock_guard<std::mutex> lock(mState->mMutex);
+        return mState->mWrites;
+    }
+
+    /** Fails the next given number of file writes */
+    void SetWriteFailures(const size_t failures)
+    {
+        const std::lock_guard<std::mutex> lock(mState->mMutex);
+        mState->mWriteFailures = failures;
+    }
+
+    /** Streams downloads in chunks of the given size, or 0 for all at once - set before use */
+    void SetChunkSize(const size_t chunkSize) { mState->mChunkSize = chunkSize; }
+
+    /** Sets the function to call before each chunk - set before use */
+    void SetChunkFunc(const ChunkFunc& chunkFunc) { mState->mChunkFunc = chunkFunc; }
+
+private:
+
+    /** State shared with clones */
+    struct State
+    {
+        std::mutex mMutex;
+        /** The number of bytes streamed by each download */
+        std::vector<size_t> mDownloads;
+        size_t mChunkSize { 0 };
+        ChunkFunc mChunkFunc;
+        size_t mWrites { 0 };
+        size_t mWriteFailures { 0 };
+    };
+
+    explicit FakeRunner(std::shared_ptr<State> state) : mState(std::move(state)) { }
+
+    std::shared_ptr<State> mState { std::make_shared<State>() };
+};
+
+/** A backend using a FakeRunner, with a parent folder for test files */
+class TestBackend
+{
+public:
+    explicit TestBackend(const ConfigOptions& options) :
+        mRunners(mRunner, options), mBackend(options, mRunners), mParent(mBackend) { }
+    DELETE_COPY(TestBackend)
+    DELETE_MOVE(TestBackend)
+
+    /** Returns a new file on the backend with the given ID and size (set the CacheManager first) */
+    std::unique_ptr<File> MakeFile(const std::string& id, const uint64_t size)
+    {
+        const nlohmann::json data {{"id", id}, {"name", id}, {"size", size}, {"storage", ""},
+            {"date_created", 0}, {"date_modified", nullptr}, {"date_accessed", nullptr}};
+        return std::make_unique<File>(mBackend, data, mParent);
+    }
+
+    /** Reads all of the given file, returning the number of downloads it took */
+    size_t ReadFile(File& file)
+    {
+        const size_t downloads { mRunner.GetDownloads() };
+        const SharedLockR fileLock { file.GetReadLock() };
+        std::string buf(file.GetPageSize(), '\0');
+        const uint64_t size { file.GetSize(fileLock) };
+        for (uint64_t offset { 0 }; offset < size; offset += buf.size())
+            file.ReadBytes(buf.data(), offset, std::min<uint64_t>(buf.size(), size-offset), fileLock);
+        return mRunner.GetDownloads() - downloads;
+    }
+
+    inline FakeRunner& GetRunner() { return mRunner; }
+    inline Backend::BackendImpl& GetBackend() { return mBackend; }
+
+private:
+    FakeRunner mRunner;
+    Backend::RunnerPool mRunners;
+    Backend::BackendImpl mBackend;
+    Folders::SuperRoot mParent;
+};
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
+
+#endif // LIBA2_TESTBACKEND_H_
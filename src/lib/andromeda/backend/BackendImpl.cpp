@@ -16,8 +16,11 @@
 #include "andromeda/Crypto.hpp"
 #include "andromeda/PlatformUtil.hpp"
 #include "andromeda/StringUtil.hpp"
+#include "andromeda/ThreadPool.hpp"
+#include "andromeda/filesystem/filedata/BandwidthEstimator.hpp"
 #include "andromeda/filesystem/filedata/CacheManager.hpp"
 #include "andromeda/filesystem/filedata/CachingAllocator.hpp"
+using Andromeda::Filesystem::Filedata::BandwidthEstimator;
 using Andromeda::Filesystem::Filedata::CachingAllocator;
 
 namespace Andromeda {
@@ -28,6 +31,9 @@ std::atomic<uint64_t> BackendImpl::sReqNext { 1 };
 /*****************************************************/
 BackendImpl::BackendImpl(const ConfigOptions& options, RunnerPool& runners) : 
     mOptions(options), mRunners(runners),
+    mReadBandwidth(std::make_unique<BandwidthEstimator>("BackendRead")),
+    mWriteBandwidth(std::make_unique<BandwidthEstimator>("BackendWrite")),
+    mThreadPool(std::make_unique<ThreadPool>(ThreadPool::GetWorkerCount(options.runnerPoolSize))),
     mDebug("Backend",this) , mConfig(*this)
     // loading mConfig now has the nice side effect of making sure any potential
     // HTTP->HTTPS redirect is out of the way before trying other actions!
@@ -642,30 +648,34 @@ std::string BackendImpl::ReadFile(const std::string& id, const uint64_t offset,
 }
 
 /*****************************************************/
-void BackendImpl::ReadFile(const std::string& id, const uint64_t offset, const size_t length, const ReadFunc& userFunc)
+bool BackendImpl::ReadFile(const std::string& id, const uint64_t offset, const size_t length, const ReadFunc& userFunc)
 {
-    if (!length) { MDBG_ERROR("() ERROR 0 length"); assert(false); return; }
+    if (!length) { MDBG_ERROR("() ERROR 0 length"); assert(false); return true; }
 
     const std::string fstart(std::to_string(offset));
     const std::string flast(std::to_string(offset+length-1));
 
     MDBG_INFO("(id:" << id << " fstart:" << fstart << " flast:" << flast << ")");
 
-    if (isMemory()) { userFunc(0, std::string(length,'\0').data(), length); return; } // debug only
+    if (isMemory()) return userFunc(0, std::string(length,'\0').data(), length); // debug only
 
-    size_t read = 0; RunnerInput_StreamOut input {{"files", "download", {{"file", id}}, // plainParams
+    size_t read = 0; bool cancelled = false; RunnerInput_StreamOut input {{"files", "download", {{"file", id}}, // plainParams
         {{"fstart", fstart}, {"flast", flast}}}, // dataParams
-        [&](const size_t soffset, const char* buf, const size_t buflen)->void
+        [&](const size_t soffset, const char* buf, const size_t buflen)->bool
     {
         if (soffset+buflen > length) // too much data
             throw ReadSizeException(length, soffset+buflen);
         
         read = std::max(read, soffset+buflen);
-        userFunc(soffset, buf, buflen); 
+        cancelled = !userFunc(soffset, buf, buflen);
+        return !cancelled;
     }}; MDBG_BACKEND(input);
 
     RunAction_StreamOut(input);
+    if (cancelled) { MDBG_INFO("... cancelled after " << read); return false; }
+
     if (read < length) throw ReadSizeException(length, read);
+    return true;
 }
 
 namespace { // anonymous
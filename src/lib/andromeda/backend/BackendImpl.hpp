@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 
 #include "nlohmann/json_fwd.hpp"
@@ -17,8 +18,9 @@
 #include "andromeda/Debug.hpp"
 
 namespace Andromeda {
+class ThreadPool;
 
-namespace Filesystem { namespace Filedata { class CacheManager; class CachingAllocator; } }
+namespace Filesystem { namespace Filedata { class BandwidthEstimator; class CacheManager; class CachingAllocator; } }
 
 namespace Backend {
 class RunnerPool;
@@ -114,6 +116,15 @@ public:
     /** Returns the CachingAllocator to use for file data */
     Filesystem::Filedata::CachingAllocator& GetPageAllocator();
 
+    /** Returns the bandwidth estimator for file data reads from this backend (shared by all files) */
+    inline Filesystem::Filedata::BandwidthEstimator& GetReadBandwidth() { return *mReadBandwidth; }
+
+    /** Returns the bandwidth estimator for file data write-back to this backend (shared by all files) */
+    inline Filesystem::Filedata::BandwidthEstimator& GetWriteBandwidth() { return *mWriteBandwidth; }
+
+    /** Returns the thread pool to use for background I/O jobs */
+    inline ThreadPool& GetThreadPool() { return *mThreadPool; }
+
     /** Returns true if doing memory only */
     [[nodiscard]] bool isMemory() const;
 
@@ -315,10 +326,11 @@ public:
      * @param id file ID
      * @param offset offset to read from
      * @param length number of bytes to read
-     * @param userFunc data handler function
+     * @param userFunc data handler function - may return false to cancel the rest of the read
+     * @return false if userFunc cancelled the read (no size check is done)
      * @throws BackendException for backend issues
      */
-    void ReadFile(const std::string& id, uint64_t offset, size_t length, const ReadFunc& userFunc);
+    bool ReadFile(const std::string& id, uint64_t offset, size_t length, const ReadFunc& userFunc);
 
     /**
      * Writes data to a file
@@ -433,6 +445,14 @@ private:
 
     /** Allocator to use for all file pages (null if no cacheMgr) */
     std::unique_ptr<Filesystem::Filedata::CachingAllocator> mPageAllocator;
+
+    /** Bandwidth estimator for file data reads, each sample is one fetch stream (never null) */
+    std::unique_ptr<Filesystem::Filedata::BandwidthEstimator> mReadBandwidth;
+    /** Bandwidth estimator for file data write-back, each sample is one flush worker (never null) */
+    std::unique_ptr<Filesystem::Filedata::BandwidthEstimator> mWriteBandwidth;
+
+    /** Thread pool for background I/O jobs, sized from runnerPoolSize with a floor (never null) */
+    std::unique_ptr<ThreadPool> mThreadPool;
     
     mutable Debug mDebug;
     Config mConfig;
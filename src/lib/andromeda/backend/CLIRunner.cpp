@@ -3,6 +3,7 @@
 #include <iostream>
 #include <list>
 #include <sstream>
+#include <system_error>
 #include <utility>
 #include <vector>
 
@@ -244,14 +245,26 @@ void CLIRunner::RunAction_StreamOut(const RunnerInput_StreamOut& input)
     reproc::process process;
     StartProc(process, arguments, environment);
 
-    size_t offset { 0 }; CheckError(process, reproc::drain(process, 
+    size_t offset { 0 }; bool cancelled { false };
+    const std::error_code error { reproc::drain(process, 
         [&](reproc::stream stream, const uint8_t* buffer, size_t size)->std::error_code
     {
         // TODO see server issue with output modes... should we check if the stream here is out of err or both??
-        input.streamer(offset, reinterpret_cast<const char*>(buffer), size);
+        if (!input.streamer(offset, reinterpret_cast<const char*>(buffer), size))
+        {
+            cancelled = true; // stops drain()
+            return std::make_error_code(std::errc::operation_canceled);
+        }
         offset += size; return std::error_code(); // success
-    }, reproc::sink::null, mOptions.streamBufferSize));
+    }, reproc::sink::null, mOptions.streamBufferSize) };
 
+    if (cancelled) // the rest of the output is not wanted
+    {
+        MDBG_INFO("... cancelled at offset " << offset);
+        process.terminate(); return; // NOLINT(bugprone-unused-return-value,cert-err33-c)
+    }
+
+    CheckError(process, error);
     FinishProc(process, mOptions.timeout);
 }
 
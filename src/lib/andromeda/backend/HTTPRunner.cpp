@@ -147,7 +147,7 @@ void HTTPRunner::DoRequestsCustom(const std::function<httplib::Result()>& getAnd
         const steady_clock::time_point timeStart { steady_clock::now() };
         httplib::Result result { getAndHandleResult() }; // calls HandleResponse(respData)
 
-        if (result != nullptr && !respData.doRetry) return; // break
+        if ((result != nullptr || respData.cancelled) && !respData.doRetry) return; // break
         else HandleNonResponse(result, respData.canRetry, attempt, steady_clock::now()-timeStart);
     }
 }
@@ -346,7 +346,8 @@ void HTTPRunner::RunAction_StreamOut(const RunnerInput_StreamOut& input, bool& i
     }};
 
     httplib::ContentReceiver recvFunc { [&](const char* data, size_t length)->bool {
-        input.streamer(offset, data, length); 
+        if (!input.streamer(offset, data, length))
+            { respData.cancelled = true; return false; } // httplib aborts
         offset += length; return true;
     }};
 
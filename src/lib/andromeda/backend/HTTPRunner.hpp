@@ -145,6 +145,8 @@ private:
         bool canRetry { true };
         /** Set by HandleResponse(), true if it wants a retry in DoRequestsCustom() */
         bool doRetry { false };
+        /** Set by the content receiver, true if the reader stopped the transfer (not retried) */
+        bool cancelled { false };
     };
 
     /**
@@ -62,7 +62,7 @@ WriteFunc RunnerInput_StreamIn::FromStream(std::istream& data)
 ReadFunc RunnerInput_StreamOut::ToStream(std::ostream& data)
 {
     // curoff is copied to within the std::function and maintains state between successive calls
-    size_t curoff = 0; return [&data,curoff](const size_t offset, const char* buf, const size_t length) mutable ->void 
+    size_t curoff = 0; return [&data,curoff](const size_t offset, const char* buf, const size_t length) mutable ->bool 
     {
         if (offset != curoff)
         {
@@ -75,6 +75,7 @@ ReadFunc RunnerInput_StreamOut::ToStream(std::ostream& data)
         curoff += length;
 
         if (data.fail()) throw StreamFailException();
+        return true;
     };
 }
 
@@ -95,8 +95,9 @@ struct RunnerInput_StreamIn : RunnerInput_FilesIn
  * @param offset offset of the current output data 
  * @param buf pointer to buffer containing data
  * @param buflen length of the data buffer
+ * @return bool true to continue, false to stop the transfer early (not an error)
  */
-using ReadFunc = std::function<void (const size_t, const char*, const size_t)>;
+using ReadFunc = std::function<bool (const size_t, const char*, const size_t)>;
 
 /** A RunnerInput with a function to stream output */
 struct RunnerInput_StreamOut : RunnerInput
@@ -1,4 +1,7 @@
 
+
+#include <algorithm>
+
 #include "BaseRunner.hpp"
 #include "RunnerPool.hpp"
 #include "andromeda/ConfigOptions.hpp"
@@ -6,13 +9,39 @@
 namespace Andromeda {
 namespace Backend {
 
+namespace { // anonymous
+/** The priority of requests made by the current thread */
+thread_local RunnerPool::Priority tPriority { RunnerPool::Priority::FOREGROUND };
+/** True if the current thread's priority was set by a PriorityScope */
+thread_local bool tHasPriority { false };
+} // namespace
+
+/*****************************************************/
+RunnerPool::Priority RunnerPool::GetPriority() { return tPriority; }
+
+/*****************************************************/
+RunnerPool::PriorityScope::PriorityScope(const Priority priority) :
+    mPrevious(tPriority), mHadPrevious(tHasPriority)
+{
+    tPriority = tHasPriority ? std::min(tPriority, priority) : priority;
+    tHasPriority = true;
+}
+
+/*****************************************************/
+RunnerPool::PriorityScope::~PriorityScope()
+{
+    tPriority = mPrevious;
+    tHasPriority = mHadPrevious;
+}
+
 /*****************************************************/
 RunnerPool::RunnerPool(BaseRunner& runner, const ConfigOptions& options) :
     mRunnerPool(options.runnerPoolSize, nullptr),
     mRunnerLocks(options.runnerPoolSize),
+    mReserved((options.runnerPoolSize > 1) ? std::max(static_cast<size_t>(1), options.runnerPoolSize/RESERVE_FRAC) : 0),
     mDebug(__func__,this)
 {
-    MDBG_INFO("(poolSize:" << mRunnerPool.size() << ")");
+    MDBG_INFO("(poolSize:" << mRunnerPool.size() << " reserved:" << mReserved << ")");
     mRunnerPool[0] = &runner; // first is never null
 }
 
@@ -22,24 +51,23 @@ const BaseRunner& RunnerPool::GetFirst() const { return *mRunnerPool[0]; }
 /*****************************************************/
 RunnerPool::LockedRunner RunnerPool::GetRunner()
 {
+    const Priority priority { GetPriority() };
+    const size_t priorityIdx { static_cast<size_t>(priority) };
+
     UniqueLock llock(mMutex);
-    MDBG_INFO("()");
+    MDBG_INFO("(priority:" << priorityIdx << ")");
 
-    size_t idx { 0 }; while (true)
+    ++mWaiting[priorityIdx];
+    while (true)
     {
-        UniqueLock rlock(mRunnerLocks[idx], std::try_to_lock);
-        if (!rlock) // not locked
-        {
-            if (idx+1 == mRunnerPool.size()) // all busy, wait
-            {
-                MDBG_INFO("... waiting!");
-                idx = 0; // start over
-                mCV.wait(llock); 
-            }
-            else ++idx; // try next
-        }
-        else // have lock
+        for (size_t idx { 0 }; CanGetRunner(priority, llock) && idx < mRunnerPool.size(); ++idx)
         {
+            UniqueLock rlock(mRunnerLocks[idx], std::try_to_lock);
+            if (!rlock) continue; // busy, try next
+
+            --mWaiting[priorityIdx];
+            if (priority != Priority::FOREGROUND) ++mBackgroundBusy;
+
             if (!mRunnerPool[idx]) // not initialized
             {
                 MDBG_INFO("... new runner:" << idx);
@@ -48,24 +76,40 @@ RunnerPool::LockedRunner RunnerPool::GetRunner()
             }
 
             MDBG_INFO("... return runner:" << idx);
-            return LockedRunner(*this, *mRunnerPool[idx], std::move(rlock));
+            return LockedRunner(*this, *mRunnerPool[idx], priority, std::move(rlock));
         }
+
+        MDBG_INFO("... waiting!");
+        mCV.wait(llock);
     }
 }
 
 /*****************************************************/
-void RunnerPool::SignalWaiters()
+bool RunnerPool::CanGetRunner(const Priority priority, const UniqueLock& llock) const
+{
+    // more urgent waiters go first
+    for (size_t priorityIdx { 0 }; priorityIdx < static_cast<size_t>(priority); ++priorityIdx)
+        if (mWaiting[priorityIdx]) return false;
+
+    return priority == Priority::FOREGROUND ||
+        mBackgroundBusy + mReserved < mRunnerPool.size();
+}
+
+/*****************************************************/
+void RunnerPool::SignalWaiters(const Priority priority)
 {
     const UniqueLock llock(mMutex);
     MDBG_INFO("()");
-    mCV.notify_one();
+
+    if (priority != Priority::FOREGROUND) --mBackgroundBusy;
+    mCV.notify_all(); // waiters have different conditions
 }
 
 /*****************************************************/
 RunnerPool::LockedRunner::~LockedRunner()
 {
     mLock.unlock(); // BEFORE signal!
-    mPool.SignalWaiters();
+    mPool.SignalWaiters(mPriority);
 }
 
 } // namespace Backend
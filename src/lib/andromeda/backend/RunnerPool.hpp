@@ -1,7 +1,9 @@
 #ifndef LIBA2_RUNNERPOOL_H_
 #define LIBA2_RUNNERPOOL_H_
 
+#include <array>
 #include <condition_variable>
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -18,6 +20,9 @@ class BaseRunner;
 
 /** 
  * Manages a pool of concurrent backend runners 
+ * Each request has a priority class (set per-thread with a PriorityScope) - waiters are given runners in
+ * priority order, and background classes can't take the last runners so that foreground requests 
+ * (a user waiting) don't queue behind read-ahead or write-back
  * THREAD SAFE (INTERNAL LOCKS)
  */
 class RunnerPool
@@ -26,12 +31,44 @@ public:
 
     using UniqueLock = std::unique_lock<std::mutex>;
 
+    /** The priority class of a request, most urgent first */
+    enum class Priority : uint8_t
+    {
+        /** A user is waiting on the request (the default) */
+        FOREGROUND,
+        /** Reading data before it's needed */
+        READAHEAD,
+        /** Writing back cached data */
+        WRITEBACK
+    };
+
+    /** Returns the priority of requests made by the current thread */
+    static Priority GetPriority();
+
+    /** 
+     * Sets the priority of requests made by the current thread for its lifetime
+     * Never lowers a priority set by an outer scope (e.g. a background job run inline by a waiting user)
+     */
+    class PriorityScope
+    {
+    public:
+        explicit PriorityScope(Priority priority);
+        ~PriorityScope();
+        DELETE_COPY(PriorityScope)
+        DELETE_MOVE(PriorityScope)
+    private:
+        /** The thread's priority before this scope */
+        Priority mPrevious;
+        /** True if the thread had a priority set before this scope */
+        bool mHadPrevious;
+    };
+
     /** Scoped wrapper for accessing a runner under a lock */
     class LockedRunner
     {
     public:
-        explicit LockedRunner(RunnerPool& pool, BaseRunner& runner, UniqueLock&& lock) : 
-            mPool(pool), mRunner(runner), mLock(std::move(lock)) { }
+        explicit LockedRunner(RunnerPool& pool, BaseRunner& runner, Priority priority, UniqueLock&& lock) : 
+            mPool(pool), mRunner(runner), mPriority(priority), mLock(std::move(lock)) { }
 
         ~LockedRunner();
         DELETE_COPY(LockedRunner)
@@ -42,6 +79,7 @@ public:
     private:
         RunnerPool& mPool;
         BaseRunner& mRunner;
+        Priority mPriority;
         UniqueLock mLock;
     };
 
@@ -55,16 +93,27 @@ public:
     DELETE_COPY(RunnerPool)
     DELETE_MOVE(RunnerPool)
 
-    /** Returns a reference to a runner and accompanying lock */
+    /** Returns a reference to a runner and accompanying lock, waiting in order of the thread's priority */
     LockedRunner GetRunner();
 
+    /** Returns the number of runners that background priorities can't use */
+    [[nodiscard]] inline size_t GetReserved() const { return mReserved; }
+
     /** Returns a const reference to the first runner */
     [[nodiscard]] const BaseRunner& GetFirst() const;
 
 private:
 
-    /** Signal waiting threads */
-    void SignalWaiters();
+    /** Releases a runner of the given priority and signals waiting threads */
+    void SignalWaiters(Priority priority);
+
+    /** Returns true if a request of the given priority can take a free runner now */
+    bool CanGetRunner(Priority priority, const UniqueLock& llock) const;
+
+    /** The number of priority classes */
+    static constexpr size_t PRIORITY_COUNT { 3 };
+    /** The fraction of runners (1/x, at least one) reserved for foreground requests if there is more than one */
+    static constexpr size_t RESERVE_FRAC { 4 };
 
     /** Array of possibly-null pointers to runners to use */
     std::vector<BaseRunner*> mRunnerPool;
@@ -77,6 +126,13 @@ private:
     /** Condition variable to wait for a runner */
     std::condition_variable mCV;
 
+    /** The number of runners only foreground requests can use */
+    const size_t mReserved;
+    /** The number of runners in use by background requests */
+    size_t mBackgroundBusy { 0 };
+    /** The number of threads waiting for a runner, per priority */
+    std::array<size_t, PRIORITY_COUNT> mWaiting { };
+
     mutable Andromeda::Debug mDebug;
 };
 
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <limits>
 #include <utility>
 #include "nlohmann/json.hpp"
 
@@ -116,6 +117,9 @@ void File::Refresh(const nlohmann::json& data, const SharedLockW& thisLock)
         // will also need a mBackendTime in case of dirty writes
         if (newSize != mPageBackend->GetBackendSize(thisLock))
             mPageManager->RemoteChanged(newSize, thisLock);
+
+        // the disk cache does check size/mtime (mModified was updated above)
+        mPageManager->ValidateDiskCache(thisLock);
     }
     catch (const nlohmann::json::exception& ex) {
         throw BackendImpl::JSONErrorException(ex.what()); }
@@ -177,6 +181,92 @@ void File::FlushCache(const SharedLockW& thisLock, bool nothrow)
         ITDBG_ERROR("... ignoring error: " << e.what()); }
 }
 
+/*****************************************************/
+void File::SetCacheClass(const size_t cacheClass)
+{
+    ITDBG_INFO("(cacheClass:" << cacheClass << ")");
+
+    mPageManager->SetCacheClass(cacheClass);
+}
+
+/*****************************************************/
+size_t File::GetCacheClass() const
+{
+    return mPageManager->GetCacheClass();
+}
+
+/*****************************************************/
+void File::SetAdvice(const Advice advice, const SharedLock& thisLock)
+{
+    ITDBG_INFO("(advice:" << static_cast<int>(advice) << ")");
+
+    mPageManager->SetAdvice(advice, thisLock);
+}
+
+/*****************************************************/
+void File::Prefetch(const uint64_t offset, uint64_t length, const SharedLock& thisLock)
+{
+    ITDBG_INFO("(offset:" << offset << " length:" << length << ")");
+
+    if (mBackend.GetOptions().cacheType == ConfigOptions::CacheType::NONE) return;
+
+    const uint64_t fileSize { mPageManager->GetFileSize(thisLock) };
+    if (offset >= fileSize) return;
+    if (!length || length > fileSize-offset) length = fileSize-offset;
+
+    const size_t pageSize { mPageManager->GetPageSize() };
+    const uint64_t index { offset / pageSize };
+    mPageManager->Prefetch(index, Filedata::min64st((offset+length-1)/pageSize - index + 1, 
+        std::numeric_limits<size_t>::max()), thisLock);
+}
+
+/*****************************************************/
+void File::InformOpen()
+{
+    Folder::ScopeLocked parent; std::string name; { // lock scope
+        const SharedLockR thisLock { GetReadLock() };
+        Folder* const parentPtr { TryGetParent(thisLock) };
+        if (parentPtr == nullptr) return;
+
+        parent = parentPtr->TryLockScope();
+        name = GetName(thisLock);
+    }
+
+    if (parent) parent->InformFileOpen(name);
+}
+
+/*****************************************************/
+void File::CancelFetches(const uint64_t offset)
+{
+    ITDBG_INFO("(offset:" << offset << ")");
+
+    const size_t pageSize { mPageManager->GetPageSize() };
+    mPageManager->CancelFetches((offset+pageSize-1)/pageSize); // the page with offset is still needed
+}
+
+/*****************************************************/
+void File::DropCache(const uint64_t offset, uint64_t length, const SharedLockW& thisLock)
+{
+    ITDBG_INFO("(offset:" << offset << " length:" << length << ")");
+
+    const uint64_t fileSize { mPageManager->GetFileSize(thisLock) };
+    if (offset >= fileSize) return;
+    if (!length || length > fileSize-offset) length = fileSize-offset;
+
+    const size_t pageSize { mPageManager->GetPageSize() };
+    const uint64_t index { offset / pageSize };
+    mPageManager->EvictPages(index, Filedata::min64st((offset+length-1)/pageSize - index + 1, 
+        std::numeric_limits<size_t>::max()), thisLock);
+}
+
+/*****************************************************/
+void File::WaitFlush()
+{
+    ITDBG_INFO("()");
+
+    mPageManager->WaitFlush();
+}
+
 /*****************************************************/
 size_t File::ReadBytesMax(char* buffer, const uint64_t offset, const size_t maxLength, const SharedLock& thisLock)
 {    
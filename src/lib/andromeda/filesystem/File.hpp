@@ -136,8 +136,63 @@ public:
      */
     virtual void Truncate(uint64_t newSize, const SharedLockW& thisLock) final;
 
+    /** Starts the flush, a random-write file's dirty pages are written back in the background (see WaitFlush) */
     void FlushCache(const SharedLockW& thisLock, bool nothrow = false) override;
 
+    /** Sets the cache class for this file's data from now on (see CacheManager::GetCacheClass) */
+    void SetCacheClass(size_t cacheClass);
+
+    /** Returns the cache class for this file's data, or PageManager::NO_CACHE_CLASS if never set */
+    [[nodiscard]] size_t GetCacheClass() const;
+
+    /** Application advice for how the file's data will be read, like posix_fadvise() */
+    enum class Advice : uint8_t
+    {
+        /** Detect the access pattern to size read-ahead (the default) */
+        NORMAL,
+        /** Always read ahead the maximum */
+        SEQUENTIAL,
+        /** Never read ahead */
+        RANDOM,
+        /** Read ahead as normal, but evict pages before others once read */
+        NOCACHE
+    };
+
+    /** Sets the advice for how the file's data will be read from now on */
+    void SetAdvice(Advice advice, const SharedLock& thisLock);
+
+    /** 
+     * Starts reading the given byte range into the cache in the background (like POSIX_FADV_WILLNEED)
+     * A zero length means up to the end of the file.  Does nothing if the cache is disabled.
+     */
+    void Prefetch(uint64_t offset, uint64_t length, const SharedLock& thisLock);
+
+    /** 
+     * Informs the parent folder that this file was opened (see Folder::InformFileOpen)
+     * Must not be called with any item locks held
+     */
+    void InformOpen();
+
+    /** 
+     * Cancels any reads from the backend still in progress at or after the given offset, e.g. 
+     * when closing or before truncating.  Call without the file lock, as getting it waits for them
+     */
+    void CancelFetches(uint64_t offset = 0);
+
+    /** 
+     * Drops pages in the given byte range from the cache, writing back dirty ones (like POSIX_FADV_DONTNEED)
+     * A zero length means up to the end of the file
+     * @throws BackendException for backend issues
+     */
+    void DropCache(uint64_t offset, uint64_t length, const SharedLockW& thisLock);
+
+    /** 
+     * Waits for any background write-back started by FlushCache() to finish
+     * Does not need the file lock (hold a ScopeLocked), so other readers/writers aren't blocked
+     * @throws BackendException if any failed since the last wait (the pages stay dirty for the next flush)
+     */
+    void WaitFlush();
+
 protected:
 
     void SubDelete(const DeleteLock& deleteLock) override;
@@ -164,8 +219,9 @@ private:
     /** Calls WriteBytes() with zeroes until the file size equals offset */
     void FillWriteHole(uint64_t offset, const SharedLockW& thisLock);
 
-    std::unique_ptr<Filedata::PageManager> mPageManager;
+    // the PageManager must be destroyed first, as it finishes its fetches and flushes with the PageBackend
     std::unique_ptr<Filedata::PageBackend> mPageBackend;
+    std::unique_ptr<Filedata::PageManager> mPageManager;
 
     mutable Debug mDebug;
 };
@@ -1,13 +1,18 @@
 
+#include <algorithm>
 #include <thread>
 #include <utility>
+#include <vector>
 #include "nlohmann/json.hpp"
 
 #include "Folder.hpp"
 #include "andromeda/ConfigOptions.hpp"
 #include "andromeda/StringUtil.hpp"
 #include "andromeda/backend/BackendImpl.hpp"
+#include "andromeda/filesystem/filedata/BandwidthEstimator.hpp"
+#include "andromeda/filesystem/filedata/CacheManager.hpp"
 using Andromeda::Backend::BackendImpl;
+using Andromeda::Filesystem::Filedata::CacheManager;
 
 namespace Andromeda {
 namespace Filesystem {
@@ -342,5 +347,52 @@ void Folder::FlushCache(const SharedLockW& thisLock, bool nothrow)
     }
 }
 
+/*****************************************************/
+void Folder::InformFileOpen(const std::string& name)
+{
+    const ConfigOptions& options { mBackend.GetOptions() };
+    if (!options.prefetchSiblings || options.cacheType == ConfigOptions::CacheType::NONE) return;
+
+    std::vector<File::ScopeLocked> siblings; { // lock scope
+        const SharedLockR thisLock { GetReadLock() };
+        const UniqueLock openLock(mOpenMutex);
+
+        if (!mSiblingPattern.RecordOpen(name)) return;
+        ITDBG_INFO("(name:" << name << ") openRun:" << mSiblingPattern.GetOpenRun());
+
+        // keep the next prefetchSiblings files prefetched, only the new ones need starting
+        size_t count { 0 };
+        for (ItemMap::const_iterator it { mItemMap.upper_bound(name) }; 
+            it != mItemMap.end() && count < options.prefetchSiblings; ++it)
+        {
+            if (it->second->GetType() != Type::FILE) continue;
+            ++count;
+
+            if (!mSiblingPattern.StartPrefetch(it->first)) continue;
+
+            Item::ScopeLocked sibling { it->second->TryLockScope() };
+            if (sibling) siblings.emplace_back(File::ScopeLocked::FromBase(std::move(sibling)));
+        }
+    }
+
+    if (siblings.empty()) return;
+
+    // fetch as much as one read-ahead request of each (or the whole file if small), and
+    // like a read-ahead, don't let all the siblings together take more than a fraction of the cache
+    size_t maxBytes { mBackend.GetReadBandwidth().GetRequestBytes(options.readAheadTime) };
+    const CacheManager* const cacheMgr { mBackend.GetCacheManager() };
+    if (cacheMgr != nullptr) maxBytes = std::min(maxBytes, 
+        cacheMgr->GetMemoryLimit()/options.readMaxCacheFrac/options.prefetchSiblings);
+
+    for (File::ScopeLocked& sibling : siblings)
+    {
+        // at least the first page, using the sibling's own page size (see File::CalcPageSize)
+        const uint64_t bytes { std::max(sibling->GetPageSize(), maxBytes) };
+        const SharedLockR siblingLock { sibling->GetReadLock() };
+        ITDBG_INFO("... prefetch " << sibling->GetName(siblingLock));
+        sibling->Prefetch(0, std::min(sibling->GetSize(siblingLock), bytes), siblingLock);
+    }
+}
+
 } // namespace Filesystem
 } // namespace Andromeda
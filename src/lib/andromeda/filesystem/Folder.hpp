@@ -13,6 +13,7 @@
 #include "File.hpp"
 #include "andromeda/Debug.hpp"
 #include "andromeda/ScopeLocked.hpp"
+#include "andromeda/filesystem/filedata/SiblingPattern.hpp"
 
 namespace Andromeda {
 
@@ -120,6 +121,13 @@ public:
 
     void FlushCache(const Andromeda::SharedLockW& thisLock, bool nothrow = false) override;
 
+    /**
+     * Informs us that the given child file was opened, to detect files being opened in item order 
+     * (e.g. cp -r, tar, grep -r) and prefetch the start of the next ones (ConfigOptions prefetchSiblings)
+     * Must not be called with any item locks held (takes this and the siblings' read locks)
+     */
+    void InformFileOpen(const std::string& name);
+
 protected:
 
     /** 
@@ -231,6 +239,11 @@ private:
     /** Returns a map with write locks for all items, deadlock-safe */
     ItemLockMap LockItems(const SharedLockW& thisLock);
 
+    /** Detects child files being opened in item order */
+    Filedata::SiblingPattern mSiblingPattern;
+    /** Mutex that protects mSiblingPattern */
+    std::mutex mOpenMutex;
+
     mutable Debug mDebug;
 };
 
@@ -0,0 +1,165 @@
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "AccessPattern.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/*****************************************************/
+const char* AccessPattern::PatternToString(const Pattern pattern)
+{
+    switch (pattern)
+    {
+        case Pattern::SEQUENTIAL: return "SEQUENTIAL";
+        case Pattern::REVERSE:    return "REVERSE";
+        case Pattern::STRIDED:    return "STRIDED";
+        case Pattern::RANDOM:     return "RANDOM";
+        default:                  return "UNKNOWN";
+    }
+}
+
+/*****************************************************/
+AccessPattern::AccessPattern() :
+    mDebug(__func__,this) { }
+
+/*****************************************************/
+AccessPattern::Access AccessPattern::RecordAccess(const uint64_t index)
+{
+    ++mClock; ++mAccesses;
+    if (mReadAhead.erase(index, 1)) ++mReadAheadHits;
+
+    // find the stream this access continues - prefer one with an established
+    // stride, else one that only has a single access so far (most recent first)
+    Stream* match { nullptr }; bool exact { false };
+    for (size_t idx { 0 }; idx < mNumStreams; ++idx)
+    {
+        Stream& stream { mStreams[idx] };
+        if (index == stream.lastIndex) // same page again (e.g. small reads)
+        {
+            stream.lastUse = mClock;
+            return GetAccess(stream);
+        }
+
+        const int64_t delta { static_cast<int64_t>(index - stream.lastIndex) }; // two's complement
+        const bool isExact { stream.confidence > 0 && (delta == stream.stride ||
+            (stream.stride == 1 && delta > 1 && delta <= 1+SEQUENTIAL_SLACK) ||
+            (stream.stride == -1 && delta < -1 && delta >= -1-SEQUENTIAL_SLACK)) };
+        const bool isCandidate { !stream.confidence && delta >= -MAX_STRIDE && delta <= MAX_STRIDE };
+
+        if (isExact && (!exact || match->lastUse < stream.lastUse))
+            { match = &stream; exact = true; }
+        else if (isCandidate && !exact && (match == nullptr || match->lastUse < stream.lastUse))
+            { match = &stream; }
+    }
+
+    if (match == nullptr) // start a new stream, replacing the least recently used
+    {
+        Stream* newStream { nullptr };
+        if (mNumStreams < MAX_STREAMS) newStream = &mStreams[mNumStreams++];
+        else newStream = &*std::min_element(mStreams.begin(), mStreams.end(),
+            [](const Stream& a, const Stream& b){ return a.lastUse < b.lastUse; });
+
+        *newStream = { index, 0, 0, mClock };
+        mRandomScore = std::min(mRandomScore+1, RANDOM_MAX);
+
+        const Access access { GetAccess(*newStream) };
+        MDBG_INFO("(index:" << index << ") new stream " << PatternToString(access.pattern) << " randomScore:" << mRandomScore);
+        return access;
+    }
+
+    if (exact) match->confidence = std::min(match->confidence+1, MAX_CONFIDENCE);
+    else
+    {
+        match->stride = static_cast<int64_t>(index - match->lastIndex);
+        match->confidence = 1;
+    }
+    match->lastIndex = index;
+    match->lastUse = mClock;
+
+    if (match->confidence >= CONFIRM_COUNT)
+    {
+        ++mStreamAccesses;
+        if (mRandomScore) --mRandomScore;
+    }
+
+    const Access access { GetAccess(*match) };
+    MDBG_INFO("(index:" << index << ") " << PatternToString(access.pattern)
+        << " stride:" << access.stride << " confidence:" << access.confidence);
+    return access;
+}
+
+/*****************************************************/
+AccessPattern::Access AccessPattern::GetAccess(const Stream& stream) const
+{
+    if (mOverride != Pattern::UNKNOWN) // as if a stream that's gone on forever
+        return { mOverride, (mOverride == Pattern::SEQUENTIAL) ? 1 : 0, MAX_CONFIDENCE };
+
+    Pattern pattern { (mRandomScore >= RANDOM_THRESHOLD) ? Pattern::RANDOM : Pattern::UNKNOWN };
+    if (stream.confidence >= CONFIRM_COUNT)
+    {
+        if (stream.stride == 1) pattern = Pattern::SEQUENTIAL;
+        else if (stream.stride == -1) pattern = Pattern::REVERSE;
+        else pattern = Pattern::STRIDED;
+    }
+    return { pattern, stream.stride, stream.confidence };
+}
+
+/*****************************************************/
+size_t AccessPattern::GetWindow(const Access& access, const size_t fetchSize)
+{
+    switch (access.pattern)
+    {
+        case Pattern::RANDOM: return 1;
+        case Pattern::STRIDED: return std::min(fetchSize, MAX_STRIDED_PAGES);
+        case Pattern::SEQUENTIAL: case Pattern::REVERSE:
+        {
+            // the longer a stream goes on, the more likely it is to keep going
+            const size_t scale { 1 + (access.confidence-CONFIRM_COUNT)/SCALE_STEP };
+            return fetchSize * scale;
+        }
+        default: return fetchSize;
+    }
+}
+
+/*****************************************************/
+void AccessPattern::AddReadAhead(const uint64_t index, const size_t count)
+{
+    mReadAhead.insert(index, count);
+    mReadAheadPages += count;
+}
+
+/*****************************************************/
+void AccessPattern::RemovePages(const uint64_t index, const size_t count)
+{
+    if (mReadAhead.empty()) return;
+    mReadAheadWasted += mReadAhead.erase(index, count);
+}
+
+/*****************************************************/
+void AccessPattern::CancelReadAhead(const uint64_t index, const size_t count)
+{
+    if (mReadAhead.empty()) return;
+    mReadAheadPages -= mReadAhead.erase(index, count);
+}
+
+/*****************************************************/
+bool AccessPattern::HasRecentStream(const uint64_t index, const size_t count, const size_t gap) const
+{
+    for (size_t idx { 0 }; idx < mNumStreams; ++idx)
+    {
+        const Stream& stream { mStreams[idx] };
+        if (mClock - stream.lastUse >= STALE_ACCESSES) continue; // abandoned
+
+        const uint64_t stride { static_cast<uint64_t>(std::abs(stream.stride)) };
+        const uint64_t reach { (stride > 1) ? std::max(static_cast<uint64_t>(gap), stride*MAX_STRIDED_PAGES) : gap };
+        if (stream.lastIndex + reach >= index && stream.lastIndex < index + count + reach) return true;
+    }
+    return false;
+}
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
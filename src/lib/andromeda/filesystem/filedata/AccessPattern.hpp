@@ -0,0 +1,181 @@
+
+#ifndef LIBA2_ACCESSPATTERN_H_
+#define LIBA2_ACCESSPATTERN_H_
+
+#include <array>
+#include <cstdint>
+
+#include "andromeda/Debug.hpp"
+#include "andromeda/RangeMap.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/**
+ * Classifies page reads of a single file into streams to drive read-ahead
+ * Tracks up to MAX_STREAMS interleaved streams, each with its own stride, so e.g.
+ * two readers of one file each get a sequential stream.  Accesses that don't
+ * continue any stream raise a random score that collapses read-ahead to zero.
+ * Also keeps count of read-ahead pages that were later used vs. thrown away.
+ * NOT THREAD SAFE (protect externally)
+ */
+class AccessPattern
+{
+public:
+
+    /** The detected access pattern for a stream */
+    enum class Pattern : uint8_t
+    {
+        /** Not enough history to say (use the default read-ahead) */
+        UNKNOWN,
+        /** Consecutive increasing pages */
+        SEQUENTIAL,
+        /** Consecutive decreasing pages */
+        REVERSE,
+        /** Pages a fixed distance apart */
+        STRIDED,
+        /** No detectable pattern (no read-ahead) */
+        RANDOM
+    };
+
+    /** Returns the name of the given pattern for debugging */
+    static const char* PatternToString(Pattern pattern);
+
+    /** The classification of a single access */
+    struct Access
+    {
+        Pattern pattern;
+        /** The page distance between accesses in the stream (0 if unknown) */
+        int64_t stride;
+        /** The number of times the stream's stride has repeated */
+        size_t confidence;
+    };
+
+    explicit AccessPattern();
+
+    /** Records a read of the given page index and returns its classification */
+    Access RecordAccess(uint64_t index);
+
+    /**
+     * Classifies every access as the given pattern from now on, e.g. from application advice
+     * Streams are still tracked underneath - UNKNOWN goes back to detecting the pattern
+     * @param pattern SEQUENTIAL (maximum read-ahead), RANDOM (none) or UNKNOWN
+     */
+    inline void SetOverride(const Pattern pattern) { mOverride = pattern; }
+
+    /**
+     * Returns the number of pages to read ahead for the given access
+     * For SEQUENTIAL/REVERSE this is the (scaled) contiguous window, for STRIDED the number
+     * of strided pages, for RANDOM always 1 (only the page itself)
+     * @param fetchSize the bandwidth-based default window - never zero
+     */
+    static size_t GetWindow(const Access& access, size_t fetchSize);
+
+    /** Records that the given range of pages is being read ahead (not yet accessed) */
+    void AddReadAhead(uint64_t index, size_t count);
+
+    /** Informs us that the given range of pages was dropped, counting any unused read-ahead as wasted */
+    void RemovePages(uint64_t index, size_t count);
+
+    /** Forgets the given range of pages as read-ahead without counting them as wasted (e.g. failed fetch) */
+    void CancelReadAhead(uint64_t index, size_t count);
+
+    /** Returns true if the given page was read ahead and not yet accessed */
+    [[nodiscard]] inline bool isReadAhead(const uint64_t index) const { return mReadAhead.contains(index); }
+
+    /**
+     * Returns true if a stream that is still being accessed might yet read the given range of pages - its
+     * last access is within gap pages of the range (or its strided read-ahead distance), else a read-ahead
+     * of the range is obsolete (the reader has moved elsewhere)
+     */
+    [[nodiscard]] bool HasRecentStream(uint64_t index, size_t count, size_t gap) const;
+
+    /** A copy of some member variables for debugging */
+    struct Stats
+    {
+        /** Total number of accesses recorded */
+        uint64_t accesses;
+        /** Number of accesses that continued a confirmed stream */
+        uint64_t streamAccesses;
+        /** Total number of pages read ahead */
+        uint64_t readAheadPages;
+        /** Number of read-ahead pages that were later accessed */
+        uint64_t readAheadHits;
+        /** Number of read-ahead pages that were dropped without being accessed */
+        uint64_t readAheadWasted;
+    };
+    /** Returns a copy of some member variables for debugging */
+    inline Stats GetStats() const
+    {
+        return { mAccesses, mStreamAccesses, mReadAheadPages, mReadAheadHits, mReadAheadWasted };
+    }
+
+private:
+
+    /** A detected stream of accesses */
+    struct Stream
+    {
+        /** The last page index accessed */
+        uint64_t lastIndex;
+        /** The distance between the last two accesses (0 if only one) */
+        int64_t stride;
+        /** The number of times the stride has repeated */
+        size_t confidence;
+        /** The value of mClock when last accessed (for replacement) */
+        uint64_t lastUse;
+    };
+
+    /** Returns the classification of the given stream */
+    Access GetAccess(const Stream& stream) const;
+
+    /** Maximum number of interleaved streams to track */
+    static constexpr size_t MAX_STREAMS { 8 };
+    /** Maximum page distance to consider as a stride */
+    static constexpr int64_t MAX_STRIDE { 64 };
+    /** Forward page gap still considered sequential (e.g. pages the kernel already had) */
+    static constexpr int64_t SEQUENTIAL_SLACK { 2 };
+    /** Number of stride repeats before a stream is trusted */
+    static constexpr size_t CONFIRM_COUNT { 2 };
+    /** Maximum stream confidence (limits the read-ahead scale) */
+    static constexpr size_t MAX_CONFIDENCE { 16 };
+    /** Stream confidence increase per additional read-ahead window multiple */
+    static constexpr size_t SCALE_STEP { 4 };
+    /** Maximum number of strided pages to read ahead */
+    static constexpr size_t MAX_STRIDED_PAGES { 8 };
+    /** Number of accesses after which a stream not continued is considered abandoned
+     * (enough for each of MAX_STREAMS interleaved readers to have continued their own) */
+    static constexpr uint64_t STALE_ACCESSES { MAX_STREAMS };
+    /** Maximum value of mRandomScore */
+    static constexpr size_t RANDOM_MAX { 8 };
+    /** Value of mRandomScore at which untrusted accesses are RANDOM */
+    static constexpr size_t RANDOM_THRESHOLD { 4 };
+
+    /** Array of tracked streams (first mNumStreams are valid) */
+    std::array<Stream, MAX_STREAMS> mStreams { };
+    /** The number of valid streams in mStreams */
+    size_t mNumStreams { 0 };
+    /** Logical clock incremented every access */
+    uint64_t mClock { 0 };
+    /** Up for accesses that start a new stream, down for confirmed ones */
+    size_t mRandomScore { 0 };
+    /** The pattern all accesses are classified as, if not UNKNOWN (see SetOverride) */
+    Pattern mOverride { Pattern::UNKNOWN };
+
+    /** Set of pages that were read ahead and not yet accessed */
+    RangeSet<uint64_t> mReadAhead;
+
+    uint64_t mAccesses { 0 };
+    uint64_t mStreamAccesses { 0 };
+    uint64_t mReadAheadPages { 0 };
+    uint64_t mReadAheadHits { 0 };
+    uint64_t mReadAheadWasted { 0 };
+
+    mutable Debug mDebug;
+};
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
+
+#endif // LIBA2_ACCESSPATTERN_H_
@@ -0,0 +1,133 @@
+
+#include <algorithm>
+#include <cmath>
+
+#include "BandwidthEstimator.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+namespace { // anonymous
+
+/** Adds a value to an exponentially weighted mean and variance (the first value sets the mean) */
+void UpdateAverage(double& mean, double& var, const double value, const double weight, const bool first)
+{
+    if (first) { mean = value; var = 0; return; }
+    const double diff { value - mean };
+    mean += weight*diff;
+    var = (1-weight)*(var + weight*diff*diff);
+}
+
+} // namespace
+
+/*****************************************************/
+BandwidthEstimator::BandwidthEstimator(const char* debugName) :
+    mDebug(std::string(__func__)+"_"+debugName,this) { }
+
+/*****************************************************/
+void BandwidthEstimator::AddSample(const size_t bytes, const std::chrono::steady_clock::duration& time)
+{
+    const double seconds { std::chrono::duration<double>(time).count() };
+    MDBG_INFO("(bytes:" << bytes << " time(ms):" << seconds*1000 << ")");
+    if (!bytes || seconds <= 0) return; // useless
+
+    const double size { static_cast<double>(bytes) };
+    const UniqueLock lock(mMutex);
+
+    const bool first { mSamples == 0 };
+    if (first) { mBytesMean = size; mTimeMean = seconds; }
+    else
+    {
+        const double bytesDiff { size - mBytesMean };
+        const double timeDiff { seconds - mTimeMean };
+        mBytesMean += SAMPLE_WEIGHT*bytesDiff;
+        mTimeMean += SAMPLE_WEIGHT*timeDiff;
+        mBytesVar = (1-SAMPLE_WEIGHT)*(mBytesVar + SAMPLE_WEIGHT*bytesDiff*bytesDiff);
+        mCovar = (1-SAMPLE_WEIGHT)*(mCovar + SAMPLE_WEIGHT*bytesDiff*timeDiff);
+    }
+    ++mSamples;
+
+    // the slope of time over size is the inverse bandwidth, what's left of each sample is latency
+    // if the sizes are all about the same the two can't be told apart, assume no latency
+    const double spread { LATENCY_SPREAD*mBytesMean };
+    if (mBytesVar > spread*spread && mCovar > 0)
+    {
+        const double slope { mCovar/mBytesVar };
+        const double latency { std::clamp(seconds - size*slope, 0.0, seconds) };
+        UpdateAverage(mLatencyMean, mLatencyVar, latency, SAMPLE_WEIGHT, !mHasLatency);
+        mHasLatency = true;
+    }
+
+    const double transfer { std::max(seconds - mLatencyMean, seconds*MIN_TRANSFER_FRAC) };
+    UpdateAverage(mBandwidthMean, mBandwidthVar, size/transfer, SAMPLE_WEIGHT, first);
+
+    MDBG_INFO("... latency(ms):" << mLatencyMean*1000 << " (dev " << std::sqrt(mLatencyVar)*1000 << ")"
+        << " bandwidth:" << mBandwidthMean/1048576 << " MiB/s (dev " << std::sqrt(mBandwidthVar)/1048576 << ")");
+}
+
+/*****************************************************/
+bool BandwidthEstimator::HasSamples() const
+{
+    const UniqueLock lock(mMutex);
+    return mSamples > 0;
+}
+
+/*****************************************************/
+double BandwidthEstimator::GetLatency() const
+{
+    const UniqueLock lock(mMutex);
+    return GetLatency(lock);
+}
+
+/*****************************************************/
+double BandwidthEstimator::GetLatency(const UniqueLock& lock) const
+{
+    return mLatencyMean + std::sqrt(mLatencyVar);
+}
+
+/*****************************************************/
+double BandwidthEstimator::GetBandwidth() const
+{
+    const UniqueLock lock(mMutex);
+    return GetBandwidth(lock);
+}
+
+/*****************************************************/
+double BandwidthEstimator::GetBandwidth(const UniqueLock& lock) const
+{
+    // don't let a very noisy link take the estimate to nothing
+    return std::max(mBandwidthMean - std::sqrt(mBandwidthVar), mBandwidthMean/2);
+}
+
+/*****************************************************/
+size_t BandwidthEstimator::GetTimeBytes(const milliseconds& time) const
+{
+    const UniqueLock lock(mMutex);
+    return GetTimeBytes(time, lock);
+}
+
+/*****************************************************/
+size_t BandwidthEstimator::GetTimeBytes(const milliseconds& time, const UniqueLock& lock) const
+{
+    const double seconds { std::chrono::duration<double>(time).count() };
+    const double transfer { std::max(seconds - GetLatency(lock), seconds*MIN_TRANSFER_FRAC) };
+    return static_cast<size_t>(GetBandwidth(lock)*transfer);
+}
+
+/*****************************************************/
+size_t BandwidthEstimator::GetRequestBytes(const milliseconds& maxTime) const
+{
+    const UniqueLock lock(mMutex);
+
+    const size_t maxBytes { GetTimeBytes(maxTime, lock) };
+    if (!mHasLatency) return maxBytes; // unknown latency, use the time
+
+    const size_t bdpBytes { static_cast<size_t>(LATENCY_FACTOR*GetBandwidth(lock)*GetLatency(lock)) };
+    MDBG_INFO("(maxTime:" << maxTime.count() << ") maxBytes:" << maxBytes << " bdpBytes:" << bdpBytes);
+    return std::min(bdpBytes, maxBytes);
+}
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,100 @@
+#ifndef LIBA2_BANDWIDTHESTIMATOR_H_
+#define LIBA2_BANDWIDTHESTIMATOR_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "andromeda/Debug.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/**
+ * Estimates the request latency and throughput of a transfer channel (e.g. a backend's runners)
+ * from timed transfers, to calculate the ideal size for network transfers.  Shared by everything using
+ * the channel so new users (e.g. a newly opened file) start from what was already learned.
+ *
+ * Each transfer is modeled as time = latency + bytes/bandwidth.  The latency is fit from exponentially
+ * weighted moments of the sample sizes and times (only when the sizes vary enough to tell the two apart,
+ * else it stays 0) and the bandwidth is the weighted average of bytes over time minus latency.
+ * Both also keep a weighted variance so that estimates can be conservative on a noisy link.
+ * THREAD SAFE (INTERNAL LOCKS)
+ */
+class BandwidthEstimator
+{
+public:
+
+    using milliseconds = std::chrono::milliseconds;
+
+    explicit BandwidthEstimator(const char* debugName);
+
+    /** Adds a measurement of a single transfer (one runner/stream) of the given bytes */
+    void AddSample(size_t bytes, const std::chrono::steady_clock::duration& time);
+
+    /** Returns true if any samples were added */
+    bool HasSamples() const;
+
+    /** Returns the estimated latency of each request, plus one standard deviation (seconds) */
+    double GetLatency() const;
+
+    /** Returns the estimated transfer bandwidth, minus one standard deviation (bytes/second) */
+    double GetBandwidth() const;
+
+    /** Returns the estimated bytes one request can transfer in the given time, or 0 if no samples */
+    size_t GetTimeBytes(const milliseconds& time) const;
+
+    /**
+     * Returns the ideal size of one request - a multiple of the bandwidth-delay product so that latency
+     * is only a small fraction of the request time, but no more than maxTime worth.  0 if no samples.
+     */
+    size_t GetRequestBytes(const milliseconds& maxTime) const;
+
+private:
+
+    using UniqueLock = std::unique_lock<std::mutex>;
+
+    double GetLatency(const UniqueLock& lock) const;
+    double GetBandwidth(const UniqueLock& lock) const;
+    size_t GetTimeBytes(const milliseconds& time, const UniqueLock& lock) const;
+
+    /** The weight of each new sample in the moving averages (0-1) */
+    static constexpr double SAMPLE_WEIGHT { 0.25 };
+    /** The minimum ratio of sample size deviation to mean needed to fit the latency */
+    static constexpr double LATENCY_SPREAD { 0.25 };
+    /** The request size as a multiple of the bandwidth-delay product (4 means latency is ~20% of the time) */
+    static constexpr double LATENCY_FACTOR { 4 };
+    /** The minimum fraction of a sample's time that is considered transfer (not latency) */
+    static constexpr double MIN_TRANSFER_FRAC { 0.1 };
+
+    mutable std::mutex mMutex;
+
+    /** The number of samples added */
+    uint64_t mSamples { 0 };
+
+    /** Weighted mean and variance of sample sizes (bytes) */
+    double mBytesMean { 0 };
+    double mBytesVar { 0 };
+    /** Weighted mean of sample times (seconds) */
+    double mTimeMean { 0 };
+    /** Weighted covariance of sample sizes and times */
+    double mCovar { 0 };
+
+    /** True if the latency has been fit from the samples */
+    bool mHasLatency { false };
+    /** Weighted mean and variance of the request latency (seconds) */
+    double mLatencyMean { 0 };
+    double mLatencyVar { 0 };
+    /** Weighted mean and variance of the transfer bandwidth (bytes/second) */
+    double mBandwidthMean { 0 };
+    double mBandwidthVar { 0 };
+
+    mutable Debug mDebug;
+};
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
+
+#endif // LIBA2_BANDWIDTHESTIMATOR_H_
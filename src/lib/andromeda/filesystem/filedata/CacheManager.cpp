@@ -1,32 +1,64 @@
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <functional>
+#include <numeric>
 
+#include "BandwidthEstimator.hpp"
 #include "CacheManager.hpp"
 #include "CacheOptions.hpp"
 #include "CachingAllocator.hpp"
+#include "DiskCache.hpp"
+#include "EvictPolicy.hpp"
 #include "Page.hpp"
 #include "PageManager.hpp"
 
 #include "andromeda/StringUtil.hpp"
 #include "andromeda/backend/BackendException.hpp"
+#include "andromeda/backend/BackendImpl.hpp"
+#include "andromeda/backend/RunnerPool.hpp"
 using Andromeda::Backend::BackendException;
+using Andromeda::Backend::RunnerPool;
 
 namespace Andromeda {
 namespace Filesystem {
 namespace Filedata {
 
 /*****************************************************/
-CacheManager::CacheManager(const CacheOptions& cacheOptions, bool startThreads) : 
+CacheManager::CacheManager(const CacheOptions& cacheOptions, bool startThreads, std::unique_ptr<MemoryPressure> memoryPressure) : 
     mDebug(__func__,this),
     mCacheOptions(cacheOptions),
-    mBandwidth(__func__, cacheOptions.maxDirtyTime)
+    mMemoryLimit(cacheOptions.memoryLimit)
 { 
-    MDBG_INFO("()");
+    MDBG_INFO("(evictPolicy:" << EvictPolicy::TypeToString(mCacheOptions.evictType) 
+        << " flushThreads:" << mCacheOptions.flushThreads << " cacheClasses:" << mCacheOptions.cacheClasses.size() << ")");
+
+    mMemoryPressure = (memoryPressure != nullptr) ? std::move(memoryPressure) : 
+        MemoryPressure::Create(mCacheOptions.pressureSource);
+    if (mMemoryPressure == nullptr && mCacheOptions.pressureSource != CacheOptions::PressureSource::NONE)
+        { MDBG_ERROR("... memory pressure unavailable, using a fixed limit"); }
+
+    mCacheClasses = mCacheOptions.cacheClasses;
+    if (mCacheClasses.empty()) mCacheClasses.push_back({"default", 0, 0, 0});
+
+    for (size_t cacheClass { 0 }; cacheClass < mCacheClasses.size(); ++cacheClass)
+        mEvictPolicies.emplace_back(EvictPolicy::Create(mCacheOptions.evictType, 
+            GetPolicyCapacity(cacheClass, mCacheOptions.memoryLimit)));
+    mClassTotals.resize(mCacheClasses.size(), 0);
+    mFlushWorkers.resize(std::max(mCacheOptions.flushThreads, static_cast<uint32_t>(1)));
 
     const size_t memoryLimit { mCacheOptions.memoryLimit };
     const size_t allocBaseline { memoryLimit - memoryLimit/mCacheOptions.evictSizeFrac };
-    mPageAllocator = std::make_unique<CachingAllocator>(allocBaseline);
+
+    HugePageOptions hugeOptions;
+    hugeOptions.enable = mCacheOptions.hugePages;
+    hugeOptions.reserve = mCacheOptions.hugeReserve;
+    hugeOptions.lock = mCacheOptions.lockMemory;
+    mPageAllocator = std::make_unique<CachingAllocator>(allocBaseline, hugeOptions);
+
+    if (!mCacheOptions.diskPath.empty())
+        mDiskCache = std::make_unique<DiskCache>(mCacheOptions.diskPath, mCacheOptions.diskLimit);
 
     if (startThreads) StartThreads();
 }
@@ -34,7 +66,52 @@ CacheManager::CacheManager(const CacheOptions& cacheOptions, bool startThreads)
 /*****************************************************/
 size_t CacheManager::GetMemoryLimit() const
 { 
-    return mCacheOptions.memoryLimit; 
+    return mMemoryLimit.load(std::memory_order_relaxed); 
+}
+
+/*****************************************************/
+void CacheManager::UpdateMemoryLimit()
+{
+    const UniqueLock lock(mMutex);
+    if (mMemoryPressure == nullptr) return;
+
+    UpdateMemoryLimit(lock);
+    if (ShouldEvict(lock)) mEvictThreadCV.notify_one();
+}
+
+/*****************************************************/
+void CacheManager::UpdateMemoryLimit(const UniqueLock& lock)
+{
+    mPressureTime = std::chrono::steady_clock::now();
+    MemoryPressure::Reading reading { };
+    if (!mMemoryPressure->Read(reading)) return;
+
+    const size_t maxLimit { mCacheOptions.memoryLimit };
+    const size_t minLimit { std::min(mCacheOptions.memoryMin, maxLimit) };
+    const size_t step { maxLimit/mCacheOptions.evictSizeFrac };
+    const size_t oldLimit { mMemoryLimit.load(std::memory_order_relaxed) };
+    const uint64_t reserve { reading.total/PRESSURE_RESERVE_FRAC };
+
+    // aim to leave the reserve available, using half of what's spare beyond it
+    const size_t total { GetTotalMemory(lock) };
+    size_t target { (reading.available >= reserve) ? 
+        total + static_cast<size_t>(std::min<uint64_t>((reading.available-reserve)/2, maxLimit)) :
+        total - static_cast<size_t>(std::min<uint64_t>(reserve-reading.available, total)) };
+
+    if (reading.stall >= PRESSURE_STALL) // tasks are already waiting on memory, give some back
+        target = std::min(target, total - std::min(step, total));
+
+    // grow a step at a time (avoids chasing our own usage), shrink right away
+    const size_t newLimit { std::clamp(std::min(target, oldLimit+step), minLimit, maxLimit) };
+    mMemoryLimit.store(newLimit, std::memory_order_relaxed);
+
+    // keep the policies' queue sizes in proportion, e.g. 2Q scan resistance matters most when memory is tight
+    if (newLimit != oldLimit)
+        for (size_t cacheClass { 0 }; cacheClass < mEvictPolicies.size(); ++cacheClass)
+            mEvictPolicies[cacheClass]->SetCapacity(GetPolicyCapacity(cacheClass, newLimit));
+
+    MDBG_INFO("(available:" << reading.available << " stall:" << reading.stall 
+        << ") memoryLimit:" << newLimit << " (was " << oldLimit << ")");
 }
 
 /*****************************************************/
@@ -50,10 +127,11 @@ CacheManager::~CacheManager()
         mEvictThread.join();
     }
 
-    if (mFlushThread.joinable())
+    mFlushThreadCV.notify_all();
+    for (FlushWorker& worker : mFlushWorkers)
     {
-        mFlushThreadCV.notify_one();
-        mFlushThread.join();
+        if (worker.mThread.joinable())
+            worker.mThread.join();
     }
 
     MDBG_INFO("... return");
@@ -67,8 +145,67 @@ void CacheManager::StartThreads()
     if (!mEvictThread.joinable()) // not running
         mEvictThread = std::thread(&CacheManager::EvictThread, this);
 
-    if (!mFlushThread.joinable()) // not running
-        mFlushThread = std::thread(&CacheManager::FlushThread, this);
+    for (FlushWorker& worker : mFlushWorkers)
+    {
+        if (!worker.mThread.joinable()) // not running
+            worker.mThread = std::thread(&CacheManager::FlushThread, this, std::ref(worker));
+    }
+}
+
+/*****************************************************/
+CacheManager::Stats CacheManager::GetStats() const
+{
+    const CachingAllocator::Stats allocStats { mPageAllocator->GetStats() };
+
+    const UniqueLock lock(mMutex); 
+    return { mCurrentTotal, mTableMemory.load(std::memory_order_relaxed), mMemoryLimit.load(std::memory_order_relaxed), mPageMap.size(), 
+        mCurrentDirty, mDirtyLimit, mDirtyQueue.size(),
+        allocStats.curFree, allocStats.largestFree }; 
+}
+
+/*****************************************************/
+size_t CacheManager::GetCacheClass(const std::string& path, const uint32_t uid, const std::string& process) const
+{
+    for (const CacheOptions::CacheRule& rule : mCacheOptions.cacheRules)
+    {
+        bool match { false };
+        switch (rule.type)
+        {
+            case CacheOptions::CacheRule::Type::PATH:    match = StringUtil::startsWith(path, rule.match); break;
+            case CacheOptions::CacheRule::Type::UID:     match = (rule.match == std::to_string(uid)); break;
+            case CacheOptions::CacheRule::Type::PROCESS: match = (rule.match == process); break;
+            default: break;
+        }
+
+        if (match)
+        {
+            MDBG_INFO("(path:" << path << " uid:" << uid << " process:" << process << ") class:" << rule.classIdx);
+            return rule.classIdx;
+        }
+    }
+    return 0;
+}
+
+/*****************************************************/
+bool CacheManager::HasProcessRules() const
+{
+    return std::any_of(mCacheOptions.cacheRules.cbegin(), mCacheOptions.cacheRules.cend(), 
+        [](const CacheOptions::CacheRule& rule){ return rule.type == CacheOptions::CacheRule::Type::PROCESS; });
+}
+
+/*****************************************************/
+size_t CacheManager::MergeCacheClass(const size_t current, const size_t opened) const
+{
+    if (current >= mCacheClasses.size()) return opened;
+    if (opened >= mCacheClasses.size()) return current;
+    return (mCacheClasses[current].priority > mCacheClasses[opened].priority) ? current : opened;
+}
+
+/*****************************************************/
+size_t CacheManager::GetCacheClass(const PageManager& pageMgr, const UniqueLock& lock) const
+{
+    const size_t cacheClass { pageMgr.GetCacheClass() };
+    return (cacheClass < mCacheClasses.size()) ? cacheClass : 0;
 }
 
 /*****************************************************/
@@ -76,6 +213,16 @@ void CacheManager::InformPage(PageManager& pageMgr, const uint64_t index, const
 {
     MDBG_INFO("(page:" << index << " " << &page << " canWait:" << BOOLSTR(canWait) << ")");
 
+    // fast path for hits - the size/dirty state is only changed with the page manager's
+    // exclusive lock, so if it already matches there's nothing to do but record the hit
+    Page::CacheState& state { page.getCacheState() };
+    const size_t cachedSize { state.size.load(std::memory_order_acquire) };
+    if (cachedSize && cachedSize == page.capacity() && state.dirty.load(std::memory_order_acquire) == dirty)
+    {
+        state.hit.store(mEpoch.load(std::memory_order_relaxed)+1, std::memory_order_relaxed);
+        return;
+    }
+
     UniqueLock lock(mMutex);
 
     const size_t oldSize { EnqueuePage(pageMgr, index, page, dirty, lock) };
@@ -92,14 +239,32 @@ void CacheManager::InformPage(PageManager& pageMgr, const uint64_t index, const
 /*****************************************************/
 size_t CacheManager::EnqueuePage(PageManager& pageMgr, const uint64_t index, const Page& page, bool dirty, const UniqueLock& lock) // cppcheck-suppress constParameterReference
 {
-    const size_t oldSize { RemovePage(page, lock) };
     const size_t newSize { page.capacity() }; // real memory usage
+    PageInfo pageInfo { pageMgr, index, newSize, GetCacheClass(pageMgr, lock) };
+    size_t oldSize { 0 };
 
-    const PageInfo pageInfo { pageMgr, index, newSize };
+    Page::CacheState& state { page.getCacheState() };
+    const uint64_t epoch { mEpoch.load(std::memory_order_relaxed) };
 
-    mPageQueue.enqueue_front(&page, pageInfo);
-    mCurrentTotal += newSize;
+    const PageMap::iterator itPage { mPageMap.find(&page) };
+    if (itPage != mPageMap.end()) // already cached
+    {
+        oldSize = itPage->second.mPageSize;
+        itPage->second.mPageSize = newSize;
+        pageInfo.mClass = itPage->second.mClass; // keeps its class
+        state.hit.store(0, std::memory_order_relaxed);
+        mEvictPolicies[pageInfo.mClass]->AccessPage(page, newSize, epoch);
+    }
+    else
+    {
+        mPageMap.emplace(&page, pageInfo);
+        mEvictPolicies[pageInfo.mClass]->AddPage(page, PageKey{&pageMgr, index}, newSize, epoch);
+        mEpoch.store(epoch+newSize, std::memory_order_relaxed);
+    }
+    mCurrentTotal += newSize-oldSize;
+    mClassTotals[pageInfo.mClass] += newSize-oldSize;
 
+    RemoveDirty(page, lock);
     PrintStatus(__func__, lock);
 
     if (dirty)
@@ -109,6 +274,9 @@ size_t CacheManager::EnqueuePage(PageManager& pageMgr, const uint64_t index, con
         PrintDirtyStatus(__func__, lock);
     }
 
+    state.dirty.store(dirty, std::memory_order_release);
+    state.size.store(newSize, std::memory_order_release);
+
     MDBG_INFO("... pageSize:" << page.size() 
         << " newSize:" << newSize << " oldSize:" << oldSize);
     return oldSize;
@@ -122,12 +290,15 @@ void CacheManager::ResizePage(const PageManager& pageMgr, const Page& page, cons
 
     UniqueLock lock(mMutex);
 
-    { const PageQueue::iterator itQueue { mPageQueue.find(&page) };
-    if (itQueue != mPageQueue.end()) 
+    { const PageMap::iterator itPage { mPageMap.find(&page) };
+    if (itPage != mPageMap.end()) 
     {
-        const size_t oldSize { itQueue->second.mPageSize };
+        const size_t oldSize { itPage->second.mPageSize };
         mCurrentTotal += newSize-oldSize;
-        itQueue->second.mPageSize = newSize;
+        mClassTotals[itPage->second.mClass] += newSize-oldSize;
+        itPage->second.mPageSize = newSize;
+        mEvictPolicies[itPage->second.mClass]->ResizePage(page, newSize);
+        page.getCacheState().size.store(newSize, std::memory_order_release);
 
         PrintStatus(__func__, lock);
         
@@ -158,14 +329,15 @@ void CacheManager::HandleMemory(const PageManager& pageMgr, const Page& page, bo
     {
         // in this case we can evict synchronously rather than the background thread
         // so we can directly pick up errors (they could be missed due to mSkipEvictWait)
-        while (ShouldEvict(lock) && 
-            &mPageQueue.back().second.mPageMgr == &pageMgr &&
-            mPageQueue.back().first != &page)
+        std::vector<const Page*> victims;
+        while (ShouldEvict(lock) && !(victims = GetVictims(1, lock)).empty() &&
+            &mPageMap.at(victims.front()).mPageMgr == &pageMgr && victims.front() != &page)
         {
+            const Page* const victim { victims.front() };
             MDBG_INFO("... memory limit! synchronous evict");
 
             PrintStatus(__func__, lock);
-            PageInfo pageInfo { mPageQueue.back().second }; // copy
+            PageInfo pageInfo { mPageMap.at(victim) }; // copy
 
             lock.unlock(); // don't hold lock during evict
             pageInfo.mPageMgr.EvictPage(pageInfo.mPageIndex, *mgrLock); // throws
@@ -201,7 +373,7 @@ void CacheManager::HandleDirtyMemory(const PageManager& pageMgr, const Page& pag
     if (mgrLock != nullptr && canWait)
     {
         // in this case we can evict synchronously rather than the background thread
-        // so we can directly pick up errors (they could be missed due to mSkipFlushWait)
+        // so we can directly pick up errors (they could be missed due to a FlushWorker's mSkipWait)
         while (ShouldFlush(lock) && 
             &mDirtyQueue.back().second.mPageMgr == &pageMgr &&
             mDirtyQueue.back().first != &page)
@@ -217,7 +389,7 @@ void CacheManager::HandleDirtyMemory(const PageManager& pageMgr, const Page& pag
         }
     }
 
-    if (mFlushThread.joinable())
+    if (mFlushWorkers.front().mThread.joinable())
     {
         if (canWait)
         {
@@ -240,7 +412,9 @@ void CacheManager::HandleDirtyMemory(const PageManager& pageMgr, const Page& pag
 /*****************************************************/
 bool CacheManager::ShouldAwaitEvict(const PageManager& pageMgr, const UniqueLock& lock) const
 {
-    const bool shouldEvict { ShouldEvict(lock) };
+    // wait for the total memory, or our own class being over its maximum (not others)
+    const bool shouldEvict { GetTotalMemory(lock) > mMemoryLimit.load(std::memory_order_relaxed) || 
+        IsOverMax(GetCacheClass(pageMgr, lock), lock) };
     if (shouldEvict && mEvictFailure != nullptr)
         throw MemoryException("evict");
 
@@ -269,6 +443,21 @@ void CacheManager::RemovePage(const Page& page)
     PrintDirtyStatus(__func__, lock);
 }
 
+/*****************************************************/
+void CacheManager::DemotePage(const Page& page)
+{
+    const UniqueLock lock(mMutex);
+
+    const PageMap::iterator itPage { mPageMap.find(&page) };
+    if (itPage != mPageMap.end())
+    {
+        MDBG_INFO("(page:" << &page << ")");
+        // forget any unrecorded hit, else GetVictims would give it another chance
+        page.getCacheState().hit.store(0, std::memory_order_relaxed);
+        mEvictPolicies[itPage->second.mClass]->DemotePage(page);
+    }
+}
+
 /*****************************************************/
 void CacheManager::RemoveDirty(const Page& page)
 {
@@ -282,13 +471,19 @@ void CacheManager::RemoveDirty(const Page& page)
 size_t CacheManager::RemovePage(const Page& page, const UniqueLock& lock)
 {
     size_t pageSize { 0 }; // size of page removed
-    const PageQueue::lookup_iterator itLookup { mPageQueue.lookup(&page) };
-    if (itLookup != mPageQueue.lend())
+    const PageMap::iterator itPage { mPageMap.find(&page) };
+    if (itPage != mPageMap.end())
     {
         MDBG_INFO("(page:" << &page << ")");
-        pageSize = itLookup->second->second.mPageSize;
+        pageSize = itPage->second.mPageSize;
         mCurrentTotal -= pageSize;
-        mPageQueue.erase(itLookup);
+        mClassTotals[itPage->second.mClass] -= pageSize;
+        mEvictPolicies[itPage->second.mClass]->RemovePage(page);
+        mPageMap.erase(itPage);
+
+        Page::CacheState& state { page.getCacheState() };
+        state.size.store(0, std::memory_order_release);
+        state.hit.store(0, std::memory_order_relaxed);
     }
 
     RemoveDirty(page, lock);
@@ -304,18 +499,120 @@ void CacheManager::RemoveDirty(const Page& page, const UniqueLock& lock)
         MDBG_INFO("(page:" << &page << ")");
         mCurrentDirty -= itLookup->second->second.mPageSize;
         mDirtyQueue.erase(itLookup);
+        page.getCacheState().dirty.store(false, std::memory_order_release);
     }
 }
 
+/*****************************************************/
+std::vector<size_t> CacheManager::GetEvictQuotas(const size_t bytes, const UniqueLock& lock) const
+{
+    const std::vector<CacheOptions::CacheClass>& classes { mCacheClasses };
+    std::vector<size_t> quotas(mClassTotals.size(), 0);
+    size_t total { 0 };
+
+    // first anything over a class's maximum (with the same margin as the memory limit)
+    for (size_t cacheClass { 0 }; cacheClass < quotas.size(); ++cacheClass)
+    {
+        if (!IsOverMax(cacheClass, lock)) continue;
+        const size_t maxBytes { classes[cacheClass].maxBytes };
+        quotas[cacheClass] = std::min(mClassTotals[cacheClass], 
+            mClassTotals[cacheClass] - maxBytes + maxBytes/mCacheOptions.evictSizeFrac);
+        total += quotas[cacheClass];
+    }
+
+    // then from the lowest priority classes, down to their minimum and then below it if we must
+    std::vector<size_t> order(quotas.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), 
+        [&](const size_t lhs, const size_t rhs){ return classes[lhs].priority < classes[rhs].priority; });
+
+    for (const bool belowMin : { false, true })
+    {
+        for (const size_t cacheClass : order)
+        {
+            if (total >= bytes) return quotas;
+            const size_t minBytes { belowMin ? 0 : classes[cacheClass].minBytes };
+            const size_t remaining { mClassTotals[cacheClass] - quotas[cacheClass] };
+            if (remaining <= minBytes) continue;
+
+            const size_t quota { std::min(remaining - minBytes, bytes - total) };
+            quotas[cacheClass] += quota;
+            total += quota;
+        }
+    }
+    return quotas;
+}
+
+/*****************************************************/
+std::vector<const Page*> CacheManager::GetVictims(const size_t bytes, const UniqueLock& lock)
+{
+    std::vector<const Page*> victims;
+    const std::vector<size_t> quotas { GetEvictQuotas(bytes, lock) };
+    for (size_t cacheClass { 0 }; cacheClass < quotas.size(); ++cacheClass)
+    {
+        if (!quotas[cacheClass]) continue;
+        EvictPolicy& evictPolicy { *mEvictPolicies[cacheClass] };
+
+        std::vector<const Page*> classVictims;
+        size_t granted { 0 }; // bound the sweep with concurrent hits
+        bool retry { true };
+        while (retry && granted < mPageMap.size())
+        {
+            retry = false;
+            classVictims = evictPolicy.GetVictims(quotas[cacheClass]);
+            for (const Page* victim : classVictims)
+            {
+                Page::CacheState& state { victim->getCacheState() };
+                const uint64_t hit { state.hit.exchange(0, std::memory_order_relaxed) };
+                if (hit) // was used, give it to the policy and choose again
+                {
+                    evictPolicy.AccessPage(*victim, mPageMap.at(victim).mPageSize, hit-1);
+                    retry = true; ++granted;
+                }
+            }
+        }
+
+        MDBG_INFO("... class:" << cacheClass << " quota:" << quotas[cacheClass] 
+            << " victims:" << classVictims.size() << " granted:" << granted);
+        victims.insert(victims.end(), classVictims.cbegin(), classVictims.cend());
+    }
+    return victims;
+}
+
+/*****************************************************/
+std::vector<const Page*> CacheManager::GetCleanVictims(const size_t bytes, const UniqueLock& lock)
+{
+    // look further down the eviction order, by as much as is dirty
+    const std::vector<const Page*> candidates { GetVictims(bytes + std::min(bytes, mCurrentDirty), lock) };
+
+    std::vector<const Page*> victims;
+    size_t total { 0 };
+    for (const bool dirty : { false, true })
+    {
+        for (const Page* candidate : candidates)
+        {
+            if (total >= bytes) return victims;
+            if ((mDirtyQueue.find(candidate) != mDirtyQueue.end()) != dirty) continue;
+
+            victims.push_back(candidate);
+            total += mPageMap.at(candidate).mPageSize;
+        }
+    }
+    return victims;
+}
+
 /*****************************************************/
 void CacheManager::PrintStatus(const char* const fname, const UniqueLock& lock)
 {
     mDebug.Info([&](std::ostream& str){ str << fname << "..."
-        << " pages:" << mPageQueue.size() << ", memory:" << mCurrentTotal; });
+        << " pages:" << mPageMap.size() << ", memory:" << mCurrentTotal 
+        << ", tables:" << mTableMemory.load(std::memory_order_relaxed); });
 
 #if DEBUG // this will kill performance
-    size_t total = 0; for (const PageQueue::value_type& pageInfo : mPageQueue) total += pageInfo.second.mPageSize;
+    size_t total = 0; for (const PageMap::value_type& pageInfo : mPageMap) total += pageInfo.second.mPageSize;
     if (total != mCurrentTotal){ MDBG_ERROR(": BAD MEMORY TRACKING! " << total << " != " << mCurrentTotal); assert(false); }
+    const size_t classTotal { std::accumulate(mClassTotals.cbegin(), mClassTotals.cend(), static_cast<size_t>(0)) };
+    if (classTotal != mCurrentTotal){ MDBG_ERROR(": BAD CLASS TRACKING! " << classTotal << " != " << mCurrentTotal); assert(false); }
 #endif // DEBUG
 }
 
@@ -357,16 +654,22 @@ SharedLockW CacheManager::GetPageManagerLock(PageManager& pageMgr, PageManager*&
 void CacheManager::EvictThread()
 {
     MDBG_INFO("()");
+    const RunnerPool::PriorityScope priority(RunnerPool::Priority::WRITEBACK);
 
     while (true)
     {
         { // lock scope
             UniqueLock lock(mMutex);
-            while (mRunCleanup.load() && (mCurrentTotal <= mCacheOptions.memoryLimit || mEvictFailure != nullptr))
+            if (IsPressureDue(lock)) UpdateMemoryLimit(lock);
+
+            while (mRunCleanup.load() && (!ShouldEvict(lock) || mEvictFailure != nullptr))
             {
                 MDBG_INFO("... waiting");
                 mEvictWaitCV.notify_all();
-                mEvictThreadCV.wait(lock);
+                if (mMemoryPressure == nullptr) mEvictThreadCV.wait(lock);
+                else mEvictThreadCV.wait_for(lock, PRESSURE_INTERVAL); // follow memory pressure
+
+                if (IsPressureDue(lock)) UpdateMemoryLimit(lock);
             }
             if (!mRunCleanup.load()) break; // stop loop
             MDBG_INFO("... DOING EVICTS!");
@@ -379,25 +682,28 @@ void CacheManager::EvictThread()
 }
 
 /*****************************************************/
-void CacheManager::FlushThread()
+void CacheManager::FlushThread(FlushWorker& worker)
 {
     MDBG_INFO("()");
+    const RunnerPool::PriorityScope priority(RunnerPool::Priority::WRITEBACK);
 
+    bool idle { false }; // other workers have all the dirty pages
     while (true)
     {
         { // lock scope
             UniqueLock lock(mMutex);
-            while (mRunCleanup.load() && (mCurrentDirty <= mDirtyLimit || mFlushFailure != nullptr))
+            while (mRunCleanup.load() && (idle || !ShouldFlushMore(lock) || mFlushFailure != nullptr))
             {
                 MDBG_INFO("... waiting");
                 mFlushWaitCV.notify_all();
                 mFlushThreadCV.wait(lock);
+                idle = false;
             }
             if (!mRunCleanup.load()) break; // stop loop
             MDBG_INFO("... DOING FLUSHES!");
         }
 
-        DoPageFlushes();
+        idle = !DoPageFlushes(worker);
     }
 
     MDBG_INFO("... exiting");
@@ -414,14 +720,18 @@ void CacheManager::DoPageEvictions() noexcept // thread cannot throw
         const UniqueLock lock(mMutex);
 
         PrintStatus(__func__, lock);
-        size_t cleaned { 0 };
 
-        PageQueue::reverse_iterator pageIt { mPageQueue.rbegin() };
-        const size_t margin { mCacheOptions.memoryLimit/mCacheOptions.evictSizeFrac };
-        for (; mCurrentTotal + margin > mCacheOptions.memoryLimit + cleaned; ++pageIt)
+        const size_t memoryLimit { mMemoryLimit.load(std::memory_order_relaxed) };
+        const size_t margin { memoryLimit/mCacheOptions.evictSizeFrac };
+        const size_t total { GetTotalMemory(lock) };
+        const size_t toClean { (total + margin > memoryLimit) ? total + margin - memoryLimit : 0 };
+
+        // under memory pressure, free memory as fast as possible
+        for (const Page* victim : (mMemoryPressure != nullptr) ? 
+            GetCleanVictims(toClean, lock) : GetVictims(toClean, lock))
         {
-            const Page& pageRef { *pageIt->first };
-            PageInfo& pageInfo { pageIt->second };
+            const Page& pageRef { *victim };
+            const PageInfo& pageInfo { mPageMap.at(victim) };
 
             const PageMgrPageMap::iterator evictIt { currentEvicts.find(&pageInfo.mPageMgr) };
             // get ScopeLock to make sure pageManager stays in scope between mMutex release and getting pageMgrW lock
@@ -430,11 +740,7 @@ void CacheManager::DoPageEvictions() noexcept // thread cannot throw
 
             if (!evictSet.first) // scope lock
                 RemovePage(pageRef, lock); // being deleted
-            else
-            {
-                evictSet.second.emplace_back(pageRef, pageInfo); // copy
-                cleaned += pageInfo.mPageSize;
-            }
+            else evictSet.second.emplace_back(pageRef, pageInfo); // copy
         }
     }
 
@@ -443,6 +749,10 @@ void CacheManager::DoPageEvictions() noexcept // thread cannot throw
     {
         LockedPageList& evictSet { evictIt->second };
         MDBG_INFO("... evicting pages:" << evictSet.second.size() << " pageMgr:" << evictIt->first);
+
+        // read-ahead evicted before it's used - stop its fetch rather than wait for the rest
+        for (const PageList::value_type& pagePair : evictSet.second)
+            evictIt->first->InformEvicting(pagePair.second.mPageIndex);
         const SharedLockW mgrLock { GetPageManagerLock(*evictIt->first, mSkipEvictWait) };
 
         for (const PageList::value_type& pagePair : evictSet.second)
@@ -475,45 +785,57 @@ void CacheManager::DoPageEvictions() noexcept // thread cannot throw
 }
 
 /*****************************************************/
-void CacheManager::DoPageFlushes() noexcept // thread cannot throw
+bool CacheManager::DoPageFlushes(FlushWorker& worker) noexcept // thread cannot throw
 {
     MDBG_INFO("()");
 
-    // FIRST build a list of pages to evict
-    PageMgrPageMap currentFlushes;
+    // FIRST pick the oldest page manager no other worker is flushing, and its pages to flush
+    LockedPageList flushSet;
+    size_t pending { 0 }; // our part of mFlushPending
     { // lock scope
         const UniqueLock lock(mMutex);
 
         PrintDirtyStatus(__func__, lock);
-        size_t cleaned { 0 };
+        std::vector<const Page*> deleted; // can't remove while iterating
 
-        PageQueue::reverse_iterator pageIt { mDirtyQueue.rbegin() };
-        for (; mCurrentDirty > mDirtyLimit + cleaned; ++pageIt)
+        for (PageQueue::reverse_iterator pageIt { mDirtyQueue.rbegin() }; 
+            pageIt != mDirtyQueue.rend() && ShouldFlushMore(lock); ++pageIt)
         {
             const Page& pageRef { *pageIt->first };
             PageInfo& pageInfo { pageIt->second };
 
-            const PageMgrPageMap::iterator flushIt { currentFlushes.find(&pageInfo.mPageMgr) };
-            // get ScopeLock to make sure pageManager stays in scope between mMutex release and getting pageMgrW lock
-            LockedPageList& flushSet { (flushIt != currentFlushes.end()) ? flushIt->second : currentFlushes.emplace(
-                &pageInfo.mPageMgr, std::make_pair(pageInfo.mPageMgr.TryLockScope(), PageList())).first->second };
-
-            if (!flushSet.first) // scope lock
-                RemovePage(pageRef, lock); // being deleted
-            else
+            if (worker.mFlushing == nullptr)
             {
-                flushSet.second.emplace_back(pageRef, pageInfo); // copy
-                cleaned += pageInfo.mPageSize;
+                if (IsFlushing(pageInfo.mPageMgr, lock)) continue; // another worker's
+
+                // get ScopeLock to make sure pageManager stays in scope between mMutex release and getting pageMgrW lock
+                flushSet.first = pageInfo.mPageMgr.TryLockScope();
+                if (!flushSet.first) { deleted.push_back(&pageRef); continue; } // being deleted
+                worker.mFlushing = &pageInfo.mPageMgr;
             }
+            else if (&pageInfo.mPageMgr != worker.mFlushing) continue;
+
+            flushSet.second.emplace_back(pageRef, pageInfo); // copy
+            pending += pageInfo.mPageSize;
+            mFlushPending += pageInfo.mPageSize;
+        }
+
+        for (const Page* page : deleted)
+            RemovePage(*page, lock);
+
+        if (worker.mFlushing == nullptr)
+        {
+            MDBG_INFO("... nothing to flush");
+            return false;
         }
+
+        if (ShouldFlushMore(lock)) // have another worker start on the next page manager
+            mFlushThreadCV.notify_one();
     }
 
     // THEN flush all the pages in the set
-    for (PageMgrPageMap::iterator flushIt { currentFlushes.begin() }; flushIt != currentFlushes.end(); )
-    {
-        LockedPageList& flushSet { flushIt->second };
-        MDBG_INFO("... flushing pages:" << flushSet.second.size() << " pageMgr:" << flushIt->first);
-        const SharedLockW mgrLock { GetPageManagerLock(*flushIt->first, mSkipFlushWait) };
+    MDBG_INFO("... flushing pages:" << flushSet.second.size() << " pageMgr:" << worker.mFlushing);
+    { const SharedLockW mgrLock { GetPageManagerLock(*flushSet.first, worker.mSkipWait) };
 
         for (const PageList::value_type& pagePair : flushSet.second)
         {
@@ -526,16 +848,26 @@ void CacheManager::DoPageFlushes() noexcept // thread cannot throw
                 MDBG_ERROR("... " << ex.what());
 
                 mFlushFailure = std::current_exception();
-                mFlushWaitCV.notify_all();
-                return; // early return
+                break; // stop flushing
             }
+
+            const UniqueLock lock(mMutex);
+            pending -= pageInfo.mPageSize;
+            mFlushPending -= pageInfo.mPageSize;
         }
+    }
+
+    { // lock scope
+        const UniqueLock lock(mMutex);
+        mFlushPending -= pending; // any not flushed
+        worker.mFlushing = nullptr;
 
-        flushIt = currentFlushes.erase(flushIt); // release scopeLock
         mFlushWaitCV.notify_all();
+        mFlushThreadCV.notify_all(); // idle workers can have it now
     }
 
     MDBG_INFO("... return!");
+    return true;
 }
 
 /*****************************************************/
@@ -543,9 +875,18 @@ void CacheManager::FlushPage(PageManager& pageMgr, const uint64_t index, const S
 {
     const std::chrono::steady_clock::time_point timeStart { std::chrono::steady_clock::now() };
     const size_t written { pageMgr.FlushPage(index, mgrLock) };
-
-    const UniqueLock lock(mMutex); // protect mBandwidth/mDirtyLimit
-    mDirtyLimit = mBandwidth.UpdateBandwidth(written, std::chrono::steady_clock::now()-timeStart);
+    BandwidthEstimator& bandwidth { pageMgr.GetBackend().GetWriteBandwidth() };
+    bandwidth.AddSample(written, std::chrono::steady_clock::now()-timeStart);
+
+    const UniqueLock lock(mMutex); // protect mDirtyLimit
+
+    // each measurement is for one of the concurrent flushes, so us and each other busy worker 
+    // add what its own backend can take in the time - backends (hosts) can differ greatly
+    size_t dirtyLimit { bandwidth.GetTimeBytes(mCacheOptions.maxDirtyTime) };
+    for (const FlushWorker& worker : mFlushWorkers)
+        if (worker.mFlushing != nullptr && worker.mFlushing != &pageMgr)
+            dirtyLimit += worker.mFlushing->GetBackend().GetWriteBandwidth().GetTimeBytes(mCacheOptions.maxDirtyTime);
+    mDirtyLimit = dirtyLimit;
 }
 
 } // namespace Filedata
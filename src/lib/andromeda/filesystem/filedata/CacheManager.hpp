@@ -2,19 +2,24 @@
 #ifndef LIBA2_CACHEMANAGER_H_
 #define LIBA2_CACHEMANAGER_H_
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <exception>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
-#include "BandwidthMeasure.hpp"
 #include "CacheOptions.hpp"
+#include "MemoryPressure.hpp"
 #include "andromeda/common.hpp"
 #include "andromeda/Debug.hpp"
 #include "andromeda/OrderedMap.hpp"
@@ -29,11 +34,17 @@ namespace Filedata {
 class Page;
 class PageManager;
 class CachingAllocator;
+class DiskCache;
+class EvictPolicy;
 
 /** 
- * Manages pages as an LRU cache to limit memory usage, by calling EvictPage()
+ * Manages pages as a cache to limit memory usage, by calling EvictPage() in the order given by an EvictPolicy
  * Also tracks dirty pages to limit the total dirty memory, by calling FlushPage()
  * The maximum dirty pages is in terms of time, determined by bandwidth measurement
+ * Flushing uses a pool of threads that each flush a different page manager at a time
+ * Files can be put in cache classes (see CacheOptions::cacheClasses) that each have their own EvictPolicy,
+ *    a maximum they evict themselves at, and a minimum that other classes can't evict them below
+ * The memory limit can follow system memory pressure (see CacheOptions::pressureSource and UpdateMemoryLimit)
  * Fully thread-safe. Evict/Flush are synchronous if possible when writing for
  *     error-catching - otherwise, they happen on background threads.
  * Callers adding new/bigger pages will block until memory is available
@@ -49,8 +60,12 @@ public:
         explicit MemoryException(const std::string& type) :
             Item::Exception("Failed to reserve memory: "+type+" error") {}; };
 
-    /** If true, start the cleanup threads immediately */
-    explicit CacheManager(const CacheOptions& cacheOptions, bool startThreads = true);
+    /** 
+     * @param startThreads if true, start the cleanup threads immediately
+     * @param memoryPressure the memory pressure source to use instead of CacheOptions::pressureSource (e.g. for testing)
+     */
+    explicit CacheManager(const CacheOptions& cacheOptions, bool startThreads = true, 
+        std::unique_ptr<MemoryPressure> memoryPressure = nullptr);
 
     /** Stop cleanup threads and destruct - ALL page activity must be stopped! */
     virtual ~CacheManager();
@@ -60,31 +75,73 @@ public:
     /** Runs the cleanup threads */
     void StartThreads();
 
-    /** Returns the maximum cache memory size */
+    /** Returns the maximum cache memory size (dynamic with memory pressure) - THREAD SAFE */
     size_t GetMemoryLimit() const;
 
+    /** 
+     * Reads the memory pressure source (if any) and adjusts the memory limit to it now,
+     * the evict thread also does this every PRESSURE_INTERVAL.  The limit aims to leave a reserve of
+     * memory available to others, grows by a step at a time, and shrinks right away or while tasks stall.
+     */
+    void UpdateMemoryLimit();
+
     /** A copy of some member variables for debugging */
     struct Stats 
     { 
         size_t currentTotal; 
+        /** Bytes used by page tables (counted toward memoryLimit) */
+        size_t tableMemory;
+        /** The current memory limit (dynamic with memory pressure) */
+        size_t memoryLimit;
         size_t totalPages; 
         size_t currentDirty; 
         size_t dirtyLimit; 
         size_t dirtyPages; 
+        /** Bytes held free by the page allocator */
+        size_t allocFree;
+        /** The largest free block in the page allocator (fragmented if much less than allocFree) */
+        size_t allocLargestFree;
     };
     /** Returns a copy of some member variables for debugging */
-    inline Stats GetStats() const 
-    { 
-        const UniqueLock lock(mMutex); 
-        return { mCurrentTotal, mPageQueue.size(), 
-            mCurrentDirty, mDirtyLimit, mDirtyQueue.size() }; 
-    }
+    Stats GetStats() const;
+
+    /** Returns the shared total of page table memory (see PageTable::memory), counted toward the memory limit - THREAD SAFE */
+    inline std::atomic<size_t>& GetTableMemory(){ return mTableMemory; }
 
     /** Returns the allocator to use for all file data */
     inline CachingAllocator& GetPageAllocator(){ return *mPageAllocator; }
+
+    /** Returns the local disk cache for clean evicted pages, or nullptr if not configured */
+    inline DiskCache* GetDiskCache(){ return mDiskCache.get(); }
+
+    /** Returns true if any rules assign files to cache classes (else GetCacheClass() is always 0) */
+    inline bool HasCacheRules() const { return !mCacheOptions.cacheRules.empty(); }
+
+    /**
+     * Returns the cache class for a file being opened (see CacheOptions::cacheRules)
+     * @param path the path of the file
+     * @param uid the user ID of the opening process
+     * @param process the name of the opening process
+     * @return the index of the class in CacheOptions::cacheClasses
+     */
+    size_t GetCacheClass(const std::string& path, uint32_t uid, const std::string& process) const;
+
+    /** Returns true if any rules match the opening process's name (else it need not be looked up) */
+    bool HasProcessRules() const;
+
+    /**
+     * Returns the class a file should have when opened with a new class (see GetCacheClass)
+     * The higher priority class wins, so e.g. a backup reading an editor's file doesn't demote it,
+     * and on a tie the new class wins
+     * @param current the file's current class, or PageManager::NO_CACHE_CLASS
+     * @param opened the class of the new open
+     */
+    size_t MergeCacheClass(size_t current, size_t opened) const;
     
     /** 
-     * Inform us that a page was used, putting at the front of the LRU
+     * Inform us that a page was used (a hit if already cached, see EvictPolicy)
+     * Hits that don't change the page's size or dirty state don't lock, they are only
+     * recorded in the page and given to the EvictPolicy when evicting (see GetVictims)
      * if mgrLock is given, may synchronously evict or flush pages on this manager
      * IF this fails, the caller must call RemovePage() or ResizePage(oldSize)
      * @param pageMgr the page manager that owns the page
@@ -114,6 +171,9 @@ public:
     /** Inform us that a page has been erased */
     void RemovePage(const Page& page);
 
+    /** Inform us that a page won't be used again soon, so it is evicted before others (see EvictPolicy) */
+    void DemotePage(const Page& page);
+
     /** Inform us that a page is no longer dirty */
     void RemoveDirty(const Page& page);
     
@@ -133,16 +193,62 @@ private:
      */
     inline bool ShouldAwaitFlush(const PageManager& pageMgr, const UniqueLock& lock) const;
 
-    /** Returns true if evict should run (memory is over the limit) */
-    inline bool ShouldEvict(const UniqueLock& lock) const { return mCurrentTotal > mCacheOptions.memoryLimit; }
+    /** Returns true if the given cache class is using more than its maximum */
+    inline bool IsOverMax(const size_t cacheClass, const UniqueLock& lock) const
+    {
+        const size_t maxBytes { mCacheClasses[cacheClass].maxBytes };
+        return maxBytes && mClassTotals[cacheClass] > maxBytes;
+    }
+
+    /** Returns the EvictPolicy capacity for the given cache class with the given memory limit */
+    inline size_t GetPolicyCapacity(const size_t cacheClass, const size_t memoryLimit) const
+    {
+        const size_t maxBytes { mCacheClasses[cacheClass].maxBytes };
+        return maxBytes ? std::min(maxBytes, memoryLimit) : memoryLimit;
+    }
+
+    /** Returns the total memory counted toward the limit (pages and page tables) */
+    inline size_t GetTotalMemory(const UniqueLock& lock) const { return mCurrentTotal + mTableMemory.load(std::memory_order_relaxed); }
+
+    /** Returns true if evict should run (memory is over the limit, or a class is over its maximum) */
+    inline bool ShouldEvict(const UniqueLock& lock) const
+    {
+        if (GetTotalMemory(lock) > mMemoryLimit.load(std::memory_order_relaxed)) return true;
+        for (size_t cacheClass { 0 }; cacheClass < mClassTotals.size(); ++cacheClass)
+            if (IsOverMax(cacheClass, lock)) return true;
+        return false;
+    }
 
     /** Returns true if flush should run (dirty memory is over the limit) */
     inline bool ShouldFlush(const UniqueLock& lock) const { return mCurrentDirty > mDirtyLimit; }
 
+    /** Returns true if flush should run for pages not already picked by a flush thread */
+    inline bool ShouldFlushMore(const UniqueLock& lock) const { return mCurrentDirty > mDirtyLimit + mFlushPending; }
+
     /** Returns true if evict/flush waiting should be skipped for the given page manager */
     inline bool ShouldSkipWait(const PageManager& pageMgr, const UniqueLock& lock) const
     {
-        return mSkipEvictWait == &pageMgr || mSkipFlushWait == &pageMgr;
+        if (mSkipEvictWait == &pageMgr) return true;
+        for (const FlushWorker& worker : mFlushWorkers)
+            if (worker.mSkipWait == &pageMgr) return true;
+        return false;
+    }
+
+    /** Returns true if the memory pressure source is due to be read again */
+    inline bool IsPressureDue(const UniqueLock& lock) const
+    {
+        return mMemoryPressure != nullptr && std::chrono::steady_clock::now() >= mPressureTime + PRESSURE_INTERVAL;
+    }
+
+    /** Reads the memory pressure source and sets mMemoryLimit (see UpdateMemoryLimit) */
+    void UpdateMemoryLimit(const UniqueLock& lock);
+
+    /** Returns true if the given page manager is being flushed by a flush thread */
+    inline bool IsFlushing(const PageManager& pageMgr, const UniqueLock& lock) const
+    {
+        for (const FlushWorker& worker : mFlushWorkers)
+            if (worker.mFlushing == &pageMgr) return true;
+        return false;
     }
 
     /**
@@ -170,7 +276,7 @@ private:
         bool canWait, UniqueLock& lock, const SharedLockW* mgrLock = nullptr);
 
     /** 
-     * Inform us that a page was used, putting at the front of the LRU
+     * Inform us that a page was used (a hit if already cached, see EvictPolicy)
      * @param pageMgr the page manager that owns the page
      * @param index the page manager page index
      * @param page reference to the page
@@ -188,6 +294,29 @@ private:
     /** Inform us that a page is no longer dirty (already have the lock) */
     void RemoveDirty(const Page& page, const UniqueLock& lock);
 
+    /** Returns the cache class to add the given page manager's pages to */
+    size_t GetCacheClass(const PageManager& pageMgr, const UniqueLock& lock) const;
+
+    /**
+     * Returns the bytes to evict from each cache class, totalling at least the given bytes if possible
+     * First anything over a class's maximum, then from the lowest priority classes down to their minimum,
+     * then below the minimums only if there is nothing else left to evict
+     */
+    std::vector<size_t> GetEvictQuotas(size_t bytes, const UniqueLock& lock) const;
+
+    /** 
+     * Returns pages to evict totalling at least the given bytes (see EvictPolicy::GetVictims and GetEvictQuotas)
+     * First gives the EvictPolicy any unlocked hits recorded on the pages it chooses,
+     * like CLOCK giving referenced pages a second chance
+     */
+    std::vector<const Page*> GetVictims(size_t bytes, const UniqueLock& lock);
+
+    /** 
+     * Returns pages to evict like GetVictims, but with clean pages first from further down the eviction order
+     * Clean pages free memory right away, dirty ones must be written first (and the flush threads will get to them)
+     */
+    std::vector<const Page*> GetCleanVictims(size_t bytes, const UniqueLock& lock);
+
     /** Send some stats about memory to debug */
     void PrintStatus(const char* fname, const UniqueLock& lock);
 
@@ -196,14 +325,16 @@ private:
 
     /**
      * Returns an exclusive lock for the given page manager, with deadlock avoidance
-     * @param waitPtr ref to mSkipEvictWait or mSkipFlushWait for deadlock avoidable
+     * @param waitPtr ref to mSkipEvictWait or a FlushWorker's mSkipWait for deadlock avoidable
      */
     SharedLockW GetPageManagerLock(PageManager& pageMgr, PageManager*& waitPtr);
 
+    struct FlushWorker;
+
     /** Run the page evict task in a loop while mRunCleanup */
     void EvictThread();
-    /** Run the page flush task in a loop while mRunCleanup */
-    void FlushThread();
+    /** Run the page flush task for the given worker in a loop while mRunCleanup */
+    void FlushThread(FlushWorker& worker);
 
     /** 
      * Run necessary page evictions
@@ -211,10 +342,11 @@ private:
      */
     inline void DoPageEvictions() noexcept;
     /** 
-     * Run necessary page flushes
+     * Run necessary page flushes for the oldest dirty page manager not being flushed by another worker
      * Sets mFlushFailure on BackendException
+     * @return false if there was nothing left for this worker to flush
      */
-    inline void DoPageFlushes() noexcept;
+    inline bool DoPageFlushes(FlushWorker& worker) noexcept;
 
     /** 
      * Calls flush on a page and updates the bandwidth measurement
@@ -235,11 +367,24 @@ private:
         const uint64_t mPageIndex;
         /** Size of the page when it was added */
         size_t mPageSize;
+        /** The cache class the page was added to */
+        size_t mClass;
     };
 
-    /** LIFO queue of pages for an LRU cache */
+    /** Map of all cached pages (eviction order is up to mEvictPolicies) */
+    using PageMap = std::unordered_map<const Page*, PageInfo>;
+    PageMap mPageMap;
+    /** The cache classes from CacheOptions, or just a default (never empty) */
+    std::vector<CacheOptions::CacheClass> mCacheClasses;
+    /** Chooses the order of page evictions in each cache class (same index as mCacheClasses) */
+    std::vector<std::unique_ptr<EvictPolicy>> mEvictPolicies;
+    /** The current memory usage of each cache class */
+    std::vector<size_t> mClassTotals;
+    /** The total bytes of pages ever added, read without the lock to timestamp hits */
+    std::atomic<uint64_t> mEpoch { 0 };
+
+    /** LIFO queue of dirty pages for flushing */
     using PageQueue = OrderedMap<const Page*, PageInfo>;
-    PageQueue mPageQueue;
     PageQueue mDirtyQueue;
 
     // structures used in Page Evict/Flush
@@ -257,38 +402,64 @@ private:
     /** CV to signal when memory is available */
     std::condition_variable mEvictWaitCV;
     
-    /** Background page flushing thread */
-    std::thread mFlushThread;
-    /** CV to wait/signal page flushing thread */
+    /** A background page flushing thread and its state (guarded by mMutex) */
+    struct FlushWorker
+    {
+        std::thread mThread;
+        /** PageManager that can skip the flush wait (need it to clear its lock queue) */
+        PageManager* mSkipWait { nullptr };
+        /** PageManager this worker is flushing (other workers pick a different one) */
+        const PageManager* mFlushing { nullptr };
+    };
+
+    /** Background page flushing threads (fixed size, never empty) */
+    std::vector<FlushWorker> mFlushWorkers;
+    /** CV to wait/signal page flushing threads */
     std::condition_variable mFlushThreadCV;
     /** CV to signal when dirty memory is available */
     std::condition_variable mFlushWaitCV;
 
     /** PageManager that can skip the evict wait (need it to clear its lock queue) */
     PageManager* mSkipEvictWait { nullptr };
-    /** PageManager that can skip the flush wait (need it to clear its lock queue) */
-    PageManager* mSkipFlushWait { nullptr };
 
     /** Reference to CacheOptions */
     const CacheOptions& mCacheOptions;
 
     /** The current total memory usage */
     size_t mCurrentTotal { 0 };
+    /** The memory used by all page tables, updated without the lock (see GetTableMemory) */
+    std::atomic<size_t> mTableMemory { 0 };
+
+    /** The current memory limit, read without the lock (dynamic with mMemoryPressure) */
+    std::atomic<size_t> mMemoryLimit;
+    /** The source of memory pressure for mMemoryLimit (null if fixed) */
+    std::unique_ptr<MemoryPressure> mMemoryPressure;
+    /** The time mMemoryPressure was last read */
+    std::chrono::steady_clock::time_point mPressureTime { };
+
+    /** How often the evict thread reads mMemoryPressure */
+    static constexpr std::chrono::milliseconds PRESSURE_INTERVAL { 250 };
+    /** The percent of time tasks stall on memory (PSI) at which the limit is shrunk below current usage */
+    static constexpr double PRESSURE_STALL { 1.0 };
+    /** The fraction of total memory (1/N) to leave available to others */
+    static constexpr uint64_t PRESSURE_RESERVE_FRAC { 10 };
 
     /** The maximum in-memory dirty page usage before flushing (dynamic) */
     size_t mDirtyLimit { 0 };
     /** The current total dirty page memory */
     size_t mCurrentDirty { 0 };
+    /** The dirty page memory picked by flush threads but not yet flushed */
+    size_t mFlushPending { 0 };
 
     /** Exception encountered while evicting */
     std::exception_ptr mEvictFailure;
     /** Exception encountered while flushing */
     std::exception_ptr mFlushFailure;
 
-    /** Bandwidth measurement tool for mDirtyLimit */
-    BandwidthMeasure mBandwidth;
     /** Allocator to use for all file pages (never null) */
     std::unique_ptr<CachingAllocator> mPageAllocator;
+    /** Second-tier cache for clean evicted pages (null if no diskPath) */
+    std::unique_ptr<DiskCache> mDiskCache;
 };
 
 } // namespace Filedata
@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <sstream>
 
 #include "CacheOptions.hpp"
@@ -18,9 +19,13 @@ std::string CacheOptions::HelpText()
     const auto defDirty(milliseconds(optDefault.maxDirtyTime).count());
     const size_t stBits { sizeof(size_t)*8 };
 
-    output << "Cache Advanced:  [--no-cachemgr] [--max-dirty ms(" << defDirty << ")]"
+    output << "Cache Advanced:  [--no-cachemgr] [--max-dirty ms(" << defDirty << ")] [--flush-threads uint32(" << optDefault.flushThreads << ")]"
         << " [--memory-limit bytes"<<stBits<<"(" << StringUtil::bytesToString(optDefault.memoryLimit) << ")]"
-        << " [--evict-frac uint32(" << optDefault.evictSizeFrac << ")]";
+        << " [--memory-pressure none|auto|cgroup|meminfo [--memory-min bytes"<<stBits<<"(" << StringUtil::bytesToString(optDefault.memoryMin) << ")]]"
+        << " [--evict-frac uint32(" << optDefault.evictSizeFrac << ")] [--evict-policy lru|2q]"
+        << " [--cache-class name:minbytes:maxbytes:priority]... [--cache-rule name:path=prefix|uid=uid|proc=name]..."
+        << " [--disk-cache path] [--disk-limit bytes64(" << StringUtil::bytesToString(optDefault.diskLimit) << ")]"
+        << " [--huge-pages [--huge-reserve bytes"<<stBits<<"(" << StringUtil::bytesToString(optDefault.hugeReserve) << ")] [--lock-memory]]";
 
     return output.str();
 }
@@ -30,6 +35,10 @@ bool CacheOptions::AddFlag(const std::string& flag)
 {
     if (flag == "no-cachemgr")
         disable = true;
+    else if (flag == "huge-pages")
+        hugePages = true;
+    else if (flag == "lock-memory")
+        lockMemory = true;
     else return false; // not used
 
     return true;
@@ -44,12 +53,34 @@ bool CacheOptions::AddOption(const std::string& option, const std::string& value
         catch (const std::logic_error& e) { 
             throw BaseOptions::BadValueException(option); }
     }
+    else if (option == "flush-threads")
+    {
+        try { flushThreads = static_cast<decltype(flushThreads)>(stoul(value)); }
+        catch (const std::logic_error& e) { 
+            throw BaseOptions::BadValueException(option); }
+
+        if (!flushThreads) throw BaseOptions::BadValueException(option);
+    }
     else if (option == "memory-limit")
     {
         try { memoryLimit = static_cast<size_t>(StringUtil::stringToBytes(value)); }
         catch (const std::logic_error& e) { 
             throw BaseOptions::BadValueException(option); }
     }
+    else if (option == "memory-pressure")
+    {
+        if      (value == "none")    pressureSource = PressureSource::NONE;
+        else if (value == "auto")    pressureSource = PressureSource::AUTO;
+        else if (value == "cgroup")  pressureSource = PressureSource::CGROUP;
+        else if (value == "meminfo") pressureSource = PressureSource::MEMINFO;
+        else throw BaseOptions::BadValueException(option);
+    }
+    else if (option == "memory-min")
+    {
+        try { memoryMin = static_cast<size_t>(StringUtil::stringToBytes(value)); }
+        catch (const std::logic_error& e) { 
+            throw BaseOptions::BadValueException(option); }
+    }
     else if (option == "evict-frac")
     {
         try { evictSizeFrac = static_cast<decltype(evictSizeFrac)>(stoul(value)); }
@@ -58,6 +89,73 @@ bool CacheOptions::AddOption(const std::string& option, const std::string& value
 
         if (!evictSizeFrac) throw BaseOptions::BadValueException(option);
     }
+    else if (option == "evict-policy")
+    {
+        if      (value == "lru") evictType = EvictType::LRU;
+        else if (value == "2q")  evictType = EvictType::TWOQUEUE;
+        else throw BaseOptions::BadValueException(option);
+    }
+    else if (option == "cache-class")
+    {
+        const StringUtil::StringList parts { StringUtil::explode(value, ":") };
+        if (parts.size() != 4 || parts[0].empty()) throw BaseOptions::BadValueException(option);
+
+        CacheClass cacheClass { parts[0], 0, 0, 0 };
+        try
+        {
+            cacheClass.minBytes = static_cast<size_t>(StringUtil::stringToBytes(parts[1]));
+            cacheClass.maxBytes = static_cast<size_t>(StringUtil::stringToBytes(parts[2]));
+            cacheClass.priority = static_cast<decltype(cacheClass.priority)>(stoul(parts[3]));
+        }
+        catch (const std::logic_error& e) { 
+            throw BaseOptions::BadValueException(option); }
+
+        if (cacheClass.maxBytes && cacheClass.maxBytes < cacheClass.minBytes)
+            throw BaseOptions::BadValueException(option);
+
+        // an existing name (e.g. default) is replaced
+        const std::vector<CacheClass>::iterator classIt { std::find_if(cacheClasses.begin(), cacheClasses.end(),
+            [&](const CacheClass& other){ return other.name == cacheClass.name; }) };
+        if (classIt != cacheClasses.end()) *classIt = cacheClass;
+        else cacheClasses.push_back(cacheClass);
+    }
+    else if (option == "cache-rule") // options are sorted, cache-class is already done
+    {
+        const StringUtil::StringPair classRule { StringUtil::split(value, ":") };
+        const StringUtil::StringPair typeMatch { StringUtil::split(classRule.second, "=") };
+        if (typeMatch.second.empty()) throw BaseOptions::BadValueException(option);
+
+        const std::vector<CacheClass>::const_iterator classIt { std::find_if(cacheClasses.cbegin(), cacheClasses.cend(),
+            [&](const CacheClass& cacheClass){ return cacheClass.name == classRule.first; }) };
+        if (classIt == cacheClasses.cend()) throw BaseOptions::BadValueException(option);
+
+        CacheRule cacheRule { CacheRule::Type::PATH, typeMatch.second, 
+            static_cast<size_t>(classIt-cacheClasses.cbegin()) };
+
+        if      (typeMatch.first == "path") cacheRule.type = CacheRule::Type::PATH;
+        else if (typeMatch.first == "uid")  cacheRule.type = CacheRule::Type::UID;
+        else if (typeMatch.first == "proc") cacheRule.type = CacheRule::Type::PROCESS;
+        else throw BaseOptions::BadValueException(option);
+
+        cacheRules.push_back(cacheRule);
+    }
+    else if (option == "disk-cache")
+    {
+        if (value.empty()) throw BaseOptions::BadValueException(option);
+        diskPath = value;
+    }
+    else if (option == "disk-limit")
+    {
+        try { diskLimit = StringUtil::stringToBytes(value); }
+        catch (const std::logic_error& e) { 
+            throw BaseOptions::BadValueException(option); }
+    }
+    else if (option == "huge-reserve")
+    {
+        try { hugeReserve = static_cast<size_t>(StringUtil::stringToBytes(value)); }
+        catch (const std::logic_error& e) { 
+            throw BaseOptions::BadValueException(option); }
+    }
     else return false; // not used
 
     return true; 
@@ -4,6 +4,7 @@
 #include <chrono>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace Andromeda {
 namespace Filesystem {
@@ -30,9 +31,29 @@ struct CacheOptions
      * While it may be tempting to set this to 0, keep in mind reads are orders of magnitude
      * faster when multi-page readAheads can happen, and a readAhead can be larger than some fraction of this 
      * (see ConfigOptions.readMaxCacheFrac) even small values e.g. 8MB make a huge difference in performance.
+     * With a pressureSource, this is the upper bound the limit grows to when memory is free.
      */
     size_t memoryLimit { static_cast<size_t>(256)*1024*1024 };
 
+    /** Where to read system memory pressure from, to follow it with a dynamic memory limit (see MemoryPressure) */
+    enum class PressureSource : uint8_t
+    {
+        /** fixed memoryLimit */                                NONE,
+        /** our cgroup's limit if it has one, else meminfo */   AUTO,
+        /** cgroup v2 memory.high/max minus memory.current */   CGROUP,
+        /** MemAvailable from /proc/meminfo */                  MEMINFO
+    };
+
+    /** 
+     * The source of memory pressure for a dynamic memory limit between memoryMin and memoryLimit
+     * The limit grows when memory is free and shrinks (evicting clean pages first) as it runs low,
+     * or while other tasks are stalled waiting on memory (Linux PSI)
+     */
+    PressureSource pressureSource { PressureSource::NONE };
+
+    /** The lowest the dynamic memory limit can go under pressure (bytes) */
+    size_t memoryMin { static_cast<size_t>(32)*1024*1024 };
+
     /** 
      * The fraction of mMemoryLimit to get below the max when evicting .
      * E.g. if limit=256M and frac=32, evict starts at 256M and evicts 8M of pages
@@ -40,15 +61,96 @@ struct CacheOptions
      */
     uint32_t evictSizeFrac { 16 };
 
+    /** Page eviction policies (see EvictPolicy) */
+    enum class EvictType : uint8_t
+    {
+        /** least recently used */                LRU,
+        /** scan-resistant 2Q with ghost pages */ TWOQUEUE
+    };
+
+    /** 
+     * The policy for choosing which pages to evict
+     * 2Q keeps a large one-time read (e.g. a backup) from evicting the working set of other files
+     */
+    EvictType evictType { EvictType::LRU };
+
+    /** A class of files with its own share of the memory cache (see CacheManager) */
+    struct CacheClass
+    {
+        std::string name;
+        /** Memory (bytes) that other classes can't evict this class below - a guaranteed share */
+        size_t minBytes;
+        /** Memory (bytes) this class can use before evicting its own pages, or 0 for no limit */
+        size_t maxBytes;
+        /** Classes with a lower priority are evicted from first */
+        uint32_t priority;
+    };
+
+    /** 
+     * Classes of files sharing the memory cache, the first is the default for files matching no rule
+     * E.g. a background indexer can be kept from evicting the pages an interactive editor needs
+     */
+    std::vector<CacheClass> cacheClasses { CacheClass{"default", 0, 0, 0} };
+
+    /** Assigns files to a cache class when opened */
+    struct CacheRule
+    {
+        /** What a rule matches against */
+        enum class Type : uint8_t
+        {
+            /** prefix of the file's path */                      PATH,
+            /** user ID of the opening process */                 UID,
+            /** name of the opening process (see /proc/pid/comm) */ PROCESS
+        };
+        Type type;
+        /** The path prefix, uid or process name to match */
+        std::string match;
+        /** The index of the class in cacheClasses */
+        size_t classIdx;
+    };
+
+    /** 
+     * Rules for assigning files to cacheClasses, the first match wins
+     * A file opened by processes matching different classes keeps the highest priority one
+     */
+    std::vector<CacheRule> cacheRules;
+
     using milliseconds = std::chrono::milliseconds;
 
     /** 
      * The max amount of dirty data to have in memory in terms of transfer time.
-     * Bandwidth measuring is used to convert this time-target to an actual byte count.
+     * The measured flush bandwidth (less request latency) is used to convert this time-target to an actual byte count.
      * Larger values may improve performance but increase memory usage and risk losing more data if we crash or the server goes down, etc.
      */
     milliseconds maxDirtyTime { 1000 };
 
+    /**
+     * The number of background threads flushing dirty pages, each flushes a different file at a time.
+     * More threads let many dirty files (e.g. extracting an archive) upload concurrently, up to the backend's runnerPoolSize
+     */
+    uint32_t flushThreads { 2 };
+
+    /**
+     * Directory for the local disk cache of clean pages evicted from memory (see ConfigOptions::CacheType::DISK)
+     * Cached pages persist across runs and are dropped if the file's size/mtime on the backend change
+     */
+    std::string diskPath;
+
+    /** The maximum total file data cached on disk before evicting (bytes) */
+    uint64_t diskLimit { static_cast<uint64_t>(4)*1024*1024*1024 };
+
+    /** 
+     * True to allocate pages from 2MB huge page arenas (see MemoryAllocator)
+     * Reduces TLB misses and page faults for large caches, at the cost of holding partially used arenas
+     */
+    bool hugePages { false };
+
+    /** Bytes of huge page arenas to allocate and pre-fault at startup (if hugePages) */
+    size_t hugeReserve { 0 };
+
+    /** True to lock huge page arenas into memory so they are never swapped (if hugePages) */
+    bool lockMemory { false };
+
     /** True to disable the CacheManager */
     bool disable { false };
 };
@@ -1,4 +1,6 @@
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
 
@@ -9,13 +11,34 @@ namespace Andromeda {
 namespace Filesystem {
 namespace Filedata {
 
+namespace { // anonymous
+/** The next CachingAllocator ID */
+std::atomic<uint64_t> sNextAllocID { 0 };
+} // namespace
+
 /*****************************************************/
-CachingAllocator::CachingAllocator(const size_t baseline) : 
-    mDebug(__func__,this), mBaseline(baseline) { }
+CachingAllocator::CachingAllocator(const size_t baseline, const HugePageOptions& hugeOptions) : 
+    MemoryAllocator(hugeOptions), mDebug(__func__,this), mBaseline(baseline), 
+    mAllocID(sNextAllocID.fetch_add(1)) { }
 
 /*****************************************************/
 CachingAllocator::~CachingAllocator()
 {
+    std::vector<std::shared_ptr<ThreadCache>> threadCaches; { // lock scope
+        const LockGuard lock(mMutex);
+        threadCaches.swap(mThreadCaches);
+    }
+
+    // cache locks are before mMutex, a thread may be exiting and spilling concurrently
+    for (const std::shared_ptr<ThreadCache>& cache : threadCaches)
+    {
+        const LockGuard cacheLock(cache->mMutex);
+        for (Magazine& magazine : cache->mMagazines)
+            for (size_t idx { 0 }; idx < magazine.count; ++idx)
+                MemoryAllocator::free(magazine.ptrs[idx], magazine.pages);
+        cache->mAlloc = nullptr;
+    }
+
     for (const FreeListMap::value_type& pair : mFreeLists)
         for (void* ptr : pair.second)
             MemoryAllocator::free(ptr, pair.first);
@@ -25,6 +48,111 @@ CachingAllocator::~CachingAllocator()
 // the FreeList allows quick re-alloc by looking up the alloc size then taking the first entry (LIFO)
 // FreeQueue: when freed, a page goes onto the front of the free queue
 // the FreeQueue allows quick cleanup by popping a free off the end of the list (FIFO)
+// FreeBlocks: free blocks by address, when freed a page is merged with the blocks before/after it
+// Chunks: allocations from the OS by address, blocks are never merged across them
+
+/*****************************************************/
+CachingAllocator::ThreadCacheList::~ThreadCacheList()
+{
+    // return our allocations to the free pool for other threads
+    for (const std::shared_ptr<ThreadCache>& cache : mCaches)
+    {
+        const LockGuard cacheLock(cache->mMutex);
+        if (cache->mAlloc == nullptr) continue; // already destructed
+
+        for (Magazine& magazine : cache->mMagazines)
+            cache->mAlloc->SpillMagazine(magazine, magazine.count);
+    }
+}
+
+/*****************************************************/
+CachingAllocator::ThreadCache& CachingAllocator::GetThreadCache()
+{
+    thread_local ThreadCacheList threadCaches;
+    std::vector<std::shared_ptr<ThreadCache>>& caches { threadCaches.mCaches };
+
+    for (const std::shared_ptr<ThreadCache>& cache : caches)
+        if (cache->mAllocID == mAllocID) return *cache;
+
+    // forget caches of allocators that were destructed
+    caches.erase(std::remove_if(caches.begin(), caches.end(), [](const std::shared_ptr<ThreadCache>& cache) {
+        const LockGuard cacheLock(cache->mMutex); return cache->mAlloc == nullptr; }), caches.end());
+
+    caches.emplace_back(std::make_shared<ThreadCache>(*this, mAllocID));
+    const LockGuard lock(mMutex);
+
+    // forget caches of threads that exited (already spilled)
+    mThreadCaches.erase(std::remove_if(mThreadCaches.begin(), mThreadCaches.end(), 
+        [](const std::shared_ptr<ThreadCache>& cache) { return cache.use_count() == 1; }), mThreadCaches.end());
+
+    mThreadCaches.emplace_back(caches.back());
+    return *caches.back();
+}
+
+/*****************************************************/
+CachingAllocator::Magazine* CachingAllocator::GetMagazine(ThreadCache& cache, const size_t pages)
+{
+    Magazine* unused { nullptr };
+    for (Magazine& magazine : cache.mMagazines)
+    {
+        if (magazine.pages == pages) return &magazine;
+        if (!magazine.count && unused == nullptr) unused = &magazine;
+    }
+
+    if (unused != nullptr) unused->pages = pages; // claim
+    return unused;
+}
+
+/*****************************************************/
+void CachingAllocator::RefillMagazine(Magazine& magazine, const LockGuard& lock)
+{
+    const FreeListMap::iterator fmIt { mFreeLists.find(magazine.pages) };
+    if (fmIt == mFreeLists.end()) return;
+    FreeList& freeList { fmIt->second };
+
+    while (magazine.count < MAGAZINE_SIZE/2 && !freeList.empty())
+    {
+        void* const ptr { freeList.front() };
+        const bool last { freeList.size() == 1 };
+        remove_entry(ptr, lock); // also erases an empty list
+        magazine.ptrs[magazine.count++] = ptr;
+
+        mCurFree -= magazine.pages*mPageSize;
+        mCurAlloc += magazine.pages*mPageSize;
+        ++mRecycles; ++mAllocs;
+        if (last) break;
+    }
+    mMaxAlloc = std::max(mCurAlloc, mMaxAlloc);
+
+    MDBG_INFO("... pages:" << magazine.pages << " count:" << magazine.count << " mCurFree:" << mCurFree);
+}
+
+/*****************************************************/
+void* CachingAllocator::PopMagazine(Magazine& magazine) const
+{
+    void* const ptr { magazine.ptrs[--magazine.count] };
+#if DEBUG // sanity checks
+    std::memset(ptr, 0x55, magazine.pages*mPageSize); // poison
+#endif // DEBUG
+    MDBG_INFO("... magazine ptr:" << ptr);
+    return ptr;
+}
+
+/*****************************************************/
+void CachingAllocator::SpillMagazine(Magazine& magazine, const size_t count)
+{
+    if (!count) return;
+    const LockGuard lock(mMutex);
+
+    for (size_t idx { 0 }; idx < count; ++idx)
+        add_merged(magazine.ptrs[idx], magazine.pages, lock);
+    std::copy(magazine.ptrs.begin()+static_cast<std::ptrdiff_t>(count), 
+              magazine.ptrs.begin()+static_cast<std::ptrdiff_t>(magazine.count), magazine.ptrs.begin());
+    magazine.count -= count;
+
+    MDBG_INFO("... pages:" << magazine.pages << " count:" << count);
+    add_free(count*magazine.pages, lock);
+}
 
 /*****************************************************/
 void* CachingAllocator::alloc(size_t pages)
@@ -36,8 +164,21 @@ void* CachingAllocator::alloc(size_t pages)
     return ::malloc(pages*mPageSize); // NOLINT(*-owning-memory, *-no-malloc)
 #endif
 
+    ThreadCache& cache { GetThreadCache() };
+    const LockGuard cacheLock(cache.mMutex); // uncontended
+    Magazine* const magazine { GetMagazine(cache, pages) };
+    if (magazine != nullptr && magazine->count)
+        return PopMagazine(*magazine);
+
     { // lock scope
         const LockGuard lock(mMutex);
+        if (magazine != nullptr)
+        {
+            // take a batch so the next allocs don't need the lock
+            RefillMagazine(*magazine, lock);
+            if (magazine->count) return PopMagazine(*magazine);
+        }
+
         ++mAllocs; // total
         mCurAlloc += pages*mPageSize;
         mMaxAlloc = std::max(mCurAlloc, mMaxAlloc);
@@ -45,39 +186,32 @@ void* CachingAllocator::alloc(size_t pages)
         MDBG_INFO("... mBaseline:" << mBaseline 
             << " mCurAlloc:" << mCurAlloc << " mMaxAlloc:" << mMaxAlloc);
 
-        FreeListMap::iterator fmIt { mFreeLists.lower_bound(pages) };
+        const FreeListMap::iterator fmIt { mFreeLists.lower_bound(pages) }; // best fit
         if (fmIt != mFreeLists.end())
         {
-            FreeList& freeList { fmIt->second };
-            void* const ptr = freeList.front();
+            const size_t blockPages { fmIt->first };
+            void* const ptr = fmIt->second.front();
 #if DEBUG // sanity checks
-            assert(fmIt->first >= pages); // lower_bound
+            assert(blockPages >= pages); // lower_bound
             std::memset(ptr, 0x55, pages*mPageSize); // poison
 #endif // DEBUG
 
-            freeList.pop_front();
-            mFreeQueue.erase(ptr);
+            remove_entry(ptr, lock); // fmIt is invalid
             mCurFree -= pages*mPageSize;
             ++mRecycles;
 
-            MDBG_INFO("... recycle ptr:" << ptr << " pages:" << fmIt->first
-                << " recycles:" << mRecycles << "/" << mAllocs);
-            MDBG_INFO("... from freeList:" << pages << ":" << freeList.size() 
-                << " mCurFree:" << mCurFree);
+            MDBG_INFO("... recycle ptr:" << ptr << " pages:" << blockPages
+                << " recycles:" << mRecycles << "/" << mAllocs << " mCurFree:" << mCurFree);
             
-            if (fmIt->first != pages) // only used part of the alloc, re-add the remaining
+            if (blockPages != pages) // only used part of the alloc, re-add the remaining
             {
                 void* const newPtr { static_cast<uint8_t*>(ptr) + pages*mPageSize };
-                const size_t newPages { fmIt->first - pages };
+                const size_t newPages { blockPages - pages };
                 const size_t newListSize { add_entry(newPtr, newPages, lock) };
 
                 MDBG_INFO("... partial alloc: newPtr:" << newPtr
                     << " new freeList:" << newPages << ":" << newListSize);
             }
-
-            // never have an empty list!
-            if (freeList.empty())
-                mFreeLists.erase(fmIt);
             return ptr;
         }
     }
@@ -88,6 +222,9 @@ void* CachingAllocator::alloc(size_t pages)
 #endif // DEBUG
     MDBG_INFO("... allocate ptr:" << ptr 
         << " recycles:" << mRecycles << "/" << mAllocs);
+
+    const LockGuard lock(mMutex);
+    mChunks.emplace(static_cast<uint8_t*>(ptr), pages);
     return ptr;
 }
 
@@ -101,18 +238,43 @@ void CachingAllocator::free(void* const ptr, size_t pages)
     ::free(ptr); return; // NOLINT(*-owning-memory, *-no-malloc)
 #endif
 
-    const LockGuard lock(mMutex);
-    const size_t freeListSize { add_entry(ptr, pages, lock) };
 #if DEBUG // sanity checks
     std::memset(ptr, 0xAA, pages*mPageSize); // poison
+#endif // DEBUG
+
+    { // cache lock scope
+        ThreadCache& cache { GetThreadCache() };
+        const LockGuard cacheLock(cache.mMutex);
+        Magazine* const magazine { GetMagazine(cache, pages) };
+        if (magazine != nullptr)
+        {
+            if (magazine->count == MAGAZINE_SIZE)
+                SpillMagazine(*magazine, MAGAZINE_SIZE/2);
+            magazine->ptrs[magazine->count++] = ptr;
+            MDBG_INFO("... to magazine:" << pages << ":" << magazine->count);
+            return;
+        }
+    }
+
+    const LockGuard lock(mMutex);
+    const size_t freeListSize { add_merged(ptr, pages, lock) };
+
+    MDBG_INFO("... to freeList:" << pages << ":" << freeListSize
+        << " freeQueue:" << mFreeQueue.size());
+    add_free(pages, lock);
+}
+
+/*****************************************************/
+void CachingAllocator::add_free(const size_t pages, const LockGuard& lock)
+{
+#if DEBUG // sanity checks
     assert(pages*mPageSize <= mCurAlloc);
 #endif // DEBUG
 
     mCurFree += pages*mPageSize;
     mCurAlloc -= pages*mPageSize;
 
-    MDBG_INFO("... to freeList:" << pages << ":" << freeListSize
-        << " freeQueue:" << mFreeQueue.size() << " mCurFree:" << mCurFree << " mCurAlloc:" << mCurAlloc);
+    MDBG_INFO("... mCurFree:" << mCurFree << " mCurAlloc:" << mCurAlloc);
 
     while (mCurFree > mMaxAlloc-mBaseline) 
         pop_last_entry(lock);
@@ -125,33 +287,98 @@ size_t CachingAllocator::add_entry(void* const ptr, size_t pages, const LockGuar
     FreeList& freeList { freeListMapIt->second };
     freeList.emplace_front(ptr); // O(1)
     mFreeQueue.enqueue_front(ptr, std::make_pair(freeListMapIt, freeList.begin())); // O(1)
+    mFreeBlocks.emplace(static_cast<uint8_t*>(ptr), pages); // O(logn)
     return freeList.size();
 }
 
+/*****************************************************/
+size_t CachingAllocator::add_merged(void* const ptr, const size_t pages, const LockGuard& lock)
+{
+    uint8_t* start { static_cast<uint8_t*>(ptr) };
+    uint8_t* const end { start + pages*mPageSize };
+
+    // the OS allocation containing ptr
+    const BlockMap::const_iterator chunkIt { std::prev(mChunks.upper_bound(start)) }; // O(logn)
+    uint8_t* const chunkStart { chunkIt->first };
+    const uint8_t* const chunkEnd { chunkStart + chunkIt->second*mPageSize };
+#if DEBUG // sanity checks
+    assert(chunkStart <= start && end <= chunkEnd);
+#endif // DEBUG
+
+    size_t newPages { pages };
+    const BlockMap::const_iterator nextIt { mFreeBlocks.lower_bound(start) }; // O(logn)
+    if (nextIt != mFreeBlocks.cend() && nextIt->first == end && end < chunkEnd)
+    {
+        newPages += nextIt->second;
+        remove_entry(nextIt->first, lock);
+    }
+
+    const BlockMap::const_iterator prevIt { mFreeBlocks.lower_bound(start) }; // nextIt may be invalid
+    if (prevIt != mFreeBlocks.cbegin() && start > chunkStart)
+    {
+        const BlockMap::const_iterator blockIt { std::prev(prevIt) };
+        if (blockIt->first + blockIt->second*mPageSize == start)
+        {
+            MDBG_INFO("... merge before:" << static_cast<void*>(blockIt->first) << " pages:" << blockIt->second);
+            start = blockIt->first;
+            newPages += blockIt->second;
+            remove_entry(start, lock);
+        }
+    }
+
+    if (newPages != pages) { MDBG_INFO("... merged ptr:" << static_cast<void*>(start) << " pages:" << newPages); }
+    return add_entry(start, newPages, lock);
+}
+
+/*****************************************************/
+void CachingAllocator::remove_entry(void* const ptr, const LockGuard& lock)
+{
+    const FreeQueue::iterator queueIt { mFreeQueue.find(ptr) }; // O(1)
+    const FreeListMap::iterator freeListMapIt { queueIt->second.first };
+    freeListMapIt->second.erase(queueIt->second.second); // O(1)
+
+    // never have an empty list!
+    if (freeListMapIt->second.empty())
+        mFreeLists.erase(freeListMapIt); // O(1)
+
+    mFreeQueue.erase(ptr); // O(1)
+    mFreeBlocks.erase(static_cast<uint8_t*>(ptr)); // O(logn)
+}
+
 /*****************************************************/
 void CachingAllocator::pop_last_entry(const LockGuard& lock)
 {
     // free the oldest free
-    const FreeQueue::value_type fpair { mFreeQueue.pop_back() }; // O(1)
+    const FreeQueue::value_type& fpair { mFreeQueue.back() };
+    void* const ptr { fpair.first };
+    const size_t pages { fpair.second.first->first };
 
-    void* ptr = fpair.first;
-    const FreeListMap::iterator& freeListMapIt { fpair.second.first };
-    FreeList& freeList { freeListMapIt->second };
-    const size_t pages { freeListMapIt->first };
-
-    freeList.erase(fpair.second.second); // O(1)
+    remove_entry(ptr, lock);
     mCurFree -= pages*mPageSize;
 
     // free under lock to guarantee max memory
-    MDBG_INFO("... free ptr:" << ptr);
+    MDBG_INFO("... free ptr:" << ptr << " pages:" << pages);
     MemoryAllocator::free(ptr, pages);
+    remove_chunk(static_cast<uint8_t*>(ptr), pages, lock);
 
-    MDBG_INFO("... freeList:" << pages << ":" << freeList.size() 
-        << " freeQueue:" << mFreeQueue.size() << " mCurFree:" << mCurFree);
+    MDBG_INFO("... freeQueue:" << mFreeQueue.size() << " mCurFree:" << mCurFree);
+}
 
-    // never have an empty list!
-    if (freeList.empty())
-        mFreeLists.erase(freeListMapIt); // O(1)
+/*****************************************************/
+void CachingAllocator::remove_chunk(uint8_t* const ptr, const size_t pages, const LockGuard& lock)
+{
+    const BlockMap::iterator chunkIt { std::prev(mChunks.upper_bound(ptr)) };
+    uint8_t* const chunkStart { chunkIt->first };
+    uint8_t* const chunkEnd { chunkStart + chunkIt->second*mPageSize };
+    mChunks.erase(chunkIt);
+
+    // keep what's left of the allocation before/after
+    if (chunkStart < ptr)
+        mChunks.emplace(chunkStart, static_cast<size_t>(ptr-chunkStart)/mPageSize);
+
+    uint8_t* const end { ptr + pages*mPageSize };
+    if (end < chunkEnd)
+        mChunks.emplace(end, static_cast<size_t>(chunkEnd-end)/mPageSize);
 }
 
 } // namespace Filedata
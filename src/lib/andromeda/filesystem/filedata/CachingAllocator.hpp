@@ -2,11 +2,14 @@
 #ifndef LIBA2_CACHINGALLOCATOR_H_
 #define LIBA2_CACHINGALLOCATOR_H_
 
+#include <array>
 #include <cstdint>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <utility>
+#include <vector>
 
 #include "MemoryAllocator.hpp"
 #include "andromeda/common.hpp"
@@ -22,15 +25,22 @@ namespace Filedata {
  * When an allocation is free()d, it is added to a list to be re-used in a later alloc(). 
  * When the maximum free pool size is exceeded, allocations are removed and returned the OS longest-ago-freed first (FIFO).
  * NOTE 1) memory is allocated only at page size granularity.  Use get_usage() to determine the actual memory size of an allocation.
- * NOTE 2) allocations can be made by splitting from a larger chunk, but adjacent frees are not then re-combined.
+ * NOTE 2) allocations can be made by splitting from a larger free block, and adjacent frees are re-combined 
+ *   (only within the same OS allocation, so each can still be returned to the OS separately).
+ * Each thread also keeps small magazines of its recently freed allocations (by size) that it re-uses without
+ * the shared lock, and that spill to and refill from the shared free pool in batches.  Allocations held in
+ * magazines still count towards curAlloc, and magazine hits are not counted in the stats.
  * THREAD SAFE (INTERNAL LOCKS)
  */
 class CachingAllocator : public MemoryAllocator
 {
 public:
 
-    /** @param baseline the amount of memory used when evict stops, used to calculate the free pool max size */
-    explicit CachingAllocator(size_t baseline);
+    /** 
+     * @param baseline the amount of memory used when evict stops, used to calculate the free pool max size
+     * @param hugeOptions options for allocating from huge page arenas
+     */
+    explicit CachingAllocator(size_t baseline, const HugePageOptions& hugeOptions = HugePageOptions());
 
     ~CachingAllocator() override;
     DELETE_COPY(CachingAllocator)
@@ -56,6 +66,10 @@ public:
         size_t curAlloc; 
         size_t maxAlloc; 
         size_t curFree; 
+        /** The largest free block (fragmentation if much less than curFree) */
+        size_t largestFree;
+        /** The number of free blocks */
+        size_t freeBlocks;
         uint64_t recycles; 
         uint64_t allocs;
     };
@@ -63,22 +77,94 @@ public:
     inline Stats GetStats() const
     { 
         const LockGuard lock(mMutex); 
-        return { mCurAlloc, mMaxAlloc, mCurFree, mRecycles, mAllocs }; 
+        const size_t largestFree { mFreeLists.empty() ? 0 : mFreeLists.rbegin()->first*mPageSize };
+        return { mCurAlloc, mMaxAlloc, mCurFree, largestFree, mFreeQueue.size(), mRecycles, mAllocs }; 
     }
 
 private:
 
     using LockGuard = std::lock_guard<std::mutex>;
 
+    /** The max number of allocations in each magazine */
+    static constexpr size_t MAGAZINE_SIZE { 8 };
+    /** The number of allocation sizes each thread keeps a magazine for */
+    static constexpr size_t MAGAZINE_CLASSES { 2 };
+
+    /** A stack of freed allocations of the same size */
+    struct Magazine
+    {
+        /** The allocation size in pages (0 if unused) */
+        size_t pages { 0 };
+        /** The number of allocations in ptrs */
+        size_t count { 0 };
+        /** The freed allocations, most recent last */
+        std::array<void*, MAGAZINE_SIZE> ptrs {};
+    };
+
+    /** A thread's magazines for one allocator (shared by the thread and the allocator) */
+    struct ThreadCache
+    {
+        /** Only contended when the thread exits or the allocator is destructed */
+        std::mutex mMutex;
+        /** The allocator these are from, nullptr once it is destructed */
+        CachingAllocator* mAlloc;
+        /** The unique ID of mAlloc (addresses can be re-used) */
+        const uint64_t mAllocID;
+        /** Magazines by allocation size */
+        std::array<Magazine, MAGAZINE_CLASSES> mMagazines {};
+
+        ThreadCache(CachingAllocator& alloc, uint64_t allocID) : mAlloc(&alloc), mAllocID(allocID) { }
+    };
+
+    /** The list of a thread's caches, returns their allocations when the thread exits */
+    struct ThreadCacheList
+    {
+        std::vector<std::shared_ptr<ThreadCache>> mCaches;
+        ThreadCacheList() = default;
+        ~ThreadCacheList();
+        DELETE_COPY(ThreadCacheList)
+        DELETE_MOVE(ThreadCacheList)
+    };
+
+    /** Returns the calling thread's cache for this allocator, creating it if needed */
+    ThreadCache& GetThreadCache();
+
+    /** Returns the cache's magazine for the given size, claiming an empty one if needed (nullptr if none) */
+    static Magazine* GetMagazine(ThreadCache& cache, size_t pages);
+
+    /** Moves up to half a magazine of exactly-sized allocations from the free pool into the (empty) magazine */
+    void RefillMagazine(Magazine& magazine, const LockGuard& lock);
+
+    /** Removes and returns the most recent allocation from a non-empty magazine */
+    void* PopMagazine(Magazine& magazine) const;
+
+    /** Moves the given number of the oldest allocations from the magazine to the free pool */
+    void SpillMagazine(Magazine& magazine, size_t count);
+
     /** 
-     * Adds an entry to the appropriate freeList and FreeQueue
+     * Adds an entry to the appropriate freeList, FreeQueue and mFreeBlocks
      * @return the resulting size of the free list aded to
      */
     size_t add_entry(void* ptr, size_t pages, const LockGuard& lock) noexcept;
 
+    /** 
+     * Adds an entry like add_entry(), first merging it with free neighbors in the same OS allocation
+     * @return the resulting size of the free list aded to
+     */
+    size_t add_merged(void* ptr, size_t pages, const LockGuard& lock);
+
+    /** Removes the free block starting at ptr from all free structures */
+    void remove_entry(void* ptr, const LockGuard& lock);
+
     /** Removes and returns to the OS the last freed allocation */
     void pop_last_entry(const LockGuard& lock);
 
+    /** Removes the given number of pages from the free pool accounting, and returns them to the OS if over the max */
+    void add_free(size_t pages, const LockGuard& lock);
+
+    /** Removes the given range from mChunks after returning it to the OS */
+    void remove_chunk(uint8_t* ptr, size_t pages, const LockGuard& lock);
+
     mutable Debug mDebug;
     mutable std::mutex mMutex;
 
@@ -112,6 +198,17 @@ private:
     using FreeQueue = Andromeda::OrderedMap<void*, 
         std::pair<FreeListMap::iterator, FreeList::iterator>>;
     FreeQueue mFreeQueue;
+
+    /** Map of address to the number of pages of each free block, for finding neighbors to merge */
+    using BlockMap = std::map<uint8_t*, size_t>;
+    BlockMap mFreeBlocks;
+    /** Map of address to the number of pages of each allocation from the OS (or what's left of it) */
+    BlockMap mChunks;
+
+    /** Unique ID of this allocator for thread caches */
+    const uint64_t mAllocID;
+    /** All thread caches for this allocator (protected by mMutex) */
+    std::vector<std::shared_ptr<ThreadCache>> mThreadCaches;
 };
 
 /** C++ Allocator-compliant template wrapper for CachingAllocator */
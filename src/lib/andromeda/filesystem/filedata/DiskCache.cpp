@@ -0,0 +1,658 @@
+
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+
+#if LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif // LINUX
+
+#include "DiskCache.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+namespace { // anonymous
+
+/** Magic number at the start of every index file */
+constexpr uint32_t INDEX_MAGIC { 0x43443241 }; // "A2DC"
+/** Index file format version */
+constexpr uint32_t INDEX_VERSION { 2 };
+
+/** Index record types */
+constexpr uint8_t RECORD_REMOVE { 0 };
+constexpr uint8_t RECORD_ADD { 1 };
+
+/** Compact the index once it has this many times as many records as page ranges (plus JOURNAL_BATCH) */
+constexpr uint64_t COMPACT_FACTOR { 4 };
+
+constexpr const char* DATA_EXT { ".data" };
+constexpr const char* INDEX_EXT { ".index" };
+
+/** Returns the hex encoding of the given file ID (safe for a filename) */
+std::string EncodeID(const std::string& fileID)
+{
+    static constexpr const char* digits { "0123456789abcdef" };
+    std::string ret; ret.reserve(fileID.size()*2);
+    for (const char chr : fileID)
+    {
+        const auto byte { static_cast<unsigned char>(chr) };
+        ret += digits[byte >> 4]; ret += digits[byte & 0xF];
+    }
+    return ret;
+}
+
+/** Returns the file ID for the given hex encoding, or an empty string if invalid */
+std::string DecodeID(const std::string& encoded)
+{
+    if (encoded.size() % 2) return "";
+    std::string ret; ret.reserve(encoded.size()/2);
+    for (size_t idx { 0 }; idx < encoded.size(); idx += 2)
+    {
+        const std::string byte { encoded.substr(idx,2) };
+        if (byte.find_first_not_of("0123456789abcdef") != std::string::npos) return "";
+        ret += static_cast<char>(std::stoul(byte, nullptr, 16));
+    }
+    return ret;
+}
+
+template<typename T>
+void WriteValue(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value)); // NOLINT(*-reinterpret-cast)
+}
+
+template<typename T>
+T ReadValue(std::istream& in)
+{
+    T value { };
+    in.read(reinterpret_cast<char*>(&value), sizeof(value)); // NOLINT(*-reinterpret-cast)
+    return value;
+}
+
+/** Writes the index file header for the given file info */
+template<typename Info>
+void WriteHeader(std::ostream& out, const Info& info)
+{
+    WriteValue(out, INDEX_MAGIC);
+    WriteValue(out, INDEX_VERSION);
+    WriteValue(out, static_cast<uint64_t>(info.pageSize));
+    WriteValue(out, info.fileSize);
+    WriteValue(out, info.modified);
+}
+
+/** Writes a single index record */
+void WriteRecord(std::ostream& out, const uint8_t type, const uint64_t start, const uint64_t count)
+{
+    WriteValue(out, type);
+    WriteValue(out, start);
+    WriteValue(out, count);
+}
+
+} // namespace
+
+/*****************************************************/
+DiskCache::DiskCache(const std::string& path, const uint64_t sizeLimit) :
+    mDebug(__func__,this), mPath(path), mSizeLimit(sizeLimit)
+{
+    MDBG_INFO("(path:" << path << " sizeLimit:" << sizeLimit << ")");
+
+    FilesList journals; { // lock scope
+        const UniqueLock lock(mMutex);
+        std::error_code error;
+        std::filesystem::create_directories(mPath, error);
+        if (error) { MDBG_ERROR("... create error: " << error.message()); return; }
+
+        LoadIndexes(lock);
+        MakeRoom(0, journals, lock); // in case the limit shrank
+
+        MDBG_INFO("... files:" << mEntries.size() << " pages:" << mPageQueue.size() << " size:" << mCurrentSize);
+    }
+    WriteJournals(journals);
+}
+
+/*****************************************************/
+DiskCache::~DiskCache()
+{
+    MDBG_INFO("()");
+
+    FilesList filesList; { // lock scope
+        const UniqueLock lock(mMutex);
+        for (const EntryMap::value_type& entry : mEntries)
+            filesList.emplace_back(entry.second.files);
+    }
+    CloseFiles(filesList);
+}
+
+/*****************************************************/
+size_t DiskCache::GetPageSize(const FileInfo& info, const uint64_t index)
+{
+    const uint64_t pageStart { index*info.pageSize };
+    if (pageStart >= info.fileSize) return 0;
+    return static_cast<size_t>(std::min(static_cast<uint64_t>(info.pageSize), info.fileSize-pageStart));
+}
+
+/*****************************************************/
+std::filesystem::path DiskCache::GetDataPath(const std::string& fileID) const
+{
+    return mPath / (EncodeID(fileID)+DATA_EXT);
+}
+
+/*****************************************************/
+std::filesystem::path DiskCache::GetIndexPath(const std::string& fileID) const
+{
+    return mPath / (EncodeID(fileID)+INDEX_EXT);
+}
+
+/*****************************************************/
+void DiskCache::LoadIndexes(const UniqueLock& lock)
+{
+    std::error_code error;
+    for (const std::filesystem::directory_entry& dirent : std::filesystem::directory_iterator(mPath, error))
+    {
+        std::error_code ignore;
+        if (dirent.path().extension() == ".tmp") // interrupted CompactIndex
+            { std::filesystem::remove(dirent.path(), ignore); continue; }
+        if (dirent.path().extension() != INDEX_EXT) continue;
+        const std::string fileID { DecodeID(dirent.path().stem().string()) };
+
+        std::ifstream in(dirent.path(), std::ios::binary);
+        const uint32_t magic { ReadValue<uint32_t>(in) };
+        const uint32_t version { ReadValue<uint32_t>(in) };
+
+        FileInfo info { };
+        info.pageSize = static_cast<size_t>(ReadValue<uint64_t>(in));
+        info.fileSize = ReadValue<uint64_t>(in);
+        info.modified = ReadValue<double>(in);
+
+        if (!in || fileID.empty() || magic != INDEX_MAGIC || version != INDEX_VERSION || !info.pageSize)
+        {
+            MDBG_ERROR("... bad index " << dirent.path());
+            std::filesystem::path dataPath { dirent.path() };
+            std::filesystem::remove(dirent.path(), ignore);
+            std::filesystem::remove(dataPath.replace_extension(DATA_EXT), ignore);
+            continue;
+        }
+
+        // replay the records - a partial one at the end means it's not trustworthy
+        RangeSet<uint64_t> indexed;
+        uint64_t records { 0 };
+        while (in.peek() != std::ifstream::traits_type::eof())
+        {
+            const uint8_t type { ReadValue<uint8_t>(in) };
+            const uint64_t start { ReadValue<uint64_t>(in) };
+            const uint64_t count { ReadValue<uint64_t>(in) };
+            if (type > RECORD_ADD) in.setstate(std::ios::failbit);
+            if (!in) break;
+
+            if (type == RECORD_ADD) indexed.insert(start, count);
+            else indexed.erase(start, count);
+            ++records;
+        }
+
+        Entry& entry { NewEntry(fileID, info, false, lock) };
+        if (!in) { MDBG_ERROR("... truncated index " << dirent.path()); RemoveEntry(fileID, lock); continue; }
+
+        for (RangeSet<uint64_t>::const_iterator it { indexed.cbegin() }; it != indexed.cend(); ++it)
+        {
+            for (uint64_t index { it->first }; index < it->second.end; ++index)
+            {
+                const size_t pageSize { GetPageSize(info, index) };
+                if (!pageSize) break;
+                entry.pages.emplace(index, mPageQueue.emplace(mPageQueue.end(), &entry, index));
+                mCurrentSize += pageSize;
+            }
+        }
+        entry.files->mIndexed = std::move(indexed);
+        entry.files->mRecords = records;
+
+        if (entry.pages.empty()) RemoveEntry(fileID, lock);
+    }
+    if (error) { MDBG_ERROR("... list error: " << error.message()); }
+
+    // data files whose index was dropped (see DropIndex) can never be used
+    for (const std::filesystem::directory_entry& dirent : std::filesystem::directory_iterator(mPath, error))
+    {
+        if (dirent.path().extension() != DATA_EXT) continue;
+        if (mEntries.count(DecodeID(dirent.path().stem().string()))) continue;
+
+        MDBG_INFO("... removing orphan " << dirent.path());
+        std::error_code ignore; std::filesystem::remove(dirent.path(), ignore);
+    }
+}
+
+/*****************************************************/
+DiskCache::Entry* DiskCache::GetEntry(const std::string& fileID, const FileInfo& info, const UniqueLock& lock)
+{
+    const EntryMap::iterator it { mEntries.find(fileID) };
+    if (it == mEntries.end()) return nullptr;
+
+    if (it->second.info != info)
+    {
+        MDBG_INFO("(fileID:" << fileID << ") stale, removing");
+        RemoveEntry(fileID, lock);
+        return nullptr;
+    }
+    return &it->second;
+}
+
+/*****************************************************/
+DiskCache::Entry& DiskCache::NewEntry(const std::string& fileID, const FileInfo& info, const bool newIndex, const UniqueLock& lock)
+{
+    return mEntries.emplace(fileID, Entry{fileID, info, {}, {},
+        std::make_shared<EntryFiles>(GetDataPath(fileID), GetIndexPath(fileID), info, newIndex), false, {}}).first->second;
+}
+
+/*****************************************************/
+void DiskCache::TouchFiles(Entry& entry, FilesList& toClose, const UniqueLock& lock)
+{
+    if (entry.isOpen) mOpenQueue.splice(mOpenQueue.begin(), mOpenQueue, entry.openIt);
+    else
+    {
+        entry.openIt = mOpenQueue.emplace(mOpenQueue.begin(), &entry);
+        entry.isOpen = true;
+    }
+
+    while (mOpenQueue.size() > MAX_OPEN_FILES)
+    {
+        Entry& oldEntry { *mOpenQueue.back() };
+        oldEntry.isOpen = false;
+        toClose.emplace_back(oldEntry.files);
+        mOpenQueue.pop_back();
+    }
+}
+
+/*****************************************************/
+void DiskCache::CloseFiles(const FilesList& filesList)
+{
+    for (const FilesPtr& files : filesList)
+    {
+        const UniqueLock filesLock(files->mMutex);
+        WriteJournal(*files, true, filesLock);
+        files->mData.close(); files->mData.clear();
+        files->mIndex.close(); files->mIndex.clear();
+    }
+}
+
+/*****************************************************/
+void DiskCache::AddRecord(Entry& entry, const uint64_t index, const bool add, const UniqueLock& lock)
+{
+    EntryFiles& files { *entry.files };
+    const UniqueLock filesLock(files.mMutex);
+
+    if (!files.mJournal.empty())
+    {
+        Record& last { files.mJournal.back() };
+        if (last.add == add && last.start + last.count == index) { ++last.count; return; }
+    }
+    files.mJournal.push_back({ index, 1, add });
+}
+
+/*****************************************************/
+bool DiskCache::OpenData(EntryFiles& files, const UniqueLock& filesLock)
+{
+    if (files.mRemoved) return false;
+    if (files.mData.is_open()) return true;
+
+    constexpr std::ios::openmode mode { std::ios::binary | std::ios::in | std::ios::out };
+    files.mData.open(files.mDataPath, mode);
+    if (!files.mData.is_open()) // create
+    {
+        files.mData.clear();
+        { const std::ofstream create(files.mDataPath, std::ios::binary); }
+        files.mData.open(files.mDataPath, mode);
+    }
+
+    if (!files.mData.is_open())
+    {
+        MDBG_ERROR("(" << files.mDataPath << ") open failed");
+        files.mData.clear(); return false;
+    }
+    return true;
+}
+
+/*****************************************************/
+bool DiskCache::OpenIndex(EntryFiles& files, const UniqueLock& filesLock)
+{
+    if (files.mRemoved || files.mNoIndex) return false;
+    if (files.mIndex.is_open()) return true;
+
+    if (files.mNewIndex)
+    {
+        files.mIndex.open(files.mIndexPath, std::ios::binary | std::ios::trunc);
+        WriteHeader(files.mIndex, files.mInfo);
+        files.mNewIndex = false;
+    }
+    else files.mIndex.open(files.mIndexPath, std::ios::binary | std::ios::app);
+
+    if (!files.mIndex)
+    {
+        MDBG_ERROR("(" << files.mIndexPath << ") open failed");
+        DropIndex(files, filesLock); return false;
+    }
+    return true;
+}
+
+/*****************************************************/
+void DiskCache::DropIndex(EntryFiles& files, const UniqueLock& filesLock)
+{
+    files.mIndex.close(); files.mIndex.clear();
+    std::error_code error; // ignore errors
+    std::filesystem::remove(files.mIndexPath, error);
+    files.mNoIndex = true;
+}
+
+/*****************************************************/
+void DiskCache::WriteJournal(EntryFiles& files, const bool force, const UniqueLock& filesLock)
+{
+    if (files.mRemoved) { files.mJournal.clear(); return; }
+    if (files.mJournal.empty() || (!force && files.mJournal.size() < JOURNAL_BATCH)) return;
+
+    const bool wasOpen { files.mIndex.is_open() };
+    if (OpenIndex(files, filesLock))
+    {
+        for (const Record& record : files.mJournal)
+        {
+            WriteRecord(files.mIndex, record.add ? RECORD_ADD : RECORD_REMOVE, record.start, record.count);
+            if (record.add) files.mIndexed.insert(record.start, record.count);
+            else files.mIndexed.erase(record.start, record.count);
+            ++files.mRecords;
+        }
+
+        // removals must be written before the space is given back
+        files.mIndex.flush();
+        if (!files.mIndex)
+        {
+            MDBG_ERROR("(" << files.mIndexPath << ") write failed");
+            DropIndex(files, filesLock);
+        }
+        else if (files.mRecords > COMPACT_FACTOR*files.mIndexed.size() + JOURNAL_BATCH)
+            CompactIndex(files, filesLock);
+    }
+
+#if LINUX // give the space of removed pages back to the filesystem (the file stays sparse)
+    RangeSet<uint64_t> punch;
+    for (const Record& record : files.mJournal)
+        if (!record.add) punch.insert(record.start, record.count);
+
+    const int fd { punch.empty() ? -1 : ::open(files.mDataPath.c_str(), O_WRONLY) }; // NOLINT(*-vararg)
+    if (fd >= 0)
+    {
+        ++files.mPunches;
+        const uint64_t pageSize { files.mInfo.pageSize };
+        for (RangeSet<uint64_t>::const_iterator it { punch.cbegin() }; it != punch.cend(); ++it)
+        {
+            if (::fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    static_cast<off_t>(it->first*pageSize), static_cast<off_t>((it->second.end-it->first)*pageSize)) != 0)
+                { MDBG_INFO("... punch hole not supported"); break; }
+        }
+        ::close(fd);
+    }
+#endif // LINUX
+
+    files.mJournal.clear();
+    if (!wasOpen) { files.mIndex.close(); files.mIndex.clear(); } // don't count against MAX_OPEN_FILES
+}
+
+/*****************************************************/
+void DiskCache::WriteJournals(FilesList& filesList)
+{
+    std::sort(filesList.begin(), filesList.end());
+    filesList.erase(std::unique(filesList.begin(), filesList.end()), filesList.end());
+
+    for (const FilesPtr& files : filesList)
+    {
+        const UniqueLock filesLock(files->mMutex);
+        WriteJournal(*files, true, filesLock);
+    }
+}
+
+/*****************************************************/
+void DiskCache::CompactIndex(EntryFiles& files, const UniqueLock& filesLock)
+{
+    MDBG_INFO("(" << files.mIndexPath << ") records:" << files.mRecords << " ranges:" << files.mIndexed.size());
+
+    std::filesystem::path tmpPath { files.mIndexPath }; tmpPath += ".tmp";
+    { // write scope
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        WriteHeader(out, files.mInfo);
+        for (RangeSet<uint64_t>::const_iterator it { files.mIndexed.cbegin() }; it != files.mIndexed.cend(); ++it)
+            WriteRecord(out, RECORD_ADD, it->first, it->second.end - it->first);
+        out.flush();
+        if (!out) { MDBG_ERROR("... write failed"); return; } // keep the old one
+    }
+
+    // replace atomically so a crash never leaves a half-written index
+    files.mIndex.close(); files.mIndex.clear();
+    std::error_code error;
+    std::filesystem::rename(tmpPath, files.mIndexPath, error);
+    if (error) { MDBG_ERROR("... rename failed: " << error.message()); DropIndex(files, filesLock); return; }
+
+    files.mRecords = files.mIndexed.size();
+    OpenIndex(files, filesLock);
+}
+
+/*****************************************************/
+bool DiskCache::HasPage(const std::string& fileID, const uint64_t index, const FileInfo& info)
+{
+    const UniqueLock lock(mMutex);
+    const Entry* entry { GetEntry(fileID, info, lock) };
+    return entry != nullptr && entry->pages.count(index);
+}
+
+/*****************************************************/
+bool DiskCache::ReadPage(const std::string& fileID, const uint64_t index, const FileInfo& info, char* buffer, const size_t size)
+{
+    MDBG_INFO("(fileID:" << fileID << " index:" << index << " size:" << size << ")");
+
+    FilesPtr files; uint64_t punches { 0 };
+    FilesList toClose; { // lock scope
+        const UniqueLock lock(mMutex);
+        Entry* entry { GetEntry(fileID, info, lock) };
+        if (entry == nullptr || !entry->pages.count(index)
+            || size != GetPageSize(info, index)) { ++mMisses; return false; }
+
+        files = entry->files;
+        punches = files->mPunches.load();
+        TouchFiles(*entry, toClose, lock);
+    }
+    CloseFiles(toClose);
+
+    bool read { false }, raced { false };
+    { // lock scope
+        const UniqueLock filesLock(files->mMutex);
+        // the page may have been removed and its space given back since we checked
+        raced = files->mPunches.load() != punches;
+        if (!raced && OpenData(*files, filesLock))
+        {
+            files->mData.seekg(static_cast<std::streamoff>(index*info.pageSize));
+            files->mData.read(buffer, static_cast<std::streamsize>(size));
+            read = static_cast<bool>(files->mData);
+            files->mData.clear();
+        }
+    }
+
+    const UniqueLock lock(mMutex);
+    const EntryMap::iterator it { mEntries.find(fileID) };
+    Entry* entry { (it != mEntries.end() && it->second.files == files) ? &it->second : nullptr };
+    const decltype(Entry::pages)::iterator pageIt { (entry != nullptr) ? entry->pages.find(index) : decltype(Entry::pages)::iterator() };
+    const bool stored { entry != nullptr && pageIt != entry->pages.end() };
+
+    if (!read)
+    {
+        if (stored && !raced)
+        {
+            MDBG_ERROR("... read failed, removing page");
+            RemovePage(*entry, index, lock);
+            if (entry->pages.empty() && entry->storing.empty()) RemoveEntry(fileID, lock);
+        }
+        ++mMisses; return false;
+    }
+
+    if (stored) mPageQueue.splice(mPageQueue.begin(), mPageQueue, pageIt->second); // move to front
+    ++mHits; return true;
+}
+
+/*****************************************************/
+void DiskCache::StorePage(const std::string& fileID, const uint64_t index, const FileInfo& info, const char* data, const size_t size)
+{
+    MDBG_INFO("(fileID:" << fileID << " index:" << index << " size:" << size << ")");
+
+    // only whole pages exactly matching the backend file can be reused
+    if (!size || size != GetPageSize(info, index) || size > mSizeLimit) return;
+
+    FilesPtr files;
+    FilesList toClose; { // lock scope
+        const UniqueLock lock(mMutex);
+        Entry* entry { GetEntry(fileID, info, lock) }; // removes if stale
+        if (entry != nullptr && (entry->pages.count(index) || entry->storing.count(index))) return; // already have it
+        if (entry == nullptr) entry = &NewEntry(fileID, info, true, lock);
+
+        entry->storing.emplace(index);
+        files = entry->files;
+        TouchFiles(*entry, toClose, lock);
+    }
+    CloseFiles(toClose);
+
+    bool written { false };
+    { // lock scope
+        const UniqueLock filesLock(files->mMutex);
+        // a queued removal of this page would give back the space after we write it
+        const bool removing { std::any_of(files->mJournal.cbegin(), files->mJournal.cend(), [&](const Record& record){
+            return !record.add && index >= record.start && index < record.start + record.count; }) };
+        WriteJournal(*files, removing, filesLock);
+
+        if (OpenData(*files, filesLock))
+        {
+            files->mData.seekp(static_cast<std::streamoff>(index*info.pageSize));
+            files->mData.write(data, static_cast<std::streamsize>(size));
+            files->mData.flush();
+            written = static_cast<bool>(files->mData);
+            files->mData.clear();
+        }
+    }
+
+    FilesList journals; { // lock scope
+        const UniqueLock lock(mMutex);
+        const EntryMap::iterator it { mEntries.find(fileID) };
+        if (it == mEntries.end() || it->second.files != files) return; // removed
+        Entry& entry { it->second };
+        if (!entry.storing.erase(index)) return; // voided by RemovePages
+
+        if (!written)
+        {
+            MDBG_ERROR("... write failed");
+            if (entry.pages.empty() && entry.storing.empty()) RemoveEntry(fileID, lock);
+            return;
+        }
+
+        // add before MakeRoom so it doesn't remove our entry - it's at the front so not evicted
+        entry.pages.emplace(index, mPageQueue.emplace(mPageQueue.begin(), &entry, index));
+        mCurrentSize += size;
+        AddRecord(entry, index, true, lock);
+        MakeRoom(0, journals, lock);
+    }
+    WriteJournals(journals); // once per eviction batch
+}
+
+/*****************************************************/
+void DiskCache::RemovePages(const std::string& fileID, const uint64_t index, const uint64_t count)
+{
+    const UniqueLock lock(mMutex);
+    const EntryMap::iterator it { mEntries.find(fileID) };
+    if (it == mEntries.end()) return;
+    Entry& entry { it->second };
+
+    bool removed { false };
+    for (uint64_t curIndex { index }; curIndex < index+count; ++curIndex)
+    {
+        if (entry.storing.erase(curIndex)) removed = true;
+        if (entry.pages.count(curIndex)) { RemovePage(entry, curIndex, lock); removed = true; }
+    }
+    if (!removed) return;
+
+    // the records are written with the next batch - until then the data is still on disk
+    MDBG_INFO("(fileID:" << fileID << " index:" << index << " count:" << count << ")");
+    if (entry.pages.empty() && entry.storing.empty()) RemoveEntry(fileID, lock);
+}
+
+/*****************************************************/
+void DiskCache::Validate(const std::string& fileID, const FileInfo& info)
+{
+    const UniqueLock lock(mMutex);
+    GetEntry(fileID, info, lock); // removes if stale
+}
+
+/*****************************************************/
+void DiskCache::RemovePage(Entry& entry, const uint64_t index, const UniqueLock& lock)
+{
+    const decltype(Entry::pages)::iterator pageIt { entry.pages.find(index) };
+    if (pageIt == entry.pages.end()) return;
+
+    mPageQueue.erase(pageIt->second);
+    entry.pages.erase(pageIt);
+    mCurrentSize -= GetPageSize(entry.info, index);
+    AddRecord(entry, index, false, lock);
+}
+
+/*****************************************************/
+void DiskCache::RemoveEntry(const std::string& fileID, const UniqueLock& lock)
+{
+    MDBG_INFO("(fileID:" << fileID << ")");
+
+    // fileID might be the entry's own
+    const std::filesystem::path indexPath { GetIndexPath(fileID) };
+    const std::filesystem::path dataPath { GetDataPath(fileID) };
+
+    const EntryMap::iterator it { mEntries.find(fileID) };
+    if (it != mEntries.end())
+    {
+        Entry& entry { it->second };
+        for (const decltype(Entry::pages)::value_type& page : entry.pages)
+        {
+            mCurrentSize -= GetPageSize(entry.info, page.first);
+            mPageQueue.erase(page.second);
+        }
+        if (entry.isOpen) mOpenQueue.erase(entry.openIt);
+
+        // waits for any I/O in progress, after which nothing can recreate the files
+        const FilesPtr files { entry.files }; // keep the mutex alive
+        const UniqueLock filesLock(files->mMutex);
+        files->mRemoved = true;
+        files->mJournal.clear();
+        files->mData.close();
+        files->mIndex.close();
+        mEntries.erase(it);
+    }
+
+    std::error_code error; // ignore errors
+    std::filesystem::remove(indexPath, error);
+    std::filesystem::remove(dataPath, error);
+}
+
+/*****************************************************/
+void DiskCache::MakeRoom(const uint64_t bytes, FilesList& journals, const UniqueLock& lock)
+{
+    std::unordered_set<Entry*> evicted;
+    while (!mPageQueue.empty() && mCurrentSize + bytes > mSizeLimit)
+    {
+        const PageQueue::value_type lru { mPageQueue.back() };
+        evicted.emplace(lru.first);
+        RemovePage(*lru.first, lru.second, lock);
+        ++mEvicts;
+    }
+    if (evicted.empty()) return;
+
+    MDBG_INFO("(bytes:" << bytes << ") evicted from " << evicted.size() << " files");
+    for (Entry* entry : evicted)
+    {
+        if (entry->pages.empty() && entry->storing.empty()) RemoveEntry(entry->fileID, lock);
+        else journals.emplace_back(entry->files);
+    }
+}
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
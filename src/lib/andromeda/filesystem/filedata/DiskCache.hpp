@@ -0,0 +1,278 @@
+
+#ifndef LIBA2_DISKCACHE_H_
+#define LIBA2_DISKCACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "andromeda/common.hpp"
+#include "andromeda/Debug.hpp"
+#include "andromeda/RangeMap.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/**
+ * Persistent second-tier page cache on local disk, beneath the CacheManager
+ * Each backend file ID gets a sparse data file (pages stored at their file offsets)
+ * and an append-only index file - a header with the file size/mtime the pages are valid for,
+ * then records of page ranges added and removed.  Entries that don't match the current size/mtime are dropped.
+ * Pages are evicted LRU once the total stored size exceeds the limit.
+ * Disk errors are never fatal - the page is simply treated as not cached.
+ * Page data and index I/O is done without the cache-wide lock using each entry's own open files
+ * (see MAX_OPEN_FILES).  Index records are written in batches, and removed pages' disk space is only
+ * given back once their removal is written, so the index never lists a page whose data is gone.
+ * THREAD SAFE (INTERNAL LOCKS)
+ */
+class DiskCache
+{
+public:
+
+    /** The backend file metadata that cached pages are valid for */
+    struct FileInfo
+    {
+        /** The file's size on the backend */
+        uint64_t fileSize;
+        /** The file's modified time on the backend */
+        double modified;
+        /** The page size in use for the file */
+        size_t pageSize;
+
+        bool operator==(const FileInfo& rhs) const noexcept {
+            return fileSize == rhs.fileSize && modified == rhs.modified && pageSize == rhs.pageSize; }
+        bool operator!=(const FileInfo& rhs) const noexcept { return !(*this == rhs); }
+    };
+
+    /**
+     * Opens (creating if necessary) the cache directory and loads existing entries
+     * @param path the path of the cache directory
+     * @param sizeLimit the maximum total bytes of pages to store
+     */
+    DiskCache(const std::string& path, uint64_t sizeLimit);
+
+    /** Writes out all unwritten index records */
+    virtual ~DiskCache();
+    DELETE_COPY(DiskCache)
+    DELETE_MOVE(DiskCache)
+
+    /** Returns true if the given page is stored and valid for info */
+    bool HasPage(const std::string& fileID, uint64_t index, const FileInfo& info);
+
+    /**
+     * Reads the given page into buffer if it is stored and valid for info
+     * @param size the size of the page (must match what was stored)
+     * @return true if the page was read, false if not cached (or a disk error)
+     */
+    bool ReadPage(const std::string& fileID, uint64_t index, const FileInfo& info, char* buffer, size_t size);
+
+    /**
+     * Stores the given clean page, replacing any entries not valid for info
+     * Evicts least recently used pages if needed to stay within the size limit
+     */
+    void StorePage(const std::string& fileID, uint64_t index, const FileInfo& info, const char* data, size_t size);
+
+    /** Removes the given range of pages for a file (e.g. modified locally) */
+    void RemovePages(const std::string& fileID, uint64_t index, uint64_t count);
+
+    /** Drops all pages for a file if they are not valid for info (e.g. changed on the backend) */
+    void Validate(const std::string& fileID, const FileInfo& info);
+
+    /** A copy of some member variables for debugging */
+    struct Stats
+    {
+        uint64_t currentSize;
+        uint64_t sizeLimit;
+        size_t files;
+        size_t pages;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evicts;
+    };
+    /** Returns a copy of some member variables for debugging */
+    inline Stats GetStats() const
+    {
+        const UniqueLock lock(mMutex);
+        return { mCurrentSize, mSizeLimit, mEntries.size(), mPageQueue.size(), mHits, mMisses, mEvicts };
+    }
+
+    /** The maximum number of entries whose files are kept open */
+    static constexpr size_t MAX_OPEN_FILES { 64 };
+    /** The number of index records to queue before writing them (unless forced) */
+    static constexpr size_t JOURNAL_BATCH { 32 };
+
+private:
+
+    using UniqueLock = std::unique_lock<std::mutex>;
+
+    /** An index file record - a range of pages that was added or removed */
+    struct Record
+    {
+        uint64_t start;
+        uint64_t count;
+        bool add;
+    };
+
+    /**
+     * An entry's files and unwritten index records, shared so their I/O can be done without mMutex
+     * The lock order is DiskCache::mMutex then EntryFiles::mMutex, never the reverse
+     */
+    struct EntryFiles
+    {
+        EntryFiles(std::filesystem::path dataPath, std::filesystem::path indexPath, const FileInfo& info, bool newIndex) :
+            mDataPath(std::move(dataPath)), mIndexPath(std::move(indexPath)), mInfo(info), mNewIndex(newIndex) { }
+
+        const std::filesystem::path mDataPath;
+        const std::filesystem::path mIndexPath;
+        /** The file info the pages are valid for (the index header) */
+        const FileInfo mInfo;
+
+        /** Mutex protecting all members below and the files on disk */
+        std::mutex mMutex;
+        /** The data file (opened when needed) */
+        std::fstream mData;
+        /** The index file, appending (opened when needed) */
+        std::ofstream mIndex;
+
+        /** Index records not yet written, in order */
+        std::vector<Record> mJournal;
+        /** The pages listed by the index file (to compact it) */
+        RangeSet<uint64_t> mIndexed;
+        /** The number of records in the index file */
+        uint64_t mRecords { 0 };
+        /** Incremented whenever disk space is given back, so a read without mMutex can tell it raced one */
+        std::atomic<uint64_t> mPunches { 0 };
+
+        /** True if the index file must be created with its header */
+        bool mNewIndex;
+        /** True if the index file could not be written - it's deleted and no longer updated */
+        bool mNoIndex { false };
+        /** True once the entry is removed - its files are deleted and must not be recreated */
+        bool mRemoved { false };
+    };
+    using FilesPtr = std::shared_ptr<EntryFiles>;
+    using FilesList = std::vector<FilesPtr>;
+
+    struct Entry;
+    /** LRU queue of stored pages, most recent at the front */
+    using PageQueue = std::list<std::pair<Entry*, uint64_t>>;
+    /** LRU queue of entries with open files, most recent at the front */
+    using OpenQueue = std::list<Entry*>;
+
+    /** A cached file and its stored pages */
+    struct Entry
+    {
+        /** The backend file ID */
+        std::string fileID;
+        /** The file info the pages are valid for */
+        FileInfo info;
+        /** Map of stored page index to its LRU queue position */
+        std::unordered_map<uint64_t, PageQueue::iterator> pages;
+        /** Pages being written by StorePage() - removing one voids the store */
+        std::unordered_set<uint64_t> storing;
+        /** The entry's files (never null) */
+        FilesPtr files;
+        /** True if in mOpenQueue at openIt */
+        bool isOpen { false };
+        OpenQueue::iterator openIt;
+    };
+    using EntryMap = std::unordered_map<std::string, Entry>;
+
+    /** Returns the size of the given page index according to info */
+    static size_t GetPageSize(const FileInfo& info, uint64_t index);
+
+    /** Returns the path of the data file for the given file ID */
+    std::filesystem::path GetDataPath(const std::string& fileID) const;
+    /** Returns the path of the index file for the given file ID */
+    std::filesystem::path GetIndexPath(const std::string& fileID) const;
+
+    /** Loads all index files in the cache directory, removing data files without one */
+    void LoadIndexes(const UniqueLock& lock);
+
+    /** Returns the entry for the given file if it's valid for info, else removes it and returns nullptr */
+    Entry* GetEntry(const std::string& fileID, const FileInfo& info, const UniqueLock& lock);
+
+    /** Adds a new entry for the given file (must not exist) */
+    Entry& NewEntry(const std::string& fileID, const FileInfo& info, bool newIndex, const UniqueLock& lock);
+
+    /** Marks the entry's files as recently used, adding entries whose files should be closed to toClose */
+    void TouchFiles(Entry& entry, FilesList& toClose, const UniqueLock& lock);
+
+    /** Writes out the index records and closes the given files (without mMutex) */
+    void CloseFiles(const FilesList& filesList);
+
+    /** Queues an index record for the given page (not written until WriteJournal) */
+    static void AddRecord(Entry& entry, uint64_t index, bool add, const UniqueLock& lock);
+
+    /** Opens the data file if not already open, returns false if removed or on failure */
+    bool OpenData(EntryFiles& files, const UniqueLock& filesLock);
+
+    /** Opens the index file (creating it if new) if not already open, returns false if removed or on failure */
+    bool OpenIndex(EntryFiles& files, const UniqueLock& filesLock);
+
+    /** Deletes the index file after a write failure so it never lists pages that may be gone */
+    void DropIndex(EntryFiles& files, const UniqueLock& filesLock);
+
+    /**
+     * Writes the queued index records, then gives back the disk space of removed pages
+     * @param force if false, only write if at least JOURNAL_BATCH records are queued
+     */
+    void WriteJournal(EntryFiles& files, bool force, const UniqueLock& filesLock);
+
+    /** Writes the queued index records of all the given files (without mMutex) */
+    void WriteJournals(FilesList& filesList);
+
+    /** Rewrites the index file with only the current page ranges */
+    void CompactIndex(EntryFiles& files, const UniqueLock& filesLock);
+
+    /** Removes a single page from its entry and the LRU (queues the index record) */
+    void RemovePage(Entry& entry, uint64_t index, const UniqueLock& lock);
+
+    /** Removes an entry and deletes its files */
+    void RemoveEntry(const std::string& fileID, const UniqueLock& lock);
+
+    /**
+     * Evicts least recently used pages until bytes more can be stored
+     * @param journals adds the files of entries whose pages were evicted, to write their index
+     */
+    void MakeRoom(uint64_t bytes, FilesList& journals, const UniqueLock& lock);
+
+    mutable Debug mDebug;
+
+    /** Path to the cache directory */
+    const std::filesystem::path mPath;
+    /** The maximum total bytes of pages to store */
+    const uint64_t mSizeLimit;
+    /** The current total bytes of pages stored */
+    uint64_t mCurrentSize { 0 };
+
+    /** Map of file ID to cache entry */
+    EntryMap mEntries;
+    /** LRU queue of all stored pages */
+    PageQueue mPageQueue;
+    /** LRU queue of entries whose files are open */
+    OpenQueue mOpenQueue;
+
+    /** Mutex protecting all members (not disk I/O, see EntryFiles) */
+    mutable std::mutex mMutex;
+
+    uint64_t mHits { 0 };
+    uint64_t mMisses { 0 };
+    uint64_t mEvicts { 0 };
+};
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
+
+#endif // LIBA2_DISKCACHE_H_
@@ -0,0 +1,226 @@
+
+#include "EvictPolicy.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/*****************************************************/
+std::unique_ptr<EvictPolicy> EvictPolicy::Create(const CacheOptions::EvictType type, const size_t capacity)
+{
+    switch (type)
+    {
+        case CacheOptions::EvictType::TWOQUEUE: return std::make_unique<TwoQueueEvictPolicy>(capacity);
+        case CacheOptions::EvictType::LRU: default: return std::make_unique<LruEvictPolicy>();
+    }
+}
+
+/*****************************************************/
+const char* EvictPolicy::TypeToString(const CacheOptions::EvictType type)
+{
+    switch (type)
+    {
+        case CacheOptions::EvictType::LRU:      return "lru";
+        case CacheOptions::EvictType::TWOQUEUE: return "2q";
+        default: return "unknown";
+    }
+}
+
+/*****************************************************/
+const Page* EvictPolicy::GetVictim() const
+{
+    const std::vector<const Page*> victims { GetVictims(1) };
+    return victims.empty() ? nullptr : victims.front();
+}
+
+/*****************************************************/
+void LruEvictPolicy::AddPage(const Page& page, const PageKey& key, const size_t size, const uint64_t epoch)
+{
+    mPageQueue.enqueue_front(&page, size);
+}
+
+/*****************************************************/
+void LruEvictPolicy::AccessPage(const Page& page, const size_t size, const uint64_t epoch)
+{
+    mPageQueue.erase(&page); // move to front
+    mPageQueue.enqueue_front(&page, size);
+}
+
+/*****************************************************/
+void LruEvictPolicy::ResizePage(const Page& page, const size_t size)
+{
+    const PageQueue::iterator pageIt { mPageQueue.find(&page) };
+    if (pageIt != mPageQueue.end()) pageIt->second = size;
+}
+
+/*****************************************************/
+void LruEvictPolicy::RemovePage(const Page& page)
+{
+    mPageQueue.erase(&page);
+}
+
+/*****************************************************/
+void LruEvictPolicy::DemotePage(const Page& page)
+{
+    size_t size { 0 };
+    if (mPageQueue.pop(&page, size)) // move to back
+        mPageQueue.enqueue_back(&page, size);
+}
+
+/*****************************************************/
+std::vector<const Page*> LruEvictPolicy::GetVictims(const size_t bytes) const
+{
+    std::vector<const Page*> victims;
+    size_t total { 0 };
+    for (PageQueue::const_reverse_iterator pageIt { mPageQueue.crbegin() };
+        pageIt != mPageQueue.crend() && total < bytes; ++pageIt)
+    {
+        victims.push_back(pageIt->first);
+        total += pageIt->second;
+    }
+    return victims;
+}
+
+/*****************************************************/
+TwoQueueEvictPolicy::TwoQueueEvictPolicy(const size_t capacity, const size_t inFrac, const size_t outFrac) :
+    mInFrac(inFrac), mOutFrac(outFrac), mInTarget(capacity/inFrac), mGhostTarget(capacity/outFrac) { }
+
+/*****************************************************/
+void TwoQueueEvictPolicy::SetCapacity(const size_t capacity)
+{
+    // pages over the new A1in target are simply evicted first (see GetVictims)
+    mInTarget = capacity/mInFrac;
+    mGhostTarget = capacity/mOutFrac;
+    TrimGhosts();
+}
+
+/*****************************************************/
+void TwoQueueEvictPolicy::TrimGhosts()
+{
+    while (mGhostBytes > mGhostTarget && !mGhostQueue.empty())
+        mGhostBytes -= mGhostQueue.pop_back().second;
+}
+
+/*****************************************************/
+void TwoQueueEvictPolicy::AddPage(const Page& page, const PageKey& key, const size_t size, const uint64_t epoch)
+{
+    size_t ghostSize { 0 };
+    if (mGhostQueue.pop(key, ghostSize)) // used again soon after eviction
+    {
+        mGhostBytes -= ghostSize;
+        ++mGhostHits;
+        mMainQueue.enqueue_front(&page, size);
+    }
+    else
+    {
+        mInQueue.enqueue_front(&page, InEntry{key, size, epoch});
+        mInBytes += size;
+    }
+}
+
+/*****************************************************/
+void TwoQueueEvictPolicy::AccessPage(const Page& page, const size_t size, const uint64_t epoch)
+{
+    const InQueue::iterator inIt { mInQueue.find(&page) };
+    if (inIt != mInQueue.end())
+    {
+        if (epoch <= inIt->second.added + mInTarget)
+        {
+            // re-use while new is correlated (e.g. the same sequential read), don't promote
+            mInBytes += size - inIt->second.size;
+            inIt->second.size = size;
+            return;
+        }
+
+        mInBytes -= inIt->second.size;
+        mInQueue.erase(&page); // promote
+    }
+    else mMainQueue.erase(&page); // move to front
+
+    mMainQueue.enqueue_front(&page, size);
+}
+
+/*****************************************************/
+void TwoQueueEvictPolicy::ResizePage(const Page& page, const size_t size)
+{
+    const InQueue::iterator inIt { mInQueue.find(&page) };
+    if (inIt != mInQueue.end())
+    {
+        mInBytes += size - inIt->second.size;
+        inIt->second.size = size;
+        return;
+    }
+
+    const MainQueue::iterator mainIt { mMainQueue.find(&page) };
+    if (mainIt != mMainQueue.end()) mainIt->second = size;
+}
+
+/*****************************************************/
+void TwoQueueEvictPolicy::RemovePage(const Page& page)
+{
+    InEntry entry { };
+    if (mInQueue.pop(&page, entry))
+    {
+        mInBytes -= entry.size;
+
+        // remember it as a ghost, forgetting the oldest
+        mGhostQueue.erase(entry.key); // sanity, should not exist
+        mGhostQueue.enqueue_front(entry.key, entry.size);
+        mGhostBytes += entry.size;
+        TrimGhosts();
+    }
+    else mMainQueue.erase(&page);
+}
+
+/*****************************************************/
+void TwoQueueEvictPolicy::DemotePage(const Page& page)
+{
+    size_t size { 0 };
+    InEntry entry { };
+    if (mInQueue.pop(&page, entry))
+    {
+        mInBytes -= entry.size;
+        size = entry.size;
+    }
+    else if (!mMainQueue.pop(&page, size)) return; // not cached
+
+    mMainQueue.enqueue_back(&page, size); // LRU end
+}
+
+/*****************************************************/
+std::vector<const Page*> TwoQueueEvictPolicy::GetVictims(const size_t bytes) const
+{
+    std::vector<const Page*> victims;
+    size_t total { 0 };
+
+    // first the oldest new pages while A1in is over its target
+    InQueue::const_reverse_iterator inIt { mInQueue.crbegin() };
+    for (size_t inBytes { mInBytes }; inIt != mInQueue.crend() &&
+        inBytes > mInTarget && total < bytes; ++inIt)
+    {
+        victims.push_back(inIt->first);
+        total += inIt->second.size;
+        inBytes -= inIt->second.size;
+    }
+
+    // then the least recently used from Am
+    for (MainQueue::const_reverse_iterator mainIt { mMainQueue.crbegin() };
+        mainIt != mMainQueue.crend() && total < bytes; ++mainIt)
+    {
+        victims.push_back(mainIt->first);
+        total += mainIt->second;
+    }
+
+    // then the rest of A1in if Am is empty
+    for (; inIt != mInQueue.crend() && total < bytes; ++inIt)
+    {
+        victims.push_back(inIt->first);
+        total += inIt->second.size;
+    }
+
+    return victims;
+}
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
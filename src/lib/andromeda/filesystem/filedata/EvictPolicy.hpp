@@ -0,0 +1,196 @@
+#ifndef LIBA2_EVICTPOLICY_H_
+#define LIBA2_EVICTPOLICY_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "CacheOptions.hpp"
+#include "andromeda/common.hpp"
+#include "andromeda/OrderedMap.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+class Page;
+class PageManager;
+
+/** Identifies a page by its manager and index, remains valid after the Page is gone (for ghost entries) */
+struct PageKey
+{
+    const PageManager* pageMgr;
+    uint64_t index;
+
+    inline bool operator==(const PageKey& rhs) const noexcept {
+        return pageMgr == rhs.pageMgr && index == rhs.index; }
+};
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
+
+namespace std {
+/** Hash for using a PageKey in an unordered_map */
+template<> struct hash<Andromeda::Filesystem::Filedata::PageKey>
+{
+    inline size_t operator()(const Andromeda::Filesystem::Filedata::PageKey& key) const noexcept
+    {
+        return hash<const void*>()(key.pageMgr) ^ (hash<uint64_t>()(key.index) << 1);
+    }
+};
+} // namespace std
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/**
+ * Decides the order in which the CacheManager evicts pages
+ * The policy only orders pages, the CacheManager tracks memory usage and does the evicting
+ * Accesses are given an epoch - the total bytes added to the cache at the time of the access,
+ * as the CacheManager may only tell us about hits later, just before evicting
+ * NOT THREAD SAFE (protect externally)
+ */
+class EvictPolicy
+{
+public:
+
+    /** Returns a new policy of the given type for a cache of the given size in bytes */
+    static std::unique_ptr<EvictPolicy> Create(CacheOptions::EvictType type, size_t capacity);
+
+    /** Returns the name of the given policy type for debugging */
+    static const char* TypeToString(CacheOptions::EvictType type);
+
+    EvictPolicy() = default;
+    virtual ~EvictPolicy() = default;
+    DELETE_COPY(EvictPolicy)
+    DELETE_MOVE(EvictPolicy)
+
+    /** Informs us that a page was added to the cache (a miss) using the given memory size */
+    virtual void AddPage(const Page& page, const PageKey& key, size_t size, uint64_t epoch) = 0;
+
+    /** Informs us that a page in the cache was used again (a hit) and now uses the given memory size */
+    virtual void AccessPage(const Page& page, size_t size, uint64_t epoch) = 0;
+
+    /** Informs us that a page in the cache changed size without being used */
+    virtual void ResizePage(const Page& page, size_t size) = 0;
+
+    /** Informs us that a page left the cache (evicted or erased) */
+    virtual void RemovePage(const Page& page) = 0;
+
+    /** Informs us that a page in the cache won't be used again soon and should be evicted before others */
+    virtual void DemotePage(const Page& page) = 0;
+
+    /** Returns pages in the order they should be evicted, totalling at least the given bytes (or all pages) */
+    virtual std::vector<const Page*> GetVictims(size_t bytes) const = 0;
+
+    /** Informs us that the cache size in bytes changed (e.g. with memory pressure), default does nothing */
+    virtual void SetCapacity(size_t capacity) { }
+
+    /** Returns the first page that should be evicted, or nullptr if there are none */
+    const Page* GetVictim() const;
+};
+
+/**
+ * Evicts the least recently used page first
+ * A single scan larger than the cache will evict every other page
+ * NOT THREAD SAFE (protect externally)
+ */
+class LruEvictPolicy : public EvictPolicy
+{
+public:
+    void AddPage(const Page& page, const PageKey& key, size_t size, uint64_t epoch) override;
+    void AccessPage(const Page& page, size_t size, uint64_t epoch) override;
+    void ResizePage(const Page& page, size_t size) override;
+    void RemovePage(const Page& page) override;
+    void DemotePage(const Page& page) override;
+    std::vector<const Page*> GetVictims(size_t bytes) const override;
+
+private:
+
+    /** LIFO queue of pages and their sizes for an LRU cache */
+    using PageQueue = OrderedMap<const Page*, size_t>;
+    PageQueue mPageQueue;
+};
+
+/**
+ * Scan-resistant "2Q" policy (Johnson & Shasha 1994, the full version)
+ * New pages go in a FIFO (A1in), re-use there is ignored while it's correlated (the same read or 
+ * read-ahead continuing), i.e. until the target size of A1in has been added to the cache after it.  Later re-use
+ * moves it to the main LRU (Am).  Pages evicted from A1in are remembered as ghosts by their PageKey (A1out),
+ * and go straight to Am if used again soon.  Pages used only once (e.g. a big cat) only ever cycle through A1in.
+ * Demoted pages go to the end of Am without becoming ghosts, so they are evicted first unless A1in is over target.
+ * NOT THREAD SAFE (protect externally)
+ */
+class TwoQueueEvictPolicy : public EvictPolicy
+{
+public:
+    /**
+     * @param capacity the cache size in bytes
+     * @param inFrac the fraction of capacity for new pages (A1in), before evicting them first
+     *   also the correlated reference period - should be more than a read-ahead (see ConfigOptions::readMaxCacheFrac)
+     * @param outFrac the fraction of capacity worth of ghost pages to remember (A1out)
+     */
+    explicit TwoQueueEvictPolicy(size_t capacity, size_t inFrac = 4, size_t outFrac = 2);
+
+    void AddPage(const Page& page, const PageKey& key, size_t size, uint64_t epoch) override;
+    void AccessPage(const Page& page, size_t size, uint64_t epoch) override;
+    void ResizePage(const Page& page, size_t size) override;
+    void RemovePage(const Page& page) override;
+    void DemotePage(const Page& page) override;
+    std::vector<const Page*> GetVictims(size_t bytes) const override;
+    void SetCapacity(size_t capacity) override;
+
+    /** Returns the number of pages added that were remembered as ghosts */
+    inline uint64_t GetGhostHits() const { return mGhostHits; }
+
+private:
+
+    /** Forgets the oldest ghosts while over mGhostTarget */
+    void TrimGhosts();
+
+    /** The fraction of capacity for mInTarget */
+    const size_t mInFrac;
+    /** The fraction of capacity for mGhostTarget */
+    const size_t mOutFrac;
+
+    /** A page in the A1in queue (remembers its key for the ghost queue) */
+    struct InEntry
+    {
+        PageKey key;
+        size_t size;
+        /** The epoch when added (for the correlated period) */
+        uint64_t added;
+    };
+
+    /** FIFO queue of new pages */
+    using InQueue = OrderedMap<const Page*, InEntry>;
+    InQueue mInQueue;
+    /** The total bytes of pages in mInQueue */
+    size_t mInBytes { 0 };
+    /** The maximum bytes in mInQueue before it is evicted first */
+    size_t mInTarget;
+
+    /** LRU queue of pages used again after being a ghost */
+    using MainQueue = OrderedMap<const Page*, size_t>;
+    MainQueue mMainQueue;
+
+    /** FIFO queue of ghost pages (evicted from mInQueue) and their sizes */
+    using GhostQueue = OrderedMap<PageKey, size_t>;
+    GhostQueue mGhostQueue;
+    /** The total bytes of pages in mGhostQueue */
+    size_t mGhostBytes { 0 };
+    /** The maximum bytes of pages in mGhostQueue */
+    size_t mGhostTarget;
+
+    /** The number of pages added that were ghosts */
+    uint64_t mGhostHits { 0 };
+};
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
+
+#endif // LIBA2_EVICTPOLICY_H_
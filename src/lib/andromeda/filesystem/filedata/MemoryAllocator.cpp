@@ -1,5 +1,6 @@
 
 #include <cassert>
+#include <cstring>
 #include <memory>
 #include <ostream>
 
@@ -17,19 +18,48 @@ namespace Andromeda {
 namespace Filesystem {
 namespace Filedata {
 
+namespace { // anonymous
+/** Returns the address of a pointer, for arena bookkeeping */
+inline uintptr_t toAddr(void* const ptr) { return reinterpret_cast<uintptr_t>(ptr); } // NOLINT(*-reinterpret-cast)
+/** Returns the pointer for an address from toAddr() */
+inline void* toPtr(const uintptr_t addr) { return reinterpret_cast<void*>(addr); } // NOLINT(*-reinterpret-cast,performance-no-int-to-ptr)
+} // namespace
+
 /*****************************************************/
-MemoryAllocator::MemoryAllocator() : 
+MemoryAllocator::MemoryAllocator(const HugePageOptions& hugeOptions) : 
     mPageSize(calcPageSize()),
+    mHugeOptions(hugeOptions),
     mDebug(__func__,this)
 {
-    MDBG_INFO("... mPageSize:" << mPageSize);
+    MDBG_INFO("... mPageSize:" << mPageSize << " hugePages:" << mHugeOptions.enable);
+
+    if (mHugeOptions.enable)
+    {
+        const LockGuard lock(mArenaMutex);
+        for (size_t reserved { 0 }; reserved < mHugeOptions.reserve; reserved += ARENA_SIZE)
+        {
+            void* const arena { mapArena(true) };
+            if (arena == nullptr) break; // try again later
+
+            const uintptr_t start { toAddr(arena) };
+            mArenas.emplace(start, true);
+            mArenaFree.insert(start, ARENA_SIZE);
+        }
+        MDBG_INFO("... reserved arenas:" << mArenas.size());
+    }
 }
 
-#if DEBUG // sanity checks
 /*****************************************************/
-MemoryAllocator::~MemoryAllocator(){ assert(mAllocMap.empty()); }
+MemoryAllocator::~MemoryAllocator()
+{
+#if DEBUG // sanity checks
+    assert(mAllocMap.empty());
 #endif // DEBUG
 
+    for (const decltype(mArenas)::value_type& arena : mArenas)
+        unmapArena(toPtr(arena.first));
+}
+
 /*****************************************************/
 size_t MemoryAllocator::calcPageSize() const
 {
@@ -42,18 +72,31 @@ size_t MemoryAllocator::calcPageSize() const
 #endif // WIN32
 }
 
+/*****************************************************/
+size_t MemoryAllocator::getArenaBytes() const
+{
+    const LockGuard lock(mArenaMutex);
+    return mArenas.size()*ARENA_SIZE;
+}
+
 /*****************************************************/
 void* MemoryAllocator::alloc(size_t pages)
 {
     if (!pages) return nullptr;
 
+    // larger allocations can't fit in an arena, they are already multiple TLB entries anyway
+    void* ptr { (mHugeOptions.enable && pages*mPageSize <= ARENA_SIZE) ? allocArena(pages*mPageSize) : nullptr };
+
+    if (ptr == nullptr)
+    {
 #if WIN32
-    LPVOID ptr = VirtualAlloc(nullptr, pages*mPageSize, 
-        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        ptr = VirtualAlloc(nullptr, pages*mPageSize, 
+            MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 #else // !WIN32
-    void* ptr = mmap(nullptr, pages*mPageSize, 
-        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        ptr = mmap(nullptr, pages*mPageSize, 
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 #endif // WIN32
+    }
     MDBG_INFO("(ptr:" << ptr << " pages:" << pages << " bytes:" << pages*mPageSize << ")");
 
 #if DEBUG // sanity checks
@@ -113,15 +156,135 @@ void MemoryAllocator::free(void* const ptr, const size_t pages)
 }
 #endif // DEBUG
 
+    if (!freeArena(ptr, pages*mPageSize))
+    {
 #if WIN32
-    VirtualFree(ptr, pages*mPageSize, MEM_RELEASE);
+        VirtualFree(ptr, pages*mPageSize, MEM_RELEASE);
 #else // !WIN32
-    munmap(ptr, pages*mPageSize);
+        munmap(ptr, pages*mPageSize);
 #endif // WIN32
+    }
 
     stats(__func__, pages, false);
 }
 
+/*****************************************************/
+void* MemoryAllocator::allocArena(const size_t bytes)
+{
+    const LockGuard lock(mArenaMutex);
+
+    // first fit - allocations are mostly the same size so there are few free ranges
+    for (RangeSet<uintptr_t>::const_iterator it { mArenaFree.cbegin() }; it != mArenaFree.cend(); ++it)
+    {
+        if (it->second.end - it->first < bytes) continue;
+
+        const uintptr_t start { it->first };
+        mArenaFree.erase(start, bytes);
+        return toPtr(start);
+    }
+
+    void* const arena { mapArena(false) };
+    if (arena == nullptr) return nullptr; // use a regular allocation
+
+    const uintptr_t start { toAddr(arena) };
+    mArenas.emplace(start, false);
+    mArenaFree.insert(start+bytes, ARENA_SIZE-bytes);
+
+    MDBG_INFO("... new arena:" << arena << " arenas:" << mArenas.size());
+    return arena;
+}
+
+/*****************************************************/
+bool MemoryAllocator::freeArena(void* const ptr, const size_t bytes)
+{
+    if (!mHugeOptions.enable) return false;
+
+    const uintptr_t start { toAddr(ptr) };
+    const LockGuard lock(mArenaMutex);
+
+    decltype(mArenas)::iterator it { mArenas.upper_bound(start) };
+    if (it == mArenas.begin() || start >= std::prev(it)->first + ARENA_SIZE) return false;
+    --it; // the arena containing start
+
+    mArenaFree.insert(start, bytes);
+
+    // free ranges coalesce, so an allocation may have spanned adjacent arenas
+    while (it != mArenas.end() && it->first < start+bytes)
+    {
+        const RangeSet<uintptr_t>::const_iterator freeIt { mArenaFree.find(it->first) };
+        if (!it->second && freeIt != mArenaFree.cend() && freeIt->second.end >= it->first + ARENA_SIZE)
+        {
+            MDBG_INFO("... unmap unused arena:" << toPtr(it->first));
+            mArenaFree.erase(it->first, ARENA_SIZE);
+            unmapArena(toPtr(it->first));
+            it = mArenas.erase(it);
+        }
+        else ++it;
+    }
+    return true;
+}
+
+/*****************************************************/
+void* MemoryAllocator::mapArena(const bool prefault)
+{
+#if WIN32
+    // large pages require the lock memory privilege, only get the arena's fewer, larger allocations
+    void* const ptr { VirtualAlloc(nullptr, ARENA_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE) };
+    if (ptr == nullptr) { MDBG_ERROR("... VirtualAlloc failed"); return nullptr; }
+#else // !WIN32
+    void* ptr { MAP_FAILED };
+#ifdef MAP_HUGETLB
+    // only works if the system has huge pages reserved (vm.nr_hugepages)
+    ptr = mmap(nullptr, ARENA_SIZE, PROT_READ | PROT_WRITE, 
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif // MAP_HUGETLB
+
+    if (ptr == MAP_FAILED) // transparent huge pages need an aligned mapping
+    {
+        void* const raw { mmap(nullptr, 2*ARENA_SIZE, PROT_READ | PROT_WRITE, 
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+        if (raw == MAP_FAILED) { MDBG_ERROR("... mmap failed"); return nullptr; }
+
+        uint8_t* const rawStart { static_cast<uint8_t*>(raw) };
+        const size_t headSize { (ARENA_SIZE - toAddr(raw) % ARENA_SIZE) % ARENA_SIZE };
+        if (headSize) munmap(rawStart, headSize);
+        munmap(rawStart+headSize+ARENA_SIZE, ARENA_SIZE-headSize);
+        ptr = rawStart+headSize;
+
+#ifdef MADV_HUGEPAGE
+        if (madvise(ptr, ARENA_SIZE, MADV_HUGEPAGE) != 0)
+            { MDBG_INFO("... madvise failed, no huge pages"); }
+#endif // MADV_HUGEPAGE
+    }
+#endif // WIN32
+
+    // fault in now rather than on first use
+    if (prefault) std::memset(ptr, 0, ARENA_SIZE);
+
+    if (mHugeOptions.lock)
+    {
+#if WIN32
+        const bool locked { VirtualLock(ptr, ARENA_SIZE) != 0 };
+#else // !WIN32
+        const bool locked { mlock(ptr, ARENA_SIZE) == 0 };
+#endif // WIN32
+        if (!locked) { MDBG_ERROR("... failed to lock arena (limit?)"); }
+    }
+
+    MDBG_INFO("(prefault:" << prefault << ") returning " << ptr);
+    return ptr;
+}
+
+/*****************************************************/
+void MemoryAllocator::unmapArena(void* const ptr)
+{
+#if WIN32
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else // !WIN32
+    munmap(ptr, ARENA_SIZE);
+#endif // WIN32
+}
+
 /*****************************************************/
 void MemoryAllocator::stats(const char* const fname, const size_t pages, bool alloc) 
 {
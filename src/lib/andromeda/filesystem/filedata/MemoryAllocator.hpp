@@ -9,13 +9,27 @@
 
 #include "andromeda/common.hpp"
 #include "andromeda/Debug.hpp"
+#include "andromeda/RangeMap.hpp"
 
 namespace Andromeda {
 namespace Filesystem {
 namespace Filedata {
 
+/** MemoryAllocator options for huge page arenas */
+struct HugePageOptions
+{
+    /** True to carve allocations from huge page arenas (see MemoryAllocator::ARENA_SIZE) */
+    bool enable { false };
+    /** Bytes of arenas to allocate and pre-fault at construction, kept until destructed */
+    size_t reserve { 0 };
+    /** True to lock arenas into memory (never swapped) */
+    bool lock { false };
+};
+
 /**
  * A raw, non-caching memory allocator that allocates pages directly from the OS, bypassing the C library.
+ * Can optionally carve allocations from huge page arenas to reduce TLB misses and page faults,
+ * using MAP_HUGETLB if the system has huge pages reserved, else transparent huge pages (madvise)
  * In DEBUG builds, verifies all calls to free() for validity.
  * THREAD SAFE (INTERNAL LOCKS)
  */
@@ -23,13 +37,12 @@ class MemoryAllocator
 {
 public:
 
-    explicit MemoryAllocator();
+    /** The size of each huge page arena (the usual huge page size) */
+    static constexpr size_t ARENA_SIZE { static_cast<size_t>(2)*1024*1024 };
+
+    explicit MemoryAllocator(const HugePageOptions& hugeOptions = HugePageOptions());
 
-#if DEBUG // sanity checks
     virtual ~MemoryAllocator();
-#else // !DEBUG
-    virtual ~MemoryAllocator() = default;
-#endif // DEBUG
     DELETE_COPY(MemoryAllocator)
     DELETE_MOVE(MemoryAllocator)
 
@@ -54,6 +67,9 @@ public:
     [[nodiscard]] inline size_t getNumBytes(const size_t bytes) const {
         return getNumPages(bytes)*getPageSize(); }
 
+    /** Returns the total bytes of huge page arenas currently mapped */
+    [[nodiscard]] size_t getArenaBytes() const;
+
 protected:
 
     /** The minimum size of OS memory mappings */
@@ -64,6 +80,24 @@ private:
     /** Ask the OS for the page granularity */
     [[nodiscard]] size_t calcPageSize() const;
 
+    /** Allocates the given number of bytes from the arenas, mapping a new one if needed (nullptr if failed) */
+    void* allocArena(size_t bytes);
+
+    /** 
+     * Returns the given bytes to the arenas if they are from one, unmapping arenas that become unused
+     * @return false if the bytes are not from an arena
+     */
+    bool freeArena(void* ptr, size_t bytes);
+
+    /** 
+     * Maps a new ARENA_SIZE arena from the OS (nullptr if failed)
+     * @param prefault if true, touch all of it now rather than on first use
+     */
+    void* mapArena(bool prefault);
+
+    /** Returns an arena from mapArena() to the OS */
+    void unmapArena(void* ptr);
+
     /** Updates and prints allocator statistics (debug) */
     void stats(const char* fname, size_t pages, bool alloc);
 
@@ -84,6 +118,15 @@ private:
     /** stat-counter mutex */
     std::mutex mMutex;
 
+    /** Huge page arena options */
+    const HugePageOptions mHugeOptions;
+    /** Map of each arena's start address to true if reserved (never unmapped until destructed) */
+    std::map<uintptr_t, bool> mArenas;
+    /** Free byte ranges (addresses) within the arenas */
+    RangeSet<uintptr_t> mArenaFree;
+    /** Mutex protecting the arenas */
+    mutable std::mutex mArenaMutex;
+
     using LockGuard = std::lock_guard<std::mutex>;
     mutable Debug mDebug;
 };
@@ -0,0 +1,150 @@
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "MemoryPressure.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+namespace { // anonymous
+
+/** The root of the cgroup v2 hierarchy */
+constexpr const char* CGROUP_ROOT { "/sys/fs/cgroup" };
+
+/** Reads a single number from the given file (e.g. memory.current), returning false if not a number (e.g. "max") */
+bool ReadNumber(const std::string& path, uint64_t& number)
+{
+    std::ifstream in(path);
+    return static_cast<bool>(in >> number);
+}
+
+/** Reads the memory limit of the given cgroup directory - memory.high if set, else memory.max */
+bool ReadCgroupLimit(const std::string& cgroupDir, uint64_t& limit)
+{
+    return ReadNumber(cgroupDir+"/memory.high", limit) ||
+           ReadNumber(cgroupDir+"/memory.max", limit);
+}
+
+} // namespace
+
+/*****************************************************/
+std::unique_ptr<MemoryPressure> MemoryPressure::Create(const CacheOptions::PressureSource source)
+{
+    std::string cgroupDir;
+    switch (source)
+    {
+        case CacheOptions::PressureSource::NONE: return nullptr;
+        case CacheOptions::PressureSource::CGROUP:
+            cgroupDir = SystemMemoryPressure::FindCgroup();
+            if (cgroupDir.empty()) return nullptr; // no limit
+            break;
+        case CacheOptions::PressureSource::AUTO:
+            cgroupDir = SystemMemoryPressure::FindCgroup(); break;
+        case CacheOptions::PressureSource::MEMINFO: default: break;
+    }
+
+    std::unique_ptr<MemoryPressure> pressure { std::make_unique<SystemMemoryPressure>(cgroupDir) };
+    Reading reading { };
+    if (!pressure->Read(reading)) return nullptr; // e.g. not Linux
+    return pressure;
+}
+
+/*****************************************************/
+SystemMemoryPressure::SystemMemoryPressure(const std::string& cgroupDir) :
+    mCgroupDir(cgroupDir), mDebug(__func__,this)
+{
+    MDBG_INFO("(cgroupDir:" << mCgroupDir << ")");
+}
+
+/*****************************************************/
+bool SystemMemoryPressure::Read(Reading& reading)
+{
+    { std::ifstream meminfo("/proc/meminfo");
+    if (!ParseMeminfo(meminfo, reading.total, reading.available))
+    {
+        MDBG_ERROR("... failed to read meminfo");
+        return false;
+    } }
+
+    if (!mCgroupDir.empty())
+    {
+        // the cgroup limit may be hit before the system runs out
+        uint64_t limit { 0 }; uint64_t current { 0 };
+        if (ReadCgroupLimit(mCgroupDir, limit) && ReadNumber(mCgroupDir+"/memory.current", current))
+        {
+            reading.total = std::min(reading.total, limit);
+            reading.available = std::min(reading.available, (limit > current) ? limit-current : 0);
+        }
+        else { MDBG_ERROR("... failed to read cgroup " << mCgroupDir); }
+    }
+
+    std::ifstream pressure(mCgroupDir.empty() ? "/proc/pressure/memory" : mCgroupDir+"/memory.pressure");
+    if (!ParsePressure(pressure, reading.stall)) reading.stall = 0; // kernel without PSI
+
+    MDBG_INFO("... total:" << reading.total << " available:" << reading.available << " stall:" << reading.stall);
+    return true;
+}
+
+/*****************************************************/
+std::string SystemMemoryPressure::FindCgroup()
+{
+    // cgroup v2 has a single line "0::/path"
+    std::ifstream in("/proc/self/cgroup");
+    std::string cgroupPath;
+    for (std::string line; std::getline(in, line); )
+    {
+        if (line.rfind("0::", 0) == 0) { cgroupPath = line.substr(3); break; }
+    }
+    if (cgroupPath.empty()) return ""; // not cgroup v2
+
+    // the limit may be set on a parent (e.g. a systemd slice)
+    while (!cgroupPath.empty() && cgroupPath != "/")
+    {
+        const std::string cgroupDir { CGROUP_ROOT+cgroupPath };
+        uint64_t limit { 0 };
+        if (ReadCgroupLimit(cgroupDir, limit)) return cgroupDir;
+        cgroupPath.erase(cgroupPath.rfind('/'));
+    }
+    return ""; // root has no limit
+}
+
+/*****************************************************/
+bool SystemMemoryPressure::ParseMeminfo(std::istream& in, uint64_t& total, uint64_t& available)
+{
+    bool hasTotal { false }; bool hasAvailable { false };
+    for (std::string line; std::getline(in, line) && !(hasTotal && hasAvailable); )
+    {
+        // e.g. "MemAvailable:   12345678 kB"
+        std::istringstream lineStr(line);
+        std::string name; uint64_t kbytes { 0 };
+        if (!(lineStr >> name >> kbytes)) continue;
+
+        if (name == "MemTotal:") { total = kbytes*1024; hasTotal = true; }
+        else if (name == "MemAvailable:") { available = kbytes*1024; hasAvailable = true; }
+    }
+    return hasTotal && hasAvailable;
+}
+
+/*****************************************************/
+bool SystemMemoryPressure::ParsePressure(std::istream& in, double& stall)
+{
+    // e.g. "some avg10=1.53 avg60=0.87 avg300=0.29 total=12345"
+    for (std::string line; std::getline(in, line); )
+    {
+        std::istringstream lineStr(line);
+        std::string type, avg10;
+        if (!(lineStr >> type >> avg10) || type != "some" || avg10.rfind("avg10=", 0) != 0) continue;
+
+        std::istringstream valueStr(avg10.substr(6));
+        return static_cast<bool>(valueStr >> stall);
+    }
+    return false;
+}
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,86 @@
+
+#ifndef LIBA2_MEMORYPRESSURE_H_
+#define LIBA2_MEMORYPRESSURE_H_
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+
+#include "CacheOptions.hpp"
+#include "andromeda/common.hpp"
+#include "andromeda/Debug.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/**
+ * A source of system memory pressure, for the CacheManager to size its memory limit by
+ * The interface is separate so a fake source can be given to the CacheManager for testing
+ * NOT THREAD SAFE (protect externally)
+ */
+class MemoryPressure
+{
+public:
+
+    /** A reading of the memory state */
+    struct Reading
+    {
+        /** The total memory we could be using (bytes) */
+        uint64_t total;
+        /** The memory that can still be allocated without reclaiming (bytes) */
+        uint64_t available;
+        /** The percent of recent time some tasks were stalled waiting on memory (0 if unknown) */
+        double stall;
+    };
+
+    /** Returns a new source of the given type, or nullptr if NONE or not available on this system */
+    static std::unique_ptr<MemoryPressure> Create(CacheOptions::PressureSource source);
+
+    MemoryPressure() = default;
+    virtual ~MemoryPressure() = default;
+    DELETE_COPY(MemoryPressure)
+    DELETE_MOVE(MemoryPressure)
+
+    /** Reads the current memory state, returning false if it could not be read */
+    virtual bool Read(Reading& reading) = 0;
+};
+
+/**
+ * Reads memory pressure from Linux - MemAvailable from /proc/meminfo, narrowed to the cgroup v2
+ * limit (memory.high, else memory.max, minus memory.current) if one is given.  The stall time is
+ * the "some avg10" PSI value of the same scope (memory.pressure, or /proc/pressure/memory).
+ * NOT THREAD SAFE (protect externally)
+ */
+class SystemMemoryPressure : public MemoryPressure
+{
+public:
+
+    /** @param cgroupDir the cgroup v2 directory with the memory limit, or empty to use the whole system */
+    explicit SystemMemoryPressure(const std::string& cgroupDir);
+
+    bool Read(Reading& reading) override;
+
+    /** Returns the closest cgroup v2 directory of this process (or a parent) with a memory limit, or empty if none */
+    static std::string FindCgroup();
+
+    /** Parses MemTotal and MemAvailable (bytes) from /proc/meminfo data, returning false if missing */
+    static bool ParseMeminfo(std::istream& in, uint64_t& total, uint64_t& available);
+
+    /** Parses the "some avg10" percent from PSI data (e.g. /proc/pressure/memory), returning false if missing */
+    static bool ParsePressure(std::istream& in, double& stall);
+
+private:
+
+    /** The cgroup v2 directory with the memory limit, or empty to use the whole system */
+    const std::string mCgroupDir;
+
+    mutable Debug mDebug;
+};
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
+
+#endif // LIBA2_MEMORYPRESSURE_H_
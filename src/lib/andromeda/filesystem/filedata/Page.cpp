@@ -1,5 +1,6 @@
 
 
+#include <algorithm>
 #include <cstring>
 
 #include "CachingAllocator.hpp"
@@ -21,11 +22,17 @@ Page::Page(Page&& page) noexcept : // move constructor
     mAlloc(page.mAlloc), 
     mBytes(page.mBytes), 
     mPages(page.mPages), 
-    mData(page.mData)
+    mData(page.mData),
+    mDirtyRanges(std::move(page.mDirtyRanges)),
+    mPartial(page.mPartial.load()),
+    mValidRanges(std::move(page.mValidRanges))
 {
     page.mBytes = 0;
     page.mPages = 0;
     page.mData = nullptr;
+    page.mDirtyRanges.clear();
+    page.mPartial.store(false);
+    page.mValidRanges.clear();
 }
 
 /*****************************************************/
@@ -41,9 +48,80 @@ size_t Page::capacity() const
     return mPages*mAlloc.getPageSize(); 
 }
 
+/*****************************************************/
+void Page::setDirty(bool dirty)
+{
+    mDirty = dirty;
+    if (!dirty) mDirtyRanges.clear();
+}
+
+/*****************************************************/
+void Page::addDirty(size_t offset, size_t length)
+{
+    mDirty = true;
+    mDirtyRanges.insert(offset, length);
+    if (mPartial.load(std::memory_order_relaxed))
+        mValidRanges.insert(offset, length);
+}
+
+/*****************************************************/
+bool Page::isValid(size_t offset, size_t length) const
+{
+    if (!isPartial() || !length) return true;
+
+    const ByteRanges::const_iterator it { mValidRanges.find(offset) };
+    return it != mValidRanges.cend() && it->second.end >= offset+length;
+}
+
+/*****************************************************/
+void Page::setPartial(size_t validStart)
+{
+    mValidRanges.clear();
+    if (validStart < mBytes)
+        mValidRanges.insert(validStart, mBytes-validStart);
+    mPartial.store(true, std::memory_order_release);
+}
+
+/*****************************************************/
+void Page::resolve(const Page& page)
+{
+    // copy each gap between the valid ranges - readers only access the valid bytes
+    const size_t copySize { std::min(mBytes, page.size()) };
+    ByteRanges::const_iterator it { mValidRanges.cbegin() };
+    for (size_t offset { 0 }; offset < copySize; ++it)
+    {
+        const bool last { it == mValidRanges.cend() };
+        const size_t gapEnd { last ? copySize : std::min(it->first, copySize) };
+        if (gapEnd > offset) std::memcpy(mData+offset, page.data()+offset, gapEnd-offset);
+
+        if (last) break;
+        offset = std::max(offset, it->second.end);
+    }
+
+    mPartial.store(false, std::memory_order_release);
+}
+
+/*****************************************************/
+void Page::copyFrom(const Page& page)
+{
+    resize(page.size());
+    if (mBytes) std::memcpy(mData, page.data(), mBytes);
+
+    mValidRanges = page.mValidRanges;
+    mPartial.store(page.isPartial(), std::memory_order_release);
+}
+
 /*****************************************************/
 void Page::resize(size_t newBytes)
 {
+    if (newBytes < mBytes) // drop ranges past the end
+    {
+        mDirtyRanges.erase(newBytes, mBytes-newBytes);
+        mValidRanges.erase(newBytes, mBytes-newBytes);
+    }
+    else if (newBytes > mBytes && mPartial.load(std::memory_order_relaxed))
+        mValidRanges.insert(mBytes, newBytes-mBytes); // past the backend's data
+
     const size_t newPages { mAlloc.getNumPages(newBytes) };
     if (newPages != mPages) // re-allocate
     {
@@ -54,11 +132,13 @@ void Page::resize(size_t newBytes)
             mAlloc.free(mData, mPages);
         }
 
-        mBytes = newBytes;
         mPages = newPages;
         mData = newData;
     }
-    else mBytes = newBytes;
+
+    if (newBytes > mBytes) std::memset(
+        mData+mBytes, 0, newBytes-mBytes);
+    mBytes = newBytes;
 }
 
 } // namespace Filedata
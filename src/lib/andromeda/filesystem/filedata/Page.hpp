@@ -2,7 +2,11 @@
 #ifndef LIBA2_PAGE_H_
 #define LIBA2_PAGE_H_
 
+#include <atomic>
+#include <cstdint>
+
 #include "andromeda/common.hpp"
+#include "andromeda/RangeMap.hpp"
 
 namespace Andromeda {
 namespace Filesystem {
@@ -10,11 +14,18 @@ namespace Filedata {
 
 class CachingAllocator;
 
-/** A file data page (manages memory pages) */
+/** 
+ * A file data page (manages memory pages)
+ * A page can be partial, where only some bytes are valid, if it was written without 
+ * first reading the backend's data - see isPartial() and resolve()
+ */
 class Page
 {
 public:
 
+    /** Set of byte ranges within a page */
+    using ByteRanges = RangeSet<size_t>;
+
     /** Construct a page with the given size in bytes and allocator */
     explicit Page(size_t pageSize, CachingAllocator& memAlloc);
 
@@ -33,12 +44,58 @@ public:
 
     /** Return true if the page is dirty (un-flushed data) */
     [[nodiscard]] inline bool isDirty() const { return mDirty; }
-    /** Set whether or not this page is dirty */
-    inline void setDirty(bool dirty = true){ mDirty = dirty; }
+    /** 
+     * Set whether or not this page is dirty - clearing also clears the dirty ranges
+     * A dirty page without dirty ranges is treated as entirely dirty
+     */
+    void setDirty(bool dirty = true);
+
+    /** Marks the given byte range dirty (and valid if partial) */
+    void addDirty(size_t offset, size_t length);
+    /** Returns the byte ranges written since the page was last clean */
+    [[nodiscard]] inline const ByteRanges& getDirtyRanges() const { return mDirtyRanges; }
+
+    /** Returns true if only the bytes in getValidRanges() are valid, the rest must be read from the backend */
+    [[nodiscard]] inline bool isPartial() const { return mPartial.load(std::memory_order_acquire); }
+    /** Returns the valid byte ranges, only meaningful if isPartial() */
+    [[nodiscard]] inline const ByteRanges& getValidRanges() const { return mValidRanges; }
+    /** Returns true if the given byte range is valid (always if not partial) */
+    [[nodiscard]] bool isValid(size_t offset, size_t length) const;
 
-    /** Resizes to the given # of bytes, possibly re-allocating */
+    /** 
+     * Marks the page as partial, with only the bytes from validStart (past the backend's data) valid 
+     * Bytes added by resize() or addDirty() are also valid
+     */
+    void setPartial(size_t validStart);
+
+    /** 
+     * Fills the bytes that are not valid from the given backend copy of this page and clears isPartial()
+     * May be run with concurrent readers of the valid bytes, but must be exclusive with other writers
+     */
+    void resolve(const Page& page);
+
+    /** Copies the data and valid ranges of the given page (not the dirty state), possibly re-allocating */
+    void copyFrom(const Page& page);
+
+    /** Resizes to the given # of bytes, possibly re-allocating - new bytes are zeroed */
     void resize(size_t bytes);
 
+    /** 
+     * State owned by the CacheManager - written under its lock, 
+     * but read without it to record hits (see CacheManager::InformPage)
+     */
+    struct CacheState
+    {
+        /** The memory usage the CacheManager has accounted for (0 if not cached) */
+        std::atomic<size_t> size { 0 };
+        /** True if the CacheManager has accounted the page as dirty */
+        std::atomic<bool> dirty { false };
+        /** The cache epoch+1 of a hit not yet given to the EvictPolicy (0 if none) */
+        std::atomic<uint64_t> hit { 0 };
+    };
+    /** Returns the CacheManager's state for this page */
+    [[nodiscard]] inline CacheState& getCacheState() const { return mCacheState; }
+
 private:
 
     // could use a std::vector with an Allocator instead of a raw buffer
@@ -54,6 +111,14 @@ private:
     char* mData;
     /** true if the page has dirty (un-flushed) data */
     bool mDirty { false };
+    /** Byte ranges written since the page was last clean (see setDirty) */
+    ByteRanges mDirtyRanges;
+    /** true if only mValidRanges are valid - only set with an exclusive lock, cleared by resolve() */
+    std::atomic<bool> mPartial { false };
+    /** Valid byte ranges if mPartial (not updated after it is cleared) */
+    ByteRanges mValidRanges;
+    /** State for the CacheManager (not moved) */
+    mutable CacheState mCacheState;
 };
 
 } // namespace Filedata
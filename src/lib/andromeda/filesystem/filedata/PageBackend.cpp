@@ -1,7 +1,13 @@
 
 #include <cassert>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
+#include <exception>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include "nlohmann/json.hpp"
 
 #include "Page.hpp"
@@ -9,7 +15,11 @@
 
 #include "andromeda/backend/BackendImpl.hpp"
 #include "andromeda/backend/RunnerInput.hpp"
+#include "andromeda/backend/RunnerPool.hpp"
+using Andromeda::Backend::RunnerPool;
 using Andromeda::Backend::WriteFunc;
+#include "andromeda/RangeMap.hpp"
+#include "andromeda/ThreadPool.hpp"
 #include "andromeda/filesystem/File.hpp"
 #include "andromeda/filesystem/Folder.hpp"
 
@@ -42,14 +52,118 @@ PageBackend::PageBackend(File& file, const std::string& fileID, const size_t pag
 
 /*****************************************************/
 size_t PageBackend::FetchPages(const uint64_t index, const size_t count, 
-    const PageBackend::PageHandler& pageHandler, const SharedLock& thisLock)
+    const PageBackend::PageHandler& pageHandler, const SharedLock& thisLock, const size_t streams)
 {
-    MDBG_INFO("(index:" << index << " count:" << count << ")");
+    MDBG_INFO("(index:" << index << " count:" << count << " streams:" << streams << ")");
 
     if (!count || (index+count-1)*mPageSize >= mBackendSize) 
         { MDBG_ERROR("() ERROR invalid index:" << index << " count:" << count 
             << " mBackendSize:" << mBackendSize << " mPageSize:" << mPageSize); assert(false); }
 
+    const size_t numStreams { std::max(streams, static_cast<size_t>(1)) };
+    const size_t subCount { (count+numStreams-1)/numStreams }; // pages per sub-range
+    bool cancelled { false };
+    if (subCount >= count) return FetchRange(index, count, pageHandler, cancelled);
+
+    /** A sub-range downloading in the background, buffering its pages */
+    struct SubFetch
+    {
+        uint64_t mIndex;
+        size_t mCount;
+        size_t mReadSize { 0 };
+        std::deque<std::pair<uint64_t, Page>> mPages;
+        bool mDone { false };
+        bool mCancelled { false };
+        std::exception_ptr mError;
+        std::mutex mMutex;
+        std::condition_variable mCV;
+        ThreadPool::TaskPtr mTask;
+    };
+
+    // the sub-ranges are only referenced by their tasks, which are all finished before returning
+    std::vector<std::unique_ptr<SubFetch>> subFetches;
+    for (uint64_t subIndex { index+subCount }; subIndex < index+count; subIndex += subCount)
+    {
+        subFetches.emplace_back(std::make_unique<SubFetch>());
+        SubFetch& sub { *subFetches.back() };
+        sub.mIndex = subIndex;
+        sub.mCount = min64st(index+count-subIndex, subCount);
+
+        sub.mTask = mBackend.GetThreadPool().Submit([this, &sub, priority { RunnerPool::GetPriority() }]()
+        {
+            const RunnerPool::PriorityScope priorityScope(priority); // same as the whole fetch
+            size_t readSize { 0 }; std::exception_ptr error; bool subCancelled { false };
+            try { readSize = FetchRange(sub.mIndex, sub.mCount, [&sub](const uint64_t pageIndex, Page&& page)->bool
+            {
+                const std::lock_guard<std::mutex> subLock(sub.mMutex);
+                if (sub.mCancelled) return false; // not wanted anymore
+                sub.mPages.emplace_back(pageIndex, std::move(page));
+                sub.mCV.notify_all(); return true;
+            }, subCancelled); }
+            catch (...) { error = std::current_exception(); }
+
+            const std::lock_guard<std::mutex> subLock(sub.mMutex);
+            sub.mReadSize = readSize;
+            sub.mError = error;
+            sub.mDone = true;
+            sub.mCV.notify_all();
+        });
+    }
+
+    size_t readSize { 0 }; try
+    {
+        readSize += FetchRange(index, subCount, pageHandler, cancelled);
+
+        for (const std::unique_ptr<SubFetch>& subPtr : subFetches)
+        {
+            if (cancelled) break; // the rest are stopped below
+            SubFetch& sub { *subPtr };
+            sub.mTask->TryRun(); // in case no worker has started it yet
+
+            std::unique_lock<std::mutex> subLock(sub.mMutex);
+            while (!cancelled)
+            {
+                while (sub.mPages.empty() && !sub.mDone) sub.mCV.wait(subLock);
+                if (sub.mPages.empty()) break; // done
+
+                std::pair<uint64_t, Page> page { std::move(sub.mPages.front()) };
+                sub.mPages.pop_front();
+
+                subLock.unlock(); // don't block the download
+                cancelled = !pageHandler(page.first, std::move(page.second));
+                subLock.lock();
+            }
+
+            if (sub.mError != nullptr && !cancelled) std::rethrow_exception(sub.mError);
+        }
+    }
+    catch (...)
+    {
+        // the sub-ranges reference our stack, make sure they are finished
+        for (const std::unique_ptr<SubFetch>& subPtr : subFetches)
+            if (!subPtr->mTask->Cancel()) subPtr->mTask->Wait();
+        throw;
+    }
+
+    // the sub-ranges are stopped at their next page if cancelled, else already done
+    for (const std::unique_ptr<SubFetch>& subPtr : subFetches)
+    {
+        SubFetch& sub { *subPtr };
+        { const std::lock_guard<std::mutex> subLock(sub.mMutex);
+            sub.mCancelled = cancelled; }
+        if (!sub.mTask->Cancel()) sub.mTask->Wait();
+        readSize += sub.mReadSize; // done, no lock needed
+    }
+
+    if (cancelled) { MDBG_INFO("... cancelled after " << readSize << " bytes"); }
+    return readSize;
+}
+
+/*****************************************************/
+size_t PageBackend::FetchRange(const uint64_t index, const size_t count, const PageBackend::PageHandler& pageHandler, bool& cancelled)
+{
+    MDBG_INFO("(index:" << index << " count:" << count << ")");
+
     const uint64_t pageStart { index*mPageSize }; // offset of the page start
     const size_t readSize { min64st(mBackendSize-pageStart, mPageSize*count) }; // length of data to fetch
 
@@ -59,8 +173,8 @@ size_t PageBackend::FetchPages(const uint64_t index, const size_t count,
     std::unique_ptr<Page> curPage;
 
     const char* const fname { __func__ }; // for lambda
-    mBackend.ReadFile(mFileID, pageStart, readSize, 
-        [&](const size_t roffset, const char* rbuf, const size_t rlength)->void
+    cancelled = !mBackend.ReadFile(mFileID, pageStart, readSize, 
+        [&](const size_t roffset, const char* rbuf, const size_t rlength)->bool
     {
         // this is basically the same as the File::WriteBytes() algorithm
         for (uint64_t rbyte { roffset }; rbyte < roffset+rlength; )
@@ -84,8 +198,9 @@ size_t PageBackend::FetchPages(const uint64_t index, const size_t count,
                     mDebug.Info([&](std::ostream& str){ str << fname 
                         << "... pageHandler(curIndex:" << curIndex << ")"; });
 
-                    pageHandler(curIndex, std::move(*curPage));
+                    const bool more { pageHandler(curIndex, std::move(*curPage)) };
                     curPage.reset(); ++curIndex;
+                    if (!more) return false; // abort the request
                 }
             }
             else mDebug.Info([&](std::ostream& str){ // can happen on retries
@@ -93,13 +208,82 @@ size_t PageBackend::FetchPages(const uint64_t index, const size_t count,
 
             rbuf += pwLength; rbyte += pwLength;
         }
+        return true;
     });
 
+    if (cancelled) return min64st(mBackendSize-pageStart, mPageSize*(curIndex-index)); // pages handled
+
     if (curPage != nullptr) { MDBG_ERROR("() ERROR unfinished read!"); assert(false); }
 
     return readSize;
 }
 
+/*****************************************************/
+PageBackend::ExtentList PageBackend::GetExtents(const uint64_t index, const PageBackend::PagePtrList& pages, const SharedLock& thisLock) const
+{
+    // runs of valid bytes [start,end) relative to the list start, and the dirty bytes within them
+    std::vector<std::pair<size_t, size_t>> spans;
+    RangeSet<size_t> dirty;
+
+    const auto addSpan { [&](const size_t start, const size_t end)
+    {
+        if (!spans.empty() && spans.back().second == start)
+            spans.back().second = end;
+        else spans.emplace_back(start, end);
+    }};
+
+    size_t listOffset { 0 };
+    for (const Page* pagePtr : pages)
+    {
+        const Page& page { *pagePtr };
+        const Page::ByteRanges& dirtyRanges { page.getDirtyRanges() };
+        const bool allDirty { page.isDirty() && dirtyRanges.empty() };
+
+        if (!page.isPartial())
+        {
+            addSpan(listOffset, listOffset+page.size());
+            if (allDirty) dirty.insert(listOffset, page.size());
+        }
+        else for (Page::ByteRanges::const_iterator it { page.getValidRanges().cbegin() }; 
+            it != page.getValidRanges().cend(); ++it)
+        {
+            addSpan(listOffset+it->first, listOffset+it->second.end);
+            if (allDirty) dirty.insert(listOffset+it->first, it->second.end-it->first);
+        }
+
+        for (Page::ByteRanges::const_iterator it { dirtyRanges.cbegin() }; it != dirtyRanges.cend(); ++it)
+            dirty.insert(listOffset+it->first, it->second.end-it->first);
+        listOffset += mPageSize;
+    }
+
+    const uint64_t listStart { index*mPageSize };
+    const size_t backendEnd { (mBackendSize > listStart) ? // relative to the list
+        min64st(mBackendSize-listStart, std::numeric_limits<size_t>::max()) : 0 };
+
+    ExtentList extents;
+    for (const std::pair<size_t, size_t>& span : spans)
+    {
+        size_t dirtyStart { span.second }; // none
+        size_t dirtyEnd { span.first };
+
+        const RangeSet<size_t>::const_iterator first { dirty.lower_bound(span.first) };
+        if (first != dirty.cend() && first->first < span.second)
+        {
+            // the first range exists, so there is one starting before the span end
+            const RangeSet<size_t>::const_iterator last { std::prev(dirty.upper_bound(span.second-1)) };
+            dirtyStart = std::max(span.first, first->first);
+            dirtyEnd = std::min(span.second, last->second.end);
+        }
+
+        // clean bytes only need writing if they are past the backend's end
+        const size_t start { std::max(span.first, std::min(dirtyStart, backendEnd)) };
+        const size_t end { (span.second > backendEnd) ? span.second : dirtyEnd };
+        if (end > start) extents.emplace_back(start, end-start);
+    }
+
+    return extents;
+}
+
 /*****************************************************/
 size_t PageBackend::FlushPageList(const uint64_t index, const PageBackend::PagePtrList& pages, const SharedLockW& thisLock)
 {
@@ -107,6 +291,17 @@ size_t PageBackend::FlushPageList(const uint64_t index, const PageBackend::PageP
 
     if (pages.empty()) { MDBG_ERROR("() ERROR empty list!"); assert(false); return 0; }
 
+    const FSConfig::WriteMode writeMode { mFile.GetWriteMode() };
+    if (mBackendExists && writeMode >= FSConfig::WriteMode::RANDOM)
+    {
+        const ExtentList extents { GetExtents(index, pages, thisLock) };
+        const size_t totalSize { WriteExtents(index, pages, extents, nullptr) };
+
+        if (!extents.empty()) mBackendSize = std::max(mBackendSize, 
+            index*mPageSize + extents.back().first + extents.back().second);
+        return totalSize;
+    }
+
     size_t totalSize { 0 };
     for (const Page* pagePtr : pages)
         totalSize += pagePtr->size();
@@ -114,7 +309,6 @@ size_t PageBackend::FlushPageList(const uint64_t index, const PageBackend::PageP
     const uint64_t writeStart { index*mPageSize };
     MDBG_INFO("... WRITING " << totalSize << " to " << writeStart);
 
-    const FSConfig::WriteMode writeMode { mFile.GetWriteMode() };
     if (writeMode == FSConfig::WriteMode::UPLOAD && mBackendExists)
         { MDBG_ERROR("... invalid write for UPLOAD!"); assert(false); }
     else if (writeMode == FSConfig::WriteMode::APPEND && mBackendExists && writeStart != mBackendSize)
@@ -129,19 +323,7 @@ size_t PageBackend::FlushPageList(const uint64_t index, const PageBackend::PageP
 
     const WriteFunc writeFunc { [&](const size_t offset, char* const buf, const size_t buflen, size_t& written)->bool
     {
-        written = 0; // in case of early return
-        const size_t pagesIdx { offset/mPageSize };
-        if (pagesIdx >= pages.size()) return false;
-
-        const Page& page { *pages[pagesIdx] };
-        const size_t pageOffset { offset - pagesIdx*mPageSize };
-        const size_t pageSize { page.size() };
-        if (pageOffset >= pageSize) return false;
-
-        const char* copyData { page.data()+pageOffset };
-        written = std::min(pageSize-pageOffset,buflen);
-        std::copy(copyData, copyData+written, buf); 
-        return true; // initial check will catch when we're done
+        return CopyPages(pages, offset, buf, buflen, written);
     }};
 
     if (!mBackendExists)
@@ -157,6 +339,61 @@ size_t PageBackend::FlushPageList(const uint64_t index, const PageBackend::PageP
     return totalSize;
 }
 
+/*****************************************************/
+size_t PageBackend::WritePages(const uint64_t index, const PageBackend::PagePtrList& pages, 
+    const PageBackend::ExtentList& extents, std::mutex& pagesMutex)
+{
+    MDBG_INFO("(index:" << index << " pages:" << pages.size() << " extents:" << extents.size() << ")");
+
+    if (pages.empty() || !mBackendExists) { MDBG_ERROR("() ERROR empty list or no file!"); assert(false); return 0; }
+
+    return WriteExtents(index, pages, extents, &pagesMutex);
+}
+
+/*****************************************************/
+size_t PageBackend::WriteExtents(const uint64_t index, const PageBackend::PagePtrList& pages, 
+    const PageBackend::ExtentList& extents, std::mutex* pagesMutex)
+{
+    size_t totalSize { 0 };
+    for (const Extent& extent : extents)
+    {
+        const uint64_t writeStart { index*mPageSize + extent.first };
+        MDBG_INFO("... WRITING " << extent.second << " to " << writeStart);
+
+        const WriteFunc writeFunc { [&](const size_t offset, char* const buf, const size_t buflen, size_t& written)->bool
+        {
+            written = 0; // in case of early return
+            if (offset >= extent.second) return false;
+
+            std::unique_lock<std::mutex> pagesLock;
+            if (pagesMutex != nullptr) pagesLock = std::unique_lock<std::mutex>(*pagesMutex);
+            return CopyPages(pages, extent.first+offset, buf, std::min(buflen, extent.second-offset), written);
+        }};
+
+        mBackend.WriteFile(mFileID, writeStart, writeFunc);
+        totalSize += extent.second;
+    }
+    return totalSize;
+}
+
+/*****************************************************/
+bool PageBackend::CopyPages(const PageBackend::PagePtrList& pages, const size_t offset, char* const buf, const size_t buflen, size_t& written) const
+{
+    written = 0; // in case of early return
+    const size_t pagesIdx { offset/mPageSize };
+    if (pagesIdx >= pages.size()) return false;
+
+    const Page& page { *pages[pagesIdx] };
+    const size_t pageOffset { offset - pagesIdx*mPageSize };
+    const size_t pageSize { page.size() };
+    if (pageOffset >= pageSize) return false;
+
+    const char* copyData { page.data()+pageOffset };
+    written = std::min(pageSize-pageOffset,buflen);
+    std::copy(copyData, copyData+written, buf); 
+    return true; // initial check will catch when we're done
+}
+
 /*****************************************************/
 void PageBackend::FlushCreate(const SharedLockW& thisLock)
 {
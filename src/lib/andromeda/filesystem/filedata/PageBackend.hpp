@@ -5,6 +5,9 @@
 #include <cstdint>
 #include <functional>
 #include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 #include "andromeda/common.hpp"
 #include "andromeda/Debug.hpp"
@@ -60,31 +63,55 @@ public:
     /** Returns true iff the file exists on the backend */
     [[nodiscard]] bool ExistsOnBackend(const SharedLock& thisLock) const { return mBackendExists; }
 
+    /** Returns the file's backend ID */
+    [[nodiscard]] const std::string& GetFileID() const { return mFileID; }
+
     /** Returns the file size on the backend (if it exists) */
     [[nodiscard]] uint64_t GetBackendSize(const SharedLock& thisLock) const { return mBackendSize; }
 
     /** Inform us that the size on the backend has changed */
     void SetBackendSize(uint64_t backendSize, const SharedLockW& thisLock) { mBackendSize = backendSize; }
 
-    /** Callback used to process fetched pages in FetchPages() */
-    using PageHandler = std::function<void (const uint64_t, Page&&)>;
+    /** Callback used to process fetched pages in FetchPages() - returns false to cancel the rest of the fetch */
+    using PageHandler = std::function<bool (const uint64_t, Page&&)>;
 
     /** 
      * Reads pages from the backend (must mBackendExists!)
+     * If streams > 1, splits the range into that many sub-ranges that are requested concurrently,
+     * the first on this thread and the rest on the backend's thread pool (each uses its own runner)
+     * Pages are always given to pageHandler in order and on this thread, later sub-ranges are
+     * buffered until reached (delivered while the ones after them are still downloading)
+     * If pageHandler returns false, all requests are aborted and no more pages are given to it
      * @param index the page index to start from
      * @param count the number of pages to read
      * @param pageHandler callback for handling constructed pages
-     * @return the total number of bytes read from the backend
+     * @param streams the maximum number of concurrent requests to use
+     * @return the total number of bytes read from the backend (less than the range if cancelled)
      * @throws BackendException for backend issues
      */
-    size_t FetchPages(uint64_t index, size_t count, const PageHandler& pageHandler, const SharedLock& thisLock);
+    size_t FetchPages(uint64_t index, size_t count, const PageHandler& pageHandler, const SharedLock& thisLock, size_t streams = 1);
 
     /** Vector of **consecutive** non-null page pointers */
     using PagePtrList = std::vector<Page*>;
 
+    /** A byte range to write (offset, length) relative to the start of a page list */
+    using Extent = std::pair<size_t, size_t>;
+    /** Ordered list of non-overlapping extents */
+    using ExtentList = std::vector<Extent>;
+
+    /** 
+     * Returns the byte ranges of a page list that need writing to the existing backend file
+     * These are the runs of valid bytes (see Page::isPartial()), trimmed to their dirty bytes 
+     * where the clean bytes around them are already on the backend (not past mBackendSize)
+     * @param index the starting index of the page list
+     * @param pages list of pages to check
+     */
+    [[nodiscard]] ExtentList GetExtents(uint64_t index, const PagePtrList& pages, const SharedLock& thisLock) const;
+
     /** 
      * Writes a series of **consecutive** pages (total < size_t)
      * Also creates the file on the backend if necessary (see mBackendExists)
+     * If the file exists and can be random-written, only writes GetExtents()
      * @param index the starting index of the page list
      * @param pages list of pages to flush - must NOT be empty
      * @return the total number of bytes written to the backend
@@ -92,6 +119,19 @@ public:
      */
     size_t FlushPageList(uint64_t index, const PagePtrList& pages, const SharedLockW& thisLock);
 
+    /** 
+     * Writes extents of a series of **consecutive** pages (total < size_t) to the existing backend file
+     * Used for background write-back without the file lock - does NOT update mBackendSize (see SetBackendSize)
+     * THREAD SAFE (the list is only accessed with pagesMutex, so the caller can swap pages between copies)
+     * @param index the starting index of the page list
+     * @param pages list of pages to write - must NOT be empty
+     * @param extents the byte ranges to write, from GetExtents() when the pages were flushed
+     * @param pagesMutex mutex protecting the page list
+     * @return the total number of bytes written to the backend
+     * @throws BackendException for backend issues
+     */
+    size_t WritePages(uint64_t index, const PagePtrList& pages, const ExtentList& extents, std::mutex& pagesMutex);
+
     /** 
      * Creates the file on the backend if not mBackendExists and feeds to file.Refresh()
      * @throws BackendException for backend issues
@@ -106,6 +146,27 @@ public:
 
 private:
 
+    /** 
+     * Reads pages from the backend with a single request, see FetchPages()
+     * THREAD SAFE (may be run concurrently by FetchPages() under its thisLock)
+     * @param[out] cancelled set to true if pageHandler cancelled the request
+     */
+    size_t FetchRange(uint64_t index, size_t count, const PageHandler& pageHandler, bool& cancelled);
+
+    /** 
+     * Writes the given extents of a page list to the existing backend file, one request each
+     * @param pagesMutex if not null, held while accessing the page list
+     * @return the total number of bytes written to the backend
+     * @throws BackendException for backend issues
+     */
+    size_t WriteExtents(uint64_t index, const PagePtrList& pages, const ExtentList& extents, std::mutex* pagesMutex);
+
+    /** 
+     * Copies data from a page list at the given offset (a backend WriteFunc)
+     * @return false if the offset is past the end of the pages
+     */
+    bool CopyPages(const PagePtrList& pages, size_t offset, char* buf, size_t buflen, size_t& written) const;
+
     /** The size of each page - see description in ConfigOptions */
     const size_t mPageSize;
     /** The file size as far as the backend knows (0 if it doesn't exist) */
@@ -4,15 +4,20 @@
 #include <cstring>
 #include <limits>
 #include <utility>
+#include <vector>
 
+#include "BandwidthEstimator.hpp"
 #include "CacheManager.hpp"
 #include "Page.hpp"
 #include "PageManager.hpp"
 #include "andromeda/BaseException.hpp"
+#include "andromeda/ConfigOptions.hpp"
 #include "andromeda/StringUtil.hpp"
 #include "andromeda/backend/BackendException.hpp"
 using Andromeda::Backend::BackendException;
 #include "andromeda/backend/BackendImpl.hpp"
+#include "andromeda/backend/RunnerPool.hpp"
+using Andromeda::Backend::RunnerPool;
 #include "andromeda/filesystem/File.hpp"
 #include "andromeda/filesystem/Folder.hpp"
 #include "andromeda/filesystem/Item.hpp"
@@ -29,10 +34,18 @@ PageManager::PageManager(File& file, const uint64_t fileSize, const size_t pageS
     mCacheMgr(mBackend.GetCacheManager()),
     mPageSize(pageSize), 
     mFileSize(fileSize), 
-    mBandwidth(__func__, mBackend.GetOptions().readAheadTime),
+    mPages((mCacheMgr != nullptr) ? &mCacheMgr->GetTableMemory() : nullptr),
     mPageBackend(pageBackend)
 { 
     MDBG_INFO("(file:" << &file << ", size:" << fileSize << ", pageSize:" << pageSize << ")");
+
+    if (mCacheMgr != nullptr && mBackend.GetOptions().cacheType == ConfigOptions::CacheType::DISK)
+        mDiskCache = mCacheMgr->GetDiskCache();
+
+    for (std::atomic<uint64_t>& deferred : mDeferredHits)
+        deferred.store(PageMap::NONE, std::memory_order_relaxed);
+
+    UpdateFetchSize(); // start from what other files have measured
 }
 
 /*****************************************************/
@@ -42,15 +55,41 @@ PageManager::~PageManager()
 
     const Item::DeleteLock deleteLock(mScopeMutex); // exclusive
 
-    // once we have the deleteLock, no NEW fetch threads can start, wait for existing
-    const std::unique_lock<std::shared_mutex> fetchLock(mFetchMutex);
+    // once we have the deleteLock, no NEW fetches can start, stop and wait for existing
+    decltype(mFetchTasks) fetchTasks; { // lock scope
+        const UniqueLock pagesLock(mPagesMutex);
+        CancelFetches(0, PageMap::NONE, pagesLock);
+        fetchTasks.swap(mFetchTasks);
+    }
+
+    // don't hold pagesLock as fetches need it - no point in starting any that are still queued
+    for (const FetchTask& fetchTask : fetchTasks)
+        if (!fetchTask.mTask->Cancel()) fetchTask.mTask->Wait();
+
+    // let queued disk stores finish - they don't use this, but keep the disk cache warm
+    for (const decltype(mDiskStores)::value_type& diskStore : mDiskStores)
+        diskStore.second->Wait();
+
+    // background flushes must finish as they use our pages
+    ThreadPool::TaskPtr flushTask; { // lock scope
+        UniqueLock flushLock(mFlushMutex);
+        WaitFlushJobs(flushLock);
+        flushTask = mFlushTask;
+    }
+    if (flushTask != nullptr) flushTask->Wait(); // let it return
+    RetryFailedFlushes(); // no FinishFlushes() to make them dirty again
 
     if (mCacheMgr != nullptr)
     {
-        for (const PageMap::value_type& it : mPages)
-            mCacheMgr->RemovePage(it.second);
+        mPages.forEach([&](const uint64_t index, const Page& page){ 
+            mCacheMgr->RemovePage(page); });
     }
 
+    const AccessPattern::Stats stats { mAccessPattern.GetStats() };
+    MDBG_INFO("... accesses:" << stats.accesses << " streamAccesses:" << stats.streamAccesses
+        << " readAheadPages:" << stats.readAheadPages << " readAheadHits:" << stats.readAheadHits 
+        << " readAheadWasted:" << stats.readAheadWasted << " cancelledBytes:" << mCancelledBytes);
+
     MDBG_INFO("... returning!");
 }
 
@@ -62,8 +101,13 @@ void PageManager::ReadPage(char* buffer, const uint64_t index, const size_t offs
     if (index*mPageSize + offset+length > mFileSize) { MDBG_ERROR("... invalid read!"); assert(false); }
 
     const Page& page { GetPageRead(index, thisLock) };
+    if (!page.isValid(offset, length))
+        ResolvePartial(index, thisLock);
 
     std::memcpy(buffer, page.data()+offset, length);
+
+    if (mNoCache.load(std::memory_order_relaxed) && mCacheMgr && !mBackend.isMemory())
+        mCacheMgr->DemotePage(page);
 }
 
 /*****************************************************/
@@ -82,7 +126,7 @@ void PageManager::WritePage(const char* buffer, const uint64_t index, const size
     // mDirty is set LAST since GetPageWrite() may cause a synchronous flush
     Page& page { GetPageWrite(index, pageSize, partial, thisLock) };
     mFileSize = newFileSize; // extend file
-    page.setDirty();
+    page.addDirty(offset, length); mPages.setDirty(index);
 
     std::memcpy(page.data()+offset, buffer, length);
 }
@@ -94,15 +138,33 @@ const Page& PageManager::GetPageRead(const uint64_t index, const SharedLock& thi
 
     if (index*mPageSize >= mFileSize) { MDBG_ERROR("... invalid read!"); assert(false); }
 
+    // fast path for hits without mPagesMutex - published pages are only removed with
+    // an exclusive thisLock, so the page stays valid while our shared thisLock is held
+    { const Page* const pagePtr { mPages.findShared(index) };
+    if (pagePtr != nullptr)
+    {
+        RecordHit(index, thisLock);
+
+        MDBG_INFO("... return existing page (shared)");
+        const Page& page { *pagePtr };
+
+        if (mCacheMgr && !mBackend.isMemory()) 
+            mCacheMgr->InformPage(*this, index, page, page.isDirty());
+        return page;
+    } }
+
     UniqueLock pagesLock(mPagesMutex);
+    ReplayDeferredHits(thisLock, pagesLock);
+    const AccessPattern::Access access { mAccessPattern.RecordAccess(index) };
+    CancelStaleFetches(pagesLock);
 
-    { const PageMap::const_iterator it { mPages.find(index) };
-    if (it != mPages.end()) 
+    { const Page* const pagePtr { mPages.find(index) };
+    if (pagePtr != nullptr) 
     {
-        DoAdvanceRead(index, thisLock, pagesLock);
+        DoAdvanceRead(index, access, thisLock, pagesLock);
 
         MDBG_INFO("... return existing page");
-        const Page& page { it->second };
+        const Page& page { *pagePtr };
         
         if (mCacheMgr && !mBackend.isMemory()) 
             mCacheMgr->InformPage(*this, index, page, page.isDirty());
@@ -111,11 +173,19 @@ const Page& PageManager::GetPageRead(const uint64_t index, const SharedLock& thi
 
     if (!isFetchPending(index, pagesLock))
     {
-        const size_t fetchSize { GetFetchSize(index, thisLock, pagesLock) };
+        // reverse/strided streams get the page alone, then read ahead separately
+        const bool forward { access.pattern != AccessPattern::Pattern::REVERSE && 
+                             access.pattern != AccessPattern::Pattern::STRIDED };
+        // no read-ahead for the first page as file managers often read just metadata
+        // unless the whole file takes about as long to fetch as one page (see GetSmallFileSize)
+        const bool firstPage { !index && access.pattern == AccessPattern::Pattern::UNKNOWN };
+
+        const size_t fetchSize { GetFetchSize(index, firstPage ? GetSmallFileSize(thisLock) :
+            (forward ? GetReadAheadSize(access) : 1), thisLock, pagesLock) };
         if (!fetchSize) // must be between backend end and dirty write, create empty
         {
             MDBG_INFO("... create empty page");
-            Page& newPage { mPages.try_emplace(index, 0, mBackend.GetPageAllocator()).first->second };
+            Page& newPage { *mPages.emplaceHidden(index, 0, mBackend.GetPageAllocator()).first };
             
             ResizePage(newPage, mPageSize, false); // zeroize
             // hold pagesLock because if inform fails, we will remove this page
@@ -123,15 +193,27 @@ const Page& PageManager::GetPageRead(const uint64_t index, const SharedLock& thi
             InformNewPageRead(index, newPage, false, true, pagesLock);
             return newPage;
         }
-        else StartFetch(index, fetchSize, pagesLock);
+
+        StartFetch(index, fetchSize, pagesLock, RunnerPool::Priority::FOREGROUND);
+        mAccessPattern.AddReadAhead(index+1, fetchSize-1);
+        if (!forward) DoAdvanceRead(index, access, thisLock, pagesLock);
     }
 
-    PageMap::const_iterator it;
+    const Page* pagePtr { nullptr };
     std::exception_ptr fail;
 
-    while ((it = mPages.find(index)) == mPages.end() &&
+    while ((pagePtr = mPages.find(index)) == nullptr &&
             !(fail = isFetchFailed(index, pagesLock)))
     {
+        if (!isFetchPending(index, pagesLock)) // its fetch was cancelled
+        {
+            MDBG_INFO("... fetch of " << index << " was cancelled, restarting");
+            StartFetch(index, 1, pagesLock, RunnerPool::Priority::FOREGROUND);
+        }
+        else TryFetchOutOfOrder(index, pagesLock);
+
+        if (TryRunFetch(index, pagesLock)) continue; // re-check
+
         MDBG_INFO("... waiting for pending " << index);
         mPagesCV.wait(pagesLock);
     }
@@ -143,7 +225,7 @@ const Page& PageManager::GetPageRead(const uint64_t index, const SharedLock& thi
     }
 
     MDBG_INFO("... returning pended page " << index);
-    const Page& page { it->second };
+    const Page& page { *pagePtr };
 
     if (mCacheMgr && !mBackend.isMemory()) 
         mCacheMgr->InformPage(*this, index, page, page.isDirty());
@@ -155,12 +237,20 @@ Page& PageManager::GetPageWrite(const uint64_t index, const size_t pageSize, con
 {
     MDBG_INFO("(" << mFile.GetName(thisLock) << ")" << " (index:" << index << " pageSize:" << pageSize << " partial:" << partial << ")");
 
-    { const PageMap::iterator it { mPages.find(index) };
-    if (it != mPages.end())
+    // the disk copy will no longer match once written
+    if (mDiskCache != nullptr)
+    {
+        WaitDiskStore(index, thisLock);
+        mDiskCache->RemovePages(mPageBackend.GetFileID(), index, 1);
+    }
+
+    { Page* const pagePtr { mPages.find(index) };
+    if (pagePtr != nullptr)
     {
         MDBG_INFO("... returning existing page");
-        InformResizePage(index, it->second, true, pageSize, thisLock);
-        return it->second;
+        ShadowFlushPage(index, *pagePtr, thisLock);
+        InformResizePage(index, *pagePtr, true, pageSize, thisLock);
+        return *pagePtr;
     } }
 
     // as we have an exclusive thisLock, we know there are no background reads,
@@ -172,22 +262,39 @@ Page& PageManager::GetPageWrite(const uint64_t index, const size_t pageSize, con
         if (pageStart > mFileSize && mFileSize > 0)
         {
             // extend the old last page if necessary
-            const PageMap::iterator it { mPages.find((mFileSize-1)/mPageSize) };
-            if (it != mPages.end()) ResizePage(it->second, mPageSize, true, &thisLock);
+            const uint64_t lastIndex { (mFileSize-1)/mPageSize };
+            Page* const lastPage { mPages.find(lastIndex) };
+            if (lastPage != nullptr)
+            {
+                ShadowFlushPage(lastIndex, *lastPage, thisLock);
+                ResizePage(*lastPage, mPageSize, true, &thisLock);
+            }
         }
 
         MDBG_INFO("... create empty page");
-        Page& newPage { mPages.try_emplace(index, 0, mBackend.GetPageAllocator()).first->second };
+        Page& newPage { *mPages.try_emplace(index, 0, mBackend.GetPageAllocator()).first };
+        ResizePage(newPage, pageSize, false); // zeroize
+        InformNewPageWrite(index, newPage, true, thisLock);
+        return newPage;
+    }
+
+    if (CanWritePartial(thisLock))
+    {
+        // the page is flushed by its written bytes, only read the rest if it's read
+        MDBG_INFO("... partial write, create partial page");
+        Page& newPage { *mPages.try_emplace(index, 0, mBackend.GetPageAllocator()).first };
         ResizePage(newPage, pageSize, false); // zeroize
+        newPage.setPartial(min64st(mPageBackend.GetBackendSize(thisLock)-pageStart, pageSize));
         InformNewPageWrite(index, newPage, true, thisLock);
         return newPage;
     }
 
     MDBG_INFO("... partial write, reading single");
     Page* newPage = nullptr; mPageBackend.FetchPages(index, 1, // read a single page
-        [&](const uint64_t pageIndex, Page&& page)
+        [&](const uint64_t pageIndex, Page&& page)->bool
     {
-        newPage = &(mPages.emplace(pageIndex, std::move(page)).first->second);
+        newPage = mPages.try_emplace(pageIndex, std::move(page)).first;
+        return true;
     }, thisLock);
 
     ResizePage(*newPage, pageSize, false);
@@ -204,9 +311,78 @@ void PageManager::InformNewPageRead(const uint64_t index, const Page& page, bool
     catch (const CacheManager::MemoryException& ex)
     {
         mCacheMgr->RemovePage(page);
-        mPages.erase(index); // undo memory usage
+        mPages.erase(index); // undo memory usage (still hidden)
+        mAccessPattern.CancelReadAhead(index, 1);
         throw; // rethrow
     }
+
+    mPages.publish(index); // now visible to lock-free hits
+}
+
+/*****************************************************/
+bool PageManager::CanWritePartial(const SharedLockW& thisLock) const
+{
+    return mPageBackend.ExistsOnBackend(thisLock) && 
+        mFile.GetWriteMode() >= FSConfig::WriteMode::RANDOM;
+}
+
+/*****************************************************/
+void PageManager::ResolvePartial(const uint64_t index, const SharedLock& thisLock)
+{
+    MDBG_INFO("(index:" << index << ")");
+
+    const UniqueLock resolveLock(mResolveMutex);
+    Page* pagePtr { nullptr }; { // lock scope
+        const UniqueLock pagesLock(mPagesMutex);
+        pagePtr = mPages.find(index); // not removed while we hold thisLock
+    }
+    if (pagePtr == nullptr || !pagePtr->isPartial()) return; // resolved already
+
+    const uint64_t pageStart { index*mPageSize };
+    if (pageStart >= mPageBackend.GetBackendSize(thisLock))
+    {
+        // the backend was truncated, the rest is zeroes
+        pagePtr->resolve(Page(0, mBackend.GetPageAllocator()));
+        return;
+    }
+
+    MDBG_INFO("... reading single");
+    mPageBackend.FetchPages(index, 1, [&](const uint64_t, Page&& page)->bool
+    {
+        pagePtr->resolve(page); return true;
+    }, thisLock);
+}
+
+/*****************************************************/
+void PageManager::RecordHit(const uint64_t index, const SharedLock& thisLock)
+{
+    const UniqueLock pagesLock(mPagesMutex, std::try_to_lock);
+    if (!pagesLock.owns_lock())
+    {
+        // don't wait - another reader or fetch will record it for us
+        const size_t slot { mDeferredNext.fetch_add(1, std::memory_order_relaxed) % mDeferredHits.size() };
+        mDeferredHits[slot].store(index, std::memory_order_relaxed);
+        mHasDeferredHits.store(true, std::memory_order_release);
+        return;
+    }
+
+    ReplayDeferredHits(thisLock, pagesLock);
+    DoAdvanceRead(index, mAccessPattern.RecordAccess(index), thisLock, pagesLock);
+}
+
+/*****************************************************/
+void PageManager::ReplayDeferredHits(const SharedLock& thisLock, const UniqueLock& pagesLock)
+{
+    if (!mHasDeferredHits.exchange(false, std::memory_order_acquire)) return;
+
+    for (std::atomic<uint64_t>& deferred : mDeferredHits)
+    {
+        const uint64_t index { deferred.exchange(PageMap::NONE, std::memory_order_relaxed) };
+        if (index == PageMap::NONE) continue;
+
+        MDBG_INFO("... deferred hit " << index);
+        DoAdvanceRead(index, mAccessPattern.RecordAccess(index), thisLock, pagesLock);
+    }
 }
 
 /*****************************************************/
@@ -246,9 +422,7 @@ void PageManager::ResizePage(Page& page, const size_t pageSize, bool cacheMgr, c
 
     MDBG_INFO("(pageSize:" << pageSize << ") oldSize:" << oldSize);
 
-    page.resize(pageSize);
-    if (pageSize > oldSize) std::memset(
-        page.data()+oldSize, 0, pageSize-oldSize);
+    page.resize(pageSize); // zeroes new bytes
 
     if (cacheMgr && mCacheMgr) 
         try { mCacheMgr->ResizePage(*this, page, thisLock); }
@@ -263,44 +437,133 @@ void PageManager::ResizePage(Page& page, const size_t pageSize, bool cacheMgr, c
 /*****************************************************/
 bool PageManager::isFetchPending(const uint64_t index, const UniqueLock& pagesLock)
 {
-    return std::any_of(mPendingPages.cbegin(), mPendingPages.cend(), 
-        [&](const decltype(mPendingPages)::value_type& pend){
-            return index >= pend.first && index < pend.first + pend.second;
-        });
+    return mPendingPages.contains(index);
 }
 
 /*****************************************************/
 std::exception_ptr PageManager::isFetchFailed(const uint64_t index, const UniqueLock& pagesLock)
 {
-    const FailureMap::iterator it { mFailedPages.find(index) };
-    return (it != mFailedPages.end()) ? it->second : nullptr;
+    const FailureMap::const_iterator it { mFailedPages.find(index) };
+    return (it != mFailedPages.cend()) ? it->second.value : nullptr;
 }
 
 /*****************************************************/
-void PageManager::RemovePendingFetch(const uint64_t index, bool idxOnly, const UniqueLock& pagesLock)
+void PageManager::RemovePendingFetch(const uint64_t index, const size_t count, const UniqueLock& pagesLock)
 {
-    MDBG_INFO("(index:" << index << " idxOnly:" << BOOLSTR(idxOnly) << ")");
+    MDBG_INFO("(index:" << index << " count:" << count << ")");
+
+    // pages fetched out of order are removed by whichever fetch got them first
+    const uint64_t removed { mPendingPages.erase(index, count) };
+    if (removed != count) { MDBG_INFO("... " << count-removed << " already fetched out of order"); }
+
+    mPagesCV.notify_all();
+}
 
-    for (PendingMap::iterator pend { mPendingPages.begin() }; 
-        pend != mPendingPages.end(); ++pend)
+/*****************************************************/
+void PageManager::CancelFetches(const uint64_t index, const uint64_t count, const UniqueLock& pagesLock)
+{
+    // only pending pages are marked so nothing is left behind for later fetches
+    for (PendingMap::const_iterator it { mPendingPages.lower_bound(index) }; 
+        it != mPendingPages.cend() && std::max(it->first, index)-index < count; ++it)
     {
-        if (index == pend->first)
-        {
-            ++pend->first; // index
-            --pend->second; // count
+        const uint64_t start { std::max(it->first, index) };
+        const uint64_t end { (it->second.end-index > count) ? index+count : it->second.end };
+
+        MDBG_INFO("(start:" << start << " end:" << end << ")");
+        mCancelledPages.insert(start, end-start);
+    }
+}
 
-            if (!idxOnly || !pend->second)
-                mPendingPages.erase(pend);
+/*****************************************************/
+void PageManager::CancelFetches(const uint64_t index)
+{
+    const UniqueLock pagesLock(mPagesMutex);
+    CancelFetches(index, PageMap::NONE-index, pagesLock);
+}
+
+/*****************************************************/
+void PageManager::CancelStaleFetches(const UniqueLock& pagesLock)
+{
+    if (mPendingPages.empty()) return;
 
-            mPagesCV.notify_all(); return;
+    // a stream can start a read-ahead up to readAheadBuffer pages ahead of itself
+    const size_t gap { mBackend.GetOptions().readAheadBuffer };
+    for (const FetchTask& fetchTask : mFetchTasks)
+    {
+        if (!fetchTask.mReadAhead || fetchTask.mTask->isDone()) continue;
+
+        const uint64_t end { fetchTask.mIndex + fetchTask.mCount };
+        const PendingMap::const_iterator it { mPendingPages.lower_bound(fetchTask.mIndex) };
+        if (it == mPendingPages.cend() || it->first >= end) continue; // all arrived
+
+        const uint64_t start { std::max(it->first, fetchTask.mIndex) };
+        if (mCancelledPages.contains(start)) continue; // already cancelled
+
+        // check the whole range, the reader may be well behind the download
+        if (!mAccessPattern.HasRecentStream(fetchTask.mIndex, fetchTask.mCount, gap))
+        {
+            MDBG_INFO("... stale fetch index:" << fetchTask.mIndex << " count:" << fetchTask.mCount);
+            CancelFetches(start, end-start, pagesLock);
         }
     }
+}
+
+/*****************************************************/
+void PageManager::InformEvicting(const uint64_t index)
+{
+    const UniqueLock pagesLock(mPagesMutex);
+    if (!mAccessPattern.isReadAhead(index)) return; // was used, or not read ahead
+
+    for (const FetchTask& fetchTask : mFetchTasks)
+    {
+        const uint64_t end { fetchTask.mIndex + fetchTask.mCount };
+        if (index < fetchTask.mIndex || index >= end || fetchTask.mTask->isDone()) continue;
+
+        MDBG_INFO("(index:" << index << ") evicted before use, cancelling to " << end);
+        CancelFetches(index+1, end-index-1, pagesLock);
+        break; // pending pages have only one fetch
+    }
+}
+
+/*****************************************************/
+uint64_t PageManager::GetCancelledBytes(const SharedLock& thisLock)
+{
+    const UniqueLock pagesLock(mPagesMutex);
+    return mCancelledBytes;
+}
+
+/*****************************************************/
+size_t PageManager::GetReadAheadSize(const AccessPattern::Access& access)
+{
+    const UniqueLock llock(mFetchSizeMutex);
+    // mFetchSize is per-stream, a window can be split across streams
+    size_t readAhead { AccessPattern::GetWindow(access, mFetchSize*GetMaxStreams()) };
+
+    if (readAhead > mFetchSize && mCacheMgr) // scaled up, re-apply the cache limit
+    {
+        const size_t cacheMax { mCacheMgr->GetMemoryLimit()/mBackend.GetOptions().readMaxCacheFrac/mPageSize };
+        readAhead = std::max(mFetchSize, std::min(readAhead, cacheMax));
+    }
+
+    MDBG_INFO("(pattern:" << AccessPattern::PatternToString(access.pattern) << ") readAhead:" << readAhead);
+    return readAhead;
+}
+
+/*****************************************************/
+size_t PageManager::GetSmallFileSize(const SharedLock& thisLock)
+{
+    const uint64_t backendPages { (mPageBackend.GetBackendSize(thisLock)+mPageSize-1)/mPageSize };
+
+    const UniqueLock llock(mFetchSizeMutex);
+    // mFetchSize is a multiple of the bandwidth-delay product, so latency dominates a fetch that size
+    if (backendPages <= 1 || backendPages > mFetchSize) return 1;
 
-    MDBG_ERROR("... page:" << index << " was not pending!");
+    MDBG_INFO("() fetching whole file pages:" << backendPages);
+    return static_cast<size_t>(backendPages);
 }
 
 /*****************************************************/
-size_t PageManager::GetFetchSize(const uint64_t index, const SharedLock& thisLock, const UniqueLock& pagesLock)
+size_t PageManager::GetFetchSize(const uint64_t index, const size_t maxCount, const SharedLock& thisLock, const UniqueLock& pagesLock)
 {
     if (index*mPageSize >= mFileSize)
         { MDBG_ERROR("() ERROR index:" << index << " mFileSize:" << mFileSize 
@@ -312,72 +575,195 @@ size_t PageManager::GetFetchSize(const uint64_t index, const SharedLock& thisLoc
     const uint64_t lastPage { (backendSize-1)/mPageSize }; // last valid page index
     if (index > lastPage) { MDBG_INFO("... return 0(b)"); return 0; } // can't read beyond the backend
 
-    const UniqueLock llock(mFetchSizeMutex);
-    const size_t maxReadCount { min64st(lastPage-index+1, mFetchSize) };
-
-    if (mPages.find(index) != mPages.end()) return 0; // page exists
+    if (mPages.contains(index)) return 0; // page exists
 
-    // no read-ahead for the first page as file managers often read just metadata
-    size_t readCount { (index > 0) ? maxReadCount : 1 };
+    size_t readCount { min64st(lastPage-index+1, maxCount) };
 
     // stop before the next existing (pages are in order)
-    { PageMap::const_iterator nextIt { mPages.upper_bound(index) };
-    if (nextIt != mPages.end())
+    { const uint64_t nextIndex { mPages.next(index+1) };
+    if (nextIndex != PageMap::NONE)
     {
-        MDBG_INFO("... first page at:" << nextIt->first);
-        readCount = min64st(nextIt->first-index, readCount);
+        MDBG_INFO("... first page at:" << nextIndex);
+        readCount = min64st(nextIndex-index, readCount);
     } }
 
     // stop before the next pending
-    for (size_t curCount { 0 }; curCount < readCount; ++curCount)
+    { const PendingMap::const_iterator pendIt { mPendingPages.lower_bound(index) };
+    if (pendIt != mPendingPages.cend())
     {
-        if (isFetchPending(curCount+index, pagesLock))
-        {
-            MDBG_INFO("... pending page at:" << curCount+index);
-            readCount = curCount;
-            break; // pages are in order
-        }
-    }
+        MDBG_INFO("... pending page at:" << pendIt->first);
+        readCount = (pendIt->first > index) ? min64st(pendIt->first-index, readCount) : 0;
+    } }
+
+    return readCount;
+}
+
+size_t PageManager::GetFetchSizeReverse(const uint64_t index, const size_t maxCount, const SharedLock& thisLock, const UniqueLock& pagesLock)
+{
+    const uint64_t backendSize { mPageBackend.GetBackendSize(thisLock) };
+
+    if (!backendSize) { MDBG_INFO("... return 0(a)"); return 0; } // nothing to read
+    const uint64_t lastPage { (backendSize-1)/mPageSize }; // last valid page index
+    if (index > lastPage) { MDBG_INFO("... return 0(b)"); return 0; } // can't read beyond the backend
+
+    if (mPages.contains(index)) return 0; // page exists
+    if (isFetchPending(index, pagesLock)) return 0; // page pending
+
+    size_t readCount { min64st(index+1, maxCount) };
+
+    // stop after the previous existing (pages are in order)
+    { const uint64_t prevIndex { mPages.prev(index) };
+    if (prevIndex != PageMap::NONE)
+    {
+        MDBG_INFO("... previous page at:" << prevIndex);
+        readCount = min64st(index-prevIndex, readCount);
+    } }
+
+    // stop after the previous pending (which ends at or before index)
+    { PendingMap::const_iterator pendIt { mPendingPages.upper_bound(index) };
+    if (pendIt != mPendingPages.cbegin())
+    {
+        --pendIt; MDBG_INFO("... previous pending end at:" << pendIt->second.end);
+        readCount = min64st(index+1-pendIt->second.end, readCount);
+    } }
 
     return readCount;
 }
 
 /*****************************************************/
-void PageManager::DoAdvanceRead(const uint64_t index, const SharedLock& thisLock, const UniqueLock& pagesLock)
+void PageManager::DoAdvanceRead(const uint64_t index, const AccessPattern::Access& access, const SharedLock& thisLock, const UniqueLock& pagesLock)
 {
+    if (access.pattern == AccessPattern::Pattern::RANDOM) return; // no read-ahead
+
     // TODO this probably doesn't play well with really small cache sizes
-    // always pre-populate mReadAheadPages ahead (except index 0)
-    if (!index) return;
-    for (uint64_t nextIdx { index+1 }; 
-        nextIdx <= index + mBackend.GetOptions().readAheadBuffer; ++nextIdx)
-    {
-        if (nextIdx*mPageSize >= mFileSize) break; // exit loop
-        const size_t fetchSize { GetFetchSize(nextIdx, thisLock, pagesLock) };
-        if (fetchSize)
+    const size_t readAheadBuffer { mBackend.GetOptions().readAheadBuffer };
+    const size_t readAhead { GetReadAheadSize(access) };
+    if (access.pattern == AccessPattern::Pattern::REVERSE)
+    {
+        // same as forward but backwards - the fetch still delivers pages in increasing 
+        // order so the reader waits on the whole window if it catches up to it
+        for (uint64_t prevIdx { index }; prevIdx > 0 && index-prevIdx < readAheadBuffer; )
         {
-            MDBG_INFO("... advance read nextIdx:" << nextIdx << " fetchSize:" << fetchSize);
-            StartFetch(nextIdx, fetchSize, pagesLock);
-            break; // exit loop
+            --prevIdx; // next page backwards
+            const size_t fetchSize { GetFetchSizeReverse(prevIdx, readAhead, thisLock, pagesLock) };
+            if (fetchSize)
+            {
+                const uint64_t startIdx { prevIdx+1-fetchSize };
+                MDBG_INFO("... reverse advance read startIdx:" << startIdx << " fetchSize:" << fetchSize);
+                StartFetch(startIdx, fetchSize, pagesLock);
+                mAccessPattern.AddReadAhead(startIdx, fetchSize);
+                break; // exit loop
+            }
+        }
+    }
+    else if (access.pattern == AccessPattern::Pattern::STRIDED)
+    {
+        // fetch the next few pages in the stride individually
+        for (size_t step { 1 }; step <= readAhead; ++step)
+        {
+            const int64_t nextIdx { static_cast<int64_t>(index) + static_cast<int64_t>(step)*access.stride };
+            if (nextIdx < 0 || static_cast<uint64_t>(nextIdx)*mPageSize >= mFileSize) break; // exit loop
+
+            const uint64_t fetchIdx { static_cast<uint64_t>(nextIdx) };
+            if (!isFetchPending(fetchIdx, pagesLock) && GetFetchSize(fetchIdx, 1, thisLock, pagesLock))
+            {
+                MDBG_INFO("... strided advance read fetchIdx:" << fetchIdx);
+                StartFetch(fetchIdx, 1, pagesLock);
+                mAccessPattern.AddReadAhead(fetchIdx, 1);
+            }
+        }
+    }
+    else
+    {
+        // always pre-populate readAheadBuffer pages ahead (except index 0)
+        if (!index) return;
+        for (uint64_t nextIdx { index+1 }; nextIdx <= index + readAheadBuffer; ++nextIdx)
+        {
+            if (nextIdx*mPageSize >= mFileSize) break; // exit loop
+            const size_t fetchSize { GetFetchSize(nextIdx, readAhead, thisLock, pagesLock) };
+            if (fetchSize)
+            {
+                MDBG_INFO("... advance read nextIdx:" << nextIdx << " fetchSize:" << fetchSize);
+                StartFetch(nextIdx, fetchSize, pagesLock);
+                mAccessPattern.AddReadAhead(nextIdx, fetchSize);
+                break; // exit loop
+            }
         }
     }
 }
 
 /*****************************************************/
-void PageManager::StartFetch(const uint64_t index, const size_t readCount, const UniqueLock& pagesLock)
+void PageManager::StartFetch(const uint64_t index, const size_t readCount, const UniqueLock& pagesLock, 
+    const RunnerPool::Priority priority, const bool readAhead)
 {
-    MDBG_INFO("(index:" << index << ", readCount:" << readCount << ")");
+    MDBG_INFO("(index:" << index << ", readCount:" << readCount << ", priority:" << static_cast<int>(priority) 
+        << ", readAhead:" << BOOLSTR(readAhead) << ")");
 
-    mPendingPages.emplace_back(index, readCount);
+    mPendingPages.insert(index, readCount);
 
     if (!mFailedPages.empty())
     {
-        size_t erased { 0 };
-        for (uint64_t idx { index }; idx < index+readCount; ++idx)
-            erased += mFailedPages.erase(idx);
+        const uint64_t erased { mFailedPages.erase(index, readCount) };
         if (erased) MDBG_INFO("... reset " << erased << " failures");
     }
 
-    std::thread(&PageManager::FetchPages, this, index, readCount).detach();
+    // clean up finished jobs so the list doesn't grow forever
+    mFetchTasks.remove_if([](const FetchTask& fetchTask){ return fetchTask.mTask->isDone(); });
+
+    mFetchTasks.push_back({ index, readCount, readAhead, mBackend.GetThreadPool().Submit(
+        [this, index, readCount, priority]{ 
+            const RunnerPool::PriorityScope priorityScope(priority);
+            FetchPages(index, readCount); }) });
+}
+
+/*****************************************************/
+bool PageManager::TryRunFetch(const uint64_t index, UniqueLock& pagesLock)
+{
+    const std::list<FetchTask>::const_iterator taskIt { std::find_if(mFetchTasks.cbegin(), mFetchTasks.cend(),
+        [&](const FetchTask& fetchTask){ return index >= fetchTask.mIndex && 
+            index < fetchTask.mIndex + fetchTask.mCount && !fetchTask.mTask->isStarted(); }) };
+    if (taskIt == mFetchTasks.cend()) return false;
+
+    MDBG_INFO("... running fetch inline for " << index << " start:" << taskIt->mIndex);
+    const ThreadPool::TaskPtr task { taskIt->mTask }; // copy
+
+    pagesLock.unlock(); // fetch needs pagesLock
+    { const RunnerPool::PriorityScope priorityScope(RunnerPool::Priority::FOREGROUND); // we are waiting on it
+    task->TryRun(); } // might have been started since
+    pagesLock.lock(); return true;
+}
+
+/*****************************************************/
+bool PageManager::TryFetchOutOfOrder(const uint64_t index, const UniqueLock& pagesLock)
+{
+    // the running fetch that will deliver the page, unless it's already being fetched alone
+    const FetchTask* stream { nullptr };
+    for (const FetchTask& fetchTask : mFetchTasks)
+    {
+        if (index < fetchTask.mIndex || index >= fetchTask.mIndex + fetchTask.mCount || fetchTask.mTask->isDone()) continue;
+        if (fetchTask.mIndex == index) return false; // next up anyway
+        stream = &fetchTask;
+    }
+    if (stream == nullptr || !stream->mTask->isStarted()) return false; // TryRunFetch() will run it
+
+    const BandwidthEstimator& bandwidth { mBackend.GetReadBandwidth() };
+    if (!bandwidth.HasSamples()) return false; // no idea how long either takes
+
+    // pages still to come before ours - pending ranges of adjacent fetches may be coalesced
+    const PendingMap::const_iterator it { mPendingPages.find(index) };
+    const uint64_t first { std::max(it->first, stream->mIndex) };
+    if (first >= index) return false; // next up
+
+    const double bytesPerSec { bandwidth.GetBandwidth() };
+    const double waitTime { static_cast<double>((index-first)*mPageSize) / 
+        (bytesPerSec*static_cast<double>(GetFetchStreams(stream->mCount))) };
+    const double directTime { bandwidth.GetLatency() + static_cast<double>(mPageSize)/bytesPerSec };
+    if (waitTime <= directTime*OUT_OF_ORDER_FACTOR) return false;
+
+    MDBG_INFO("(index:" << index << ") fetching out of order, stream at:" << first 
+        << " waitTime(ms):" << waitTime*1000 << " directTime(ms):" << directTime*1000);
+    StartFetch(index, 1, pagesLock, RunnerPool::Priority::FOREGROUND, false);
+    return true;
 }
 
 /*****************************************************/
@@ -385,62 +771,201 @@ void PageManager::FetchPages(const uint64_t index, const size_t count) noexcept
 {
     // use a read-priority lock since the caller is waiting on us, 
     // if another write happens in the middle we would deadlock
+    // the destructor waits for our job to finish so we don't need the scope lock
     const SharedLockRP thisLock { GetReadPriLock() };
 
-    // lock fetch mutex so the destructor has to wait for us to finish
-    // can't acquire the scope lock here because the destructor could already be waiting!
-    const std::shared_lock<std::shared_mutex> fetchLock(mFetchMutex);
-
-    uint64_t curIndex { index }; try
+    uint64_t curIndex { index }; 
+    bool cancelled { false }; try
     {
         MDBG_INFO("(index:" << index << " count:" << count << ")");
-        const std::chrono::steady_clock::time_point timeStart { std::chrono::steady_clock::now() };
 
-        const size_t readSize { mPageBackend.FetchPages(index, count, 
-            [&](const uint64_t pageIndex, Page&& page)
+        const PageBackend::PageHandler pageHandler { [&](const uint64_t pageIndex, Page&& page)->bool
         {
             // if we are reading a page that is smaller on the backend (dirty writes), might need to extend
-            const uint64_t pageStart { index*mPageSize }; // offset of the page start
+            const uint64_t pageStart { pageIndex*mPageSize }; // offset of the page start
             const size_t realSize { min64st(mFileSize-pageStart, mPageSize) };
             if (page.size() < realSize) ResizePage(page, realSize, false);
 
             const UniqueLock pagesLock(mPagesMutex);
-            // hold pagesLock because if inform fails, we will remove this page
-            const PageMap::iterator newIt { mPages.emplace(pageIndex, std::move(page)).first };
+            if (mPages.find(pageIndex) != nullptr) // fetched out of order, see TryFetchOutOfOrder()
+            {
+                MDBG_INFO("... page " << pageIndex << " already fetched, skipping");
+            }
+            else
+            {
+                // hold pagesLock because if inform fails, we will remove this page
+                const Page& newPage { *mPages.emplaceHidden(pageIndex, std::move(page)).first };
+
+                InformNewPageRead(pageIndex, newPage, false, false, pagesLock);
+                // pass false to not wait - not allowed to call the backend for evict/flush within this callback
+                // even if canWait was true, the CacheManager could have us skip the wait to get our W lock for evict
+                RemovePendingFetch(pageIndex, 1, pagesLock); 
+            }
 
-            InformNewPageRead(pageIndex, newIt->second, false, false, pagesLock);
-            // pass false to not wait - not allowed to call the backend for evict/flush within this callback
-            // even if canWait was true, the CacheManager could have us skip the wait to get our W lock for evict
-            RemovePendingFetch(pageIndex, true, pagesLock); 
+            ++curIndex; // stop before the next page if the rest was cancelled
+            cancelled = curIndex < index+count && mCancelledPages.contains(curIndex);
+            return !cancelled;
+        } };
 
-            ++curIndex;
-        }, thisLock) };
+        while (curIndex < index+count)
+        {
+            { const UniqueLock pagesLock(mPagesMutex); // maybe cancelled before starting
+                cancelled = mCancelledPages.contains(curIndex); }
+            if (cancelled) break;
 
-        if (readSize >= mPageSize) // don't consider small reads
-            UpdateBandwidth(readSize, std::chrono::steady_clock::now()-timeStart);
+            if (mDiskCache != nullptr) // serve what we can locally, then fetch the gap
+            {
+                const size_t remain { static_cast<size_t>(index+count-curIndex) };
+                if (FetchDiskPages(curIndex, remain, pageHandler, thisLock) == remain || cancelled) break;
+            }
+
+            const size_t remain { static_cast<size_t>(index+count-curIndex) };
+            const size_t fetchCount { (mDiskCache != nullptr) ? GetDiskMissCount(curIndex, remain, thisLock) : remain };
+            const std::chrono::steady_clock::time_point timeStart { std::chrono::steady_clock::now() };
+
+            const size_t streams { GetFetchStreams(fetchCount) };
+            const size_t readSize { mPageBackend.FetchPages(curIndex, fetchCount, pageHandler, thisLock, streams) };
+
+            if (cancelled) break; // the time includes aborting, not a useful sample
+            if (readSize >= mPageSize*streams) // don't consider small reads
+                UpdateBandwidth(readSize/streams, std::chrono::steady_clock::now()-timeStart);
+        }
     }
     catch (const BackendException& ex)
     {
         MDBG_ERROR("... " << ex.what());
         const UniqueLock pagesLock(mPagesMutex);
 
-        const std::exception_ptr exptr { std::current_exception() };
-        for (uint64_t eidx { curIndex }; eidx < index+count; ++eidx)
-            mFailedPages[eidx] = exptr; // shared_ptr
+        if (curIndex < index+count && !cancelled) // exception can happen after reading
+        {
+            const size_t failCount { static_cast<size_t>(index+count-curIndex) };
+            mFailedPages.insert(curIndex, failCount, std::current_exception());
+            mAccessPattern.CancelReadAhead(curIndex, failCount);
+            mCancelledPages.erase(curIndex, failCount);
+            RemovePendingFetch(curIndex, failCount, pagesLock);
+        }
+    }
+
+    if (cancelled)
+    {
+        const UniqueLock pagesLock(mPagesMutex);
+
+        const size_t cancelCount { static_cast<size_t>(index+count-curIndex) };
+        const uint64_t cancelEnd { std::min(mPageBackend.GetBackendSize(thisLock), (index+count)*mPageSize) };
+        const uint64_t cancelBytes { cancelEnd - std::min(cancelEnd, curIndex*mPageSize) };
+        MDBG_INFO("... cancelled index:" << curIndex << " count:" << cancelCount << " bytes:" << cancelBytes);
 
-        if (curIndex < index+count) // exception can happen after reading
-            RemovePendingFetch(curIndex, false, pagesLock);
+        mCancelledBytes += cancelBytes;
+        mAccessPattern.CancelReadAhead(curIndex, cancelCount);
+        mCancelledPages.erase(curIndex, cancelCount);
+        RemovePendingFetch(curIndex, cancelCount, pagesLock);
     }
     
-    MDBG_INFO("... thread returning!");
+    MDBG_INFO("... fetch returning!");
+}
+
+/*****************************************************/
+DiskCache::FileInfo PageManager::GetDiskInfo(const SharedLock& thisLock) const
+{
+    return { mPageBackend.GetBackendSize(thisLock), mFile.GetModified(thisLock), mPageSize };
+}
+
+/*****************************************************/
+size_t PageManager::FetchDiskPages(const uint64_t index, const size_t count, const PageBackend::PageHandler& pageHandler, const SharedLock& thisLock)
+{
+    const DiskCache::FileInfo info { GetDiskInfo(thisLock) };
+    const uint64_t backendSize { info.fileSize };
+
+    size_t readCount { 0 };
+    for (; readCount < count; ++readCount)
+    {
+        const uint64_t pageIndex { index+readCount };
+        const size_t pageSize { min64st(backendSize-pageIndex*mPageSize, mPageSize) };
+
+        Page page(pageSize, mBackend.GetPageAllocator());
+        if (!mDiskCache->ReadPage(mPageBackend.GetFileID(), pageIndex, info, page.data(), pageSize)) break;
+        if (!pageHandler(pageIndex, std::move(page))) { ++readCount; break; } // cancelled
+    }
+
+    if (readCount) { MDBG_INFO("(index:" << index << " count:" << count << ") read " << readCount << " from disk"); }
+    return readCount;
+}
+
+/*****************************************************/
+size_t PageManager::GetDiskMissCount(const uint64_t index, const size_t count, const SharedLock& thisLock)
+{
+    const DiskCache::FileInfo info { GetDiskInfo(thisLock) };
+
+    size_t missCount { 1 }; // the first page just missed
+    while (missCount < count && !mDiskCache->HasPage(mPageBackend.GetFileID(), index+missCount, info))
+        ++missCount;
+    return missCount;
+}
+
+/*****************************************************/
+void PageManager::StoreDiskPage(const uint64_t index, Page&& page, const SharedLockW& thisLock)
+{
+    for (decltype(mDiskStores)::iterator it { mDiskStores.begin() }; it != mDiskStores.end(); )
+        it = it->second->isDone() ? mDiskStores.erase(it) : std::next(it);
+    WaitDiskStore(index, thisLock); // replace
+
+    const DiskCache::FileInfo info { GetDiskInfo(thisLock) };
+    if (mDiskStores.size() >= MAX_DISK_STORES) // don't let uncounted memory pile up
+    {
+        MDBG_INFO("(index:" << index << ") too many queued, storing now");
+        mDiskCache->StorePage(mPageBackend.GetFileID(), index, info, page.data(), page.size());
+        return;
+    }
+
+    mDiskStores.emplace(index, mBackend.GetThreadPool().Submit(
+        [diskCache { mDiskCache }, fileID { mPageBackend.GetFileID() }, index, info, 
+         pagePtr { std::make_shared<Page>(std::move(page)) }]()
+    {
+        diskCache->StorePage(fileID, index, info, pagePtr->data(), pagePtr->size());
+    }));
+}
+
+/*****************************************************/
+void PageManager::WaitDiskStore(const uint64_t index, const SharedLockW& thisLock)
+{
+    const decltype(mDiskStores)::iterator it { mDiskStores.find(index) };
+    if (it == mDiskStores.end()) return;
+
+    if (!it->second->Cancel()) it->second->Wait();
+    mDiskStores.erase(it);
+}
+
+/*****************************************************/
+size_t PageManager::GetMaxStreams() const
+{
+    const ConfigOptions& options { mBackend.GetOptions() };
+    return std::max(static_cast<size_t>(1), std::min(options.fetchStreams, options.runnerPoolSize));
+}
+
+/*****************************************************/
+size_t PageManager::GetFetchStreams(const size_t count)
+{
+    const UniqueLock llock(mFetchSizeMutex);
+    // use as many streams as needed to get count pages in about readAheadTime
+    const size_t streams { std::min(GetMaxStreams(), (count+mFetchSize-1)/mFetchSize) };
+    if (streams > 1) { MDBG_INFO("(count:" << count << ") streams:" << streams); }
+    return std::max(static_cast<size_t>(1), streams);
 }
 
 /*****************************************************/
 void PageManager::UpdateBandwidth(const size_t bytes, const std::chrono::steady_clock::duration& time)
+{
+    mBackend.GetReadBandwidth().AddSample(bytes, time);
+    UpdateFetchSize();
+}
+
+/*****************************************************/
+void PageManager::UpdateFetchSize()
 {
     const UniqueLock llock(mFetchSizeMutex);
 
-    size_t targetBytes { mBandwidth.UpdateBandwidth(bytes, time) };
+    // size each request from the bandwidth-delay product, taking at most readAheadTime
+    size_t targetBytes { mBackend.GetReadBandwidth().GetRequestBytes(mBackend.GetOptions().readAheadTime) };
 
     if (mCacheMgr)
     {
@@ -457,40 +982,31 @@ void PageManager::UpdateBandwidth(const size_t bytes, const std::chrono::steady_
 }
 
 /*****************************************************/
-uint64_t PageManager::GetWriteList(PageMap::iterator& pageIt, PageBackend::PagePtrList& writeList, const SharedLockW& thisLock)
+uint64_t PageManager::GetWriteList(uint64_t& index, PageBackend::PagePtrList& writeList, const SharedLockW& thisLock)
 {
-    MDBG_INFO("(pageItIndex:" << pageIt->first << ")");
-
-    size_t curSize { 0 };
-    uint64_t lastIndex { 0 };
+    MDBG_INFO("(index:" << index << ")");
 
-    uint64_t startIndex { (mFileSize-1)/mPageSize+1 }; // invalid
+    const uint64_t startIndex { mPages.nextDirty(index) }; // skips clean pages
+    if (startIndex == PageMap::NONE) { index = PageMap::NONE; return startIndex; }
+    MDBG_INFO("... start write run at " << startIndex);
 
-    for (; pageIt != mPages.end(); ++pageIt)
+    size_t curSize { 0 };
+    for (index = startIndex; mPages.isDirty(index); ++index) // consecutive
     {
-        if (pageIt->second.isDirty())
-        {
-            const size_t pageSize { pageIt->second.size() };
+        Page& page { mPages.at(index) };
+        const size_t pageSize { page.size() };
 
-            if (writeList.empty())
-            {
-                startIndex = pageIt->first;
-                MDBG_INFO("... start write run at " << startIndex);
-            }
-            else if (lastIndex+1 != pageIt->first || // not consecutive
-                     curSize + pageSize < curSize) break; // size_t overflow!
-            else
-            {
-                const size_t maxWrite { mBackend.GetConfig().GetUploadMaxBytes() };
-                // no point in doing a bigger write than the backend can send at once
-                if (maxWrite && curSize + pageSize > maxWrite) break;
-            }
+        if (!writeList.empty())
+        {
+            if (curSize + pageSize < curSize) break; // size_t overflow!
 
-            lastIndex = pageIt->first;
-            writeList.push_back(&pageIt->second);
-            curSize += pageIt->second.size();
+            const size_t maxWrite { mBackend.GetConfig().GetUploadMaxBytes() };
+            // no point in doing a bigger write than the backend can send at once
+            if (maxWrite && curSize + pageSize > maxWrite) break;
         }
-        else if (!writeList.empty()) break; // end run
+
+        writeList.push_back(&page);
+        curSize += pageSize;
     }
 
     MDBG_INFO("... return size: " << writeList.size());
@@ -502,54 +1018,133 @@ void PageManager::EvictPage(const uint64_t index, const SharedLockW& thisLock)
 {
     MDBG_INFO("(" << mFile.GetName(thisLock) << ") (index:" << index << ")");
 
-    const PageMap::iterator pageIt { mPages.find(index) };
-    if (pageIt != mPages.end())
+    { UniqueLock flushLock(mFlushMutex);
+    if (isFlushing(index, flushLock))
+    {
+        // can't drop it until written, else a read could fetch old data
+        MDBG_INFO("... page is flushing, waiting");
+        flushLock.unlock();
+        FinishFlushes(true, thisLock);
+    } }
+
+    Page* const pagePtr { mPages.find(index) };
+    if (pagePtr != nullptr)
     {
+        Page& page { *pagePtr };
         // ignore dirty evictions if we can't random write
         const bool randWrite { mFile.GetWriteMode() >= FSConfig::WriteMode::RANDOM };
 
-        if (pageIt->second.isDirty() && randWrite)
+        if (page.isDirty() && randWrite)
         {
             MDBG_INFO("... page is dirty, writing");
             PageBackend::PagePtrList writeList;
-            PageMap::iterator pageItTmp { pageIt }; // copy
+            uint64_t writeIndex { index }; // copy
 
-            GetWriteList(pageItTmp, writeList, thisLock);
+            GetWriteList(writeIndex, writeList, thisLock);
             // writeList won't be empty as the start page is dirty
             FlushPageList(index, writeList, thisLock);
         }
 
-        if (mCacheMgr) mCacheMgr->RemovePage(pageIt->second);
+        // keep a local copy of clean pages - only if it's exactly the backend's page
+        const bool diskStore { mDiskCache != nullptr && !page.isDirty() && !page.isPartial() && mPageBackend.ExistsOnBackend(thisLock) };
+        const bool erase { !page.isDirty() || randWrite };
+
+        if (mCacheMgr) mCacheMgr->RemovePage(page);
+        if (diskStore) StoreDiskPage(index, std::move(page), thisLock); // erased below
 
-        if (!pageIt->second.isDirty() || randWrite)
-            mPages.erase(pageIt);
-        else mDeferredEvicts.push_back(pageIt->first);
+        if (erase)
+        {
+            mAccessPattern.RemovePages(index, 1);
+            mPages.erase(index);
+        }
+        else mDeferredEvicts.push_back(index);
 
         MDBG_INFO("... page removed, numPages:" << mPages.size());
     }
     else { MDBG_INFO(" ... page not found"); }
 }
 
+/*****************************************************/
+void PageManager::EvictPages(const uint64_t index, const size_t count, const SharedLockW& thisLock)
+{
+    MDBG_INFO("(" << mFile.GetName(thisLock) << ") (index:" << index << " count:" << count << ")");
+
+    std::vector<uint64_t> indexes;
+    { const UniqueLock pagesLock(mPagesMutex); // lock scope
+    for (uint64_t nextIdx { mPages.next(index) }; 
+        nextIdx != PageMap::NONE && nextIdx-index < count; nextIdx = mPages.next(nextIdx+1))
+    {
+        indexes.push_back(nextIdx);
+    } }
+
+    for (const uint64_t evictIdx : indexes)
+        EvictPage(evictIdx, thisLock);
+}
+
+/*****************************************************/
+void PageManager::Prefetch(const uint64_t index, const size_t count, const SharedLock& thisLock)
+{
+    MDBG_INFO("(" << mFile.GetName(thisLock) << ") (index:" << index << " count:" << count << ")");
+
+    // don't let a hint push out the rest of the cache, same as a read-ahead
+    size_t maxCount { count };
+    if (mCacheMgr) maxCount = std::min(maxCount, std::max(size_t{1}, 
+        mCacheMgr->GetMemoryLimit()/mBackend.GetOptions().readMaxCacheFrac/mPageSize));
+
+    const UniqueLock pagesLock(mPagesMutex);
+    const uint64_t endIndex { std::min(index+maxCount, (mFileSize+mPageSize-1)/mPageSize) };
+    for (uint64_t nextIdx { index }; nextIdx < endIndex; )
+    {
+        const size_t fetchSize { isFetchPending(nextIdx, pagesLock) ? 0 : 
+            GetFetchSize(nextIdx, min64st(endIndex-nextIdx, maxCount), thisLock, pagesLock) };
+        if (!fetchSize) { ++nextIdx; continue; } // exists, pending or not on the backend
+
+        MDBG_INFO("... prefetch nextIdx:" << nextIdx << " fetchSize:" << fetchSize);
+        StartFetch(nextIdx, fetchSize, pagesLock, RunnerPool::Priority::READAHEAD, false); // not stale
+        mAccessPattern.AddReadAhead(nextIdx, fetchSize);
+        nextIdx += fetchSize;
+    }
+}
+
+/*****************************************************/
+void PageManager::SetAdvice(const File::Advice advice, const SharedLock& thisLock)
+{
+    MDBG_INFO("(" << mFile.GetName(thisLock) << ") (advice:" << static_cast<int>(advice) << ")");
+
+    mNoCache.store(advice == File::Advice::NOCACHE);
+
+    const UniqueLock pagesLock(mPagesMutex);
+    switch (advice)
+    {
+        case File::Advice::SEQUENTIAL: mAccessPattern.SetOverride(AccessPattern::Pattern::SEQUENTIAL); break;
+        case File::Advice::RANDOM: mAccessPattern.SetOverride(AccessPattern::Pattern::RANDOM); break;
+        default: mAccessPattern.SetOverride(AccessPattern::Pattern::UNKNOWN); break;
+    }
+}
+
 /*****************************************************/
 size_t PageManager::FlushPage(const uint64_t index, const SharedLockW& thisLock)
 {
     MDBG_INFO("(" << mFile.GetName(thisLock) << ") (index:" << index << ")");
 
     size_t written { 0 };
-    PageMap::iterator pageIt { mPages.find(index) };
-    if (pageIt != mPages.end())
+    Page* const pagePtr { mPages.find(index) };
+    if (pagePtr != nullptr)
     {
         // ignore page flushes if we can't random write
         const bool randWrite { mFile.GetWriteMode() >= FSConfig::WriteMode::RANDOM };
         
         PageBackend::PagePtrList writeList;
-        if (pageIt->second.isDirty() && randWrite)
-            GetWriteList(pageIt, writeList, thisLock);
+        if (pagePtr->isDirty() && randWrite)
+        {
+            uint64_t writeIndex { index }; // copy
+            GetWriteList(writeIndex, writeList, thisLock);
+        }
         else { MDBG_INFO(" ... page not found"); }
         
         if (!writeList.empty())
             written = FlushPageList(index, writeList, thisLock);
-        else if (mCacheMgr) mCacheMgr->RemoveDirty(pageIt->second);
+        else if (mCacheMgr) mCacheMgr->RemoveDirty(*pagePtr);
     }
     
     MDBG_INFO("... return:" << written); return written;
@@ -560,25 +1155,32 @@ void PageManager::FlushPages(const SharedLockW& thisLock)
 {
     MDBG_INFO("()");
 
+    FinishFlushes(false, thisLock); // failed pages are dirty again
+
     // create runs of pages to write separate from mPages so we don't have to hold pagesLock
     std::map<uint64_t, PageBackend::PagePtrList> writeLists;
 
-    PageMap::iterator pageIt { mPages.begin() };
-    while (pageIt != mPages.end())
+    uint64_t pageIndex { 0 };
+    while (pageIndex != PageMap::NONE)
     {
         PageBackend::PagePtrList writeList;
         const uint64_t startIndex {
-            GetWriteList(pageIt, writeList, thisLock) };
+            GetWriteList(pageIndex, writeList, thisLock) };
 
         if (!writeList.empty())
             writeLists.emplace(startIndex, std::move(writeList));
-        // this loop is not N^2 as GetWriteList() increments our pageIt
+        // this loop is not N^2 as GetWriteList() advances our pageIndex
     }
 
     MDBG_INFO("... write runs:" << writeLists.size());
     
     if (writeLists.empty()) // run anyway so FlushCreate() is called
         FlushPageList(0, PageBackend::PagePtrList(), thisLock);
+    else if (CanFlushAsync(thisLock)) // don't hold the W lock while uploading
+    {
+        for (const decltype(writeLists)::value_type& writePair : writeLists)
+            StartFlush(writePair.first, writePair.second, thisLock);
+    }
     else for (const decltype(writeLists)::value_type& writePair : writeLists)
         FlushPageList(writePair.first, writePair.second, thisLock);
 
@@ -594,15 +1196,20 @@ size_t PageManager::FlushPageList(const uint64_t index, const PageBackend::PageP
 {
     MDBG_INFO("(index:" << index << " pages:" << pages.size() << ")");
 
+    // writes must happen in order, so finish any background flushes first
+    if (!pages.empty()) FinishFlushes(true, thisLock);
+
     // truncate is only cached before mBackendExists
     const bool flushCreate { !mPageBackend.ExistsOnBackend(thisLock) };
 
     const size_t totalSize { pages.empty() ? 0 : 
         mPageBackend.FlushPageList(index, pages, thisLock) };
 
+    uint64_t pageIndex { index };
     for (Page* pagePtr : pages)
     {
         pagePtr->setDirty(false);
+        mPages.setDirty(pageIndex++, false);
         if (mCacheMgr) mCacheMgr->RemoveDirty(*pagePtr);
     }
 
@@ -611,6 +1218,182 @@ size_t PageManager::FlushPageList(const uint64_t index, const PageBackend::PageP
     return totalSize;
 }
 
+/*****************************************************/
+bool PageManager::CanFlushAsync(const SharedLockW& thisLock) const
+{
+    return mPageBackend.ExistsOnBackend(thisLock) && 
+        mFile.GetWriteMode() >= FSConfig::WriteMode::RANDOM;
+}
+
+/*****************************************************/
+void PageManager::StartFlush(const uint64_t index, const PageBackend::PagePtrList& pages, const SharedLockW& thisLock)
+{
+    MDBG_INFO("(index:" << index << " pages:" << pages.size() << ")");
+
+    // the extents must be found before the dirty ranges are cleared
+    PageBackend::ExtentList extents { mPageBackend.GetExtents(index, pages, thisLock) };
+
+    uint64_t pageIndex { index };
+    for (Page* pagePtr : pages)
+    {
+        pagePtr->setDirty(false);
+        mPages.setDirty(pageIndex++, false);
+        if (mCacheMgr) mCacheMgr->RemoveDirty(*pagePtr);
+    }
+
+    const UniqueLock flushLock(mFlushMutex);
+    mFlushJobs.emplace_back();
+    mFlushJobs.back().mIndex = index;
+    mFlushJobs.back().mPages = pages;
+    mFlushJobs.back().mExtents = std::move(extents);
+
+    if (mFlushTask == nullptr) // jobs run one at a time in order
+        mFlushTask = mBackend.GetThreadPool().Submit([this](){ 
+            const RunnerPool::PriorityScope priorityScope(RunnerPool::Priority::WRITEBACK);
+            RunFlushJobs(); });
+}
+
+/*****************************************************/
+void PageManager::RunFlushJobs() noexcept // thread cannot throw
+{
+    UniqueLock flushLock(mFlushMutex);
+    while (true)
+    {
+        const decltype(mFlushJobs)::iterator jobIt { std::find_if(mFlushJobs.begin(), mFlushJobs.end(),
+            [](const FlushJob& job){ return !job.mStarted; }) };
+        if (jobIt == mFlushJobs.end()) break;
+
+        FlushJob& job { *jobIt };
+        job.mStarted = true;
+        flushLock.unlock();
+
+        std::exception_ptr error;
+        try { mPageBackend.WritePages(job.mIndex, job.mPages, job.mExtents, mFlushMutex); }
+        catch (const BackendException& ex)
+        {
+            MDBG_ERROR("... " << ex.what());
+            error = std::current_exception();
+        }
+
+        flushLock.lock();
+        job.mError = error;
+        job.mDone = true;
+        if (mFlushFailure == nullptr) mFlushFailure = error;
+        mFlushCV.notify_all();
+    }
+
+    mFlushTask = nullptr; // done
+}
+
+/*****************************************************/
+void PageManager::WaitFlushJobs(UniqueLock& flushLock)
+{
+    while (std::any_of(mFlushJobs.cbegin(), mFlushJobs.cend(), 
+        [](const FlushJob& job){ return !job.mDone; }))
+    {
+        const ThreadPool::TaskPtr flushTask { mFlushTask };
+        if (flushTask != nullptr)
+        {
+            flushLock.unlock(); // RunFlushJobs() needs it
+            const bool ran { flushTask->TryRun() };
+            flushLock.lock();
+            if (ran) continue; // re-check
+        }
+
+        MDBG_INFO("... waiting for flush jobs");
+        mFlushCV.wait(flushLock);
+    }
+}
+
+/*****************************************************/
+void PageManager::WaitFlush()
+{
+    MDBG_INFO("()");
+
+    UniqueLock flushLock(mFlushMutex);
+    WaitFlushJobs(flushLock);
+
+    // the failed jobs may already be removed by FinishFlushes(), or be from before the last wait
+    std::exception_ptr failure { nullptr };
+    std::swap(failure, mFlushFailure);
+    if (failure != nullptr) std::rethrow_exception(failure);
+}
+
+/*****************************************************/
+void PageManager::RetryFailedFlushes() noexcept
+{
+    for (const FlushJob& job : mFlushJobs)
+    {
+        if (job.mError == nullptr) continue;
+
+        MDBG_INFO("... retrying failed flush index:" << job.mIndex << " pages:" << job.mPages.size());
+        try { mPageBackend.WritePages(job.mIndex, job.mPages, job.mExtents, mFlushMutex); }
+        catch (const BackendException& ex)
+        {
+            MDBG_ERROR("... flush of index:" << job.mIndex << " pages:" << job.mPages.size() << " lost: " << ex.what());
+        }
+    }
+}
+
+/*****************************************************/
+void PageManager::FinishFlushes(const bool wait, const SharedLockW& thisLock)
+{
+    UniqueLock flushLock(mFlushMutex);
+    if (wait) WaitFlushJobs(flushLock);
+
+    while (!mFlushJobs.empty() && mFlushJobs.front().mDone)
+    {
+        const FlushJob& job { mFlushJobs.front() };
+        if (job.mError == nullptr)
+        {
+            if (!job.mExtents.empty())
+            {
+                const PageBackend::Extent& lastExtent { job.mExtents.back() };
+                const uint64_t writeEnd { job.mIndex*mPageSize + lastExtent.first + lastExtent.second };
+                if (writeEnd > mPageBackend.GetBackendSize(thisLock))
+                    mPageBackend.SetBackendSize(writeEnd, thisLock);
+            }
+        }
+        else for (uint64_t pageIndex { job.mIndex }; pageIndex < job.mIndex+job.mPages.size(); ++pageIndex)
+        {
+            Page* const pagePtr { mPages.find(pageIndex) };
+            if (pagePtr == nullptr || pagePtr->isDirty()) continue;
+
+            MDBG_INFO("... flush failed, re-dirty page " << pageIndex);
+            pagePtr->setDirty(); mPages.setDirty(pageIndex);
+            if (mCacheMgr && !mBackend.isMemory()) // no wait, we hold mFlushMutex
+                mCacheMgr->InformPage(*this, pageIndex, *pagePtr, true, false);
+        }
+        mFlushJobs.pop_front();
+    }
+}
+
+/*****************************************************/
+bool PageManager::isFlushing(const uint64_t index, const UniqueLock& flushLock) const
+{
+    return std::any_of(mFlushJobs.cbegin(), mFlushJobs.cend(), [&](const FlushJob& job){
+        return index >= job.mIndex && index < job.mIndex+job.mPages.size(); });
+}
+
+/*****************************************************/
+void PageManager::ShadowFlushPage(const uint64_t index, Page& page, const SharedLockW& thisLock)
+{
+    const UniqueLock flushLock(mFlushMutex);
+    for (FlushJob& job : mFlushJobs)
+    {
+        if (job.mDone || index < job.mIndex || index >= job.mIndex+job.mPages.size()) continue;
+
+        Page*& jobPage { job.mPages[static_cast<size_t>(index-job.mIndex)] };
+        if (jobPage != &page) continue; // already shadowed
+
+        MDBG_INFO("... shadowing in-flight page " << index);
+        job.mRetired.emplace_back(std::move(page));
+        jobPage = &job.mRetired.back();
+
+        page.copyFrom(*jobPage); // the moved-from page is empty
+    }
+}
+
 /*****************************************************/
 void PageManager::FlushCreate(const SharedLockW& thisLock)
 {
@@ -619,13 +1402,10 @@ void PageManager::FlushCreate(const SharedLockW& thisLock)
     mPageBackend.FlushCreate(thisLock); // maybe not done yet
 
     uint64_t maxDirty { 0 }; // byte after last dirty byte
-    for (const PageMap::value_type& it : mPages)
+    for (uint64_t index { mPages.nextDirty(0) }; index != PageMap::NONE; index = mPages.nextDirty(index+1))
     {
-        if (it.second.isDirty())
-        {
-            const uint64_t pageMax { it.first*mPageSize + it.second.size() };
-            maxDirty = std::max(maxDirty, pageMax);
-        }
+        const uint64_t pageMax { index*mPageSize + mPages.at(index).size() };
+        maxDirty = std::max(maxDirty, pageMax);
     }
 
     // mFileSize should only be larger than mBackendSize if dirty writes
@@ -644,22 +1424,24 @@ void PageManager::RemoteChanged(const uint64_t backendSize, const SharedLockW& t
     MDBG_INFO("(newSize:" << backendSize << ") oldSize:" 
         << mPageBackend.GetBackendSize(thisLock) << ")");
 
+    FinishFlushes(true, thisLock); // our own writes come first
+
     uint64_t maxDirty { 0 };  // byte after last dirty byte
-    for (PageMap::iterator it { mPages.begin() }; it != mPages.end(); )
+    for (uint64_t index { mPages.next(0) }; index != PageMap::NONE; index = mPages.next(index+1))
     {
-        const Page& page { it->second };
+        const Page& page { mPages.at(index) };
         if (!page.isDirty()) // evict all non-dirty
         {
             if (mCacheMgr) mCacheMgr->RemovePage(page);
-            it = mPages.erase(it);
+            mAccessPattern.RemovePages(index, 1);
+            mPages.erase(index);
         }
         else
         {
             MDBG_ERROR("... WARNING remote changed while we have dirty pages!");
 
-            const uint64_t pageMax { it->first*mPageSize + page.size() };
+            const uint64_t pageMax { index*mPageSize + page.size() };
             maxDirty = std::max(maxDirty, pageMax);
-            ++it; // move to next page
         }
     }
 
@@ -672,32 +1454,51 @@ void PageManager::Truncate(const uint64_t newSize, const SharedLockW& thisLock)
 {
     MDBG_INFO("(oldSize:" << mFileSize << ", newSize:" << newSize << ")");
 
+    FinishFlushes(true, thisLock); // in order, and may remove flushing pages
     mPageBackend.Truncate(newSize, thisLock);
     mFileSize = newSize;
 
-    for (PageMap::iterator it { mPages.begin() }; it != mPages.end(); )
+    // fetches queued before now must not read past the end
+    CancelFetches((newSize+mPageSize-1)/mPageSize);
+
+    for (uint64_t index { mPages.next(0) }; index != PageMap::NONE; index = mPages.next(index+1))
     {
-        if (!newSize || it->first > (newSize-1)/mPageSize) // remove past end
+        Page& page { mPages.at(index) };
+        if (!newSize || index > (newSize-1)/mPageSize) // remove past end
         {
-            MDBG_INFO("... erase page:" << it->first);
-            if (mCacheMgr) mCacheMgr->RemovePage(it->second);
-            it = mPages.erase(it);
+            MDBG_INFO("... erase page:" << index);
+            if (mCacheMgr) mCacheMgr->RemovePage(page);
+            mAccessPattern.RemovePages(index, 1);
+            mPages.erase(index);
         }
-        else if (it->first == (newSize-1)/mPageSize) // the newly last page
+        else if (index == (newSize-1)/mPageSize) // the newly last page
         {
-            const size_t pageSize { static_cast<size_t>(newSize - it->first*mPageSize) };
-            MDBG_INFO("... resize new last page:" << it->first << " size:" << pageSize);
-            ResizePage(it->second, pageSize, true, &thisLock); ++it;
+            const size_t pageSize { static_cast<size_t>(newSize - index*mPageSize) };
+            MDBG_INFO("... resize new last page:" << index << " size:" << pageSize);
+            ResizePage(page, pageSize, true, &thisLock);
         }
-        else if (it->second.size() != mPageSize) // all non-last pages should be full size
+        else if (page.size() != mPageSize) // all non-last pages should be full size
         {
-            MDBG_INFO("... resize old last page:" << it->first << " size:" << mPageSize);
-            ResizePage(it->second, mPageSize, true, &thisLock); ++it;
+            MDBG_INFO("... resize old last page:" << index << " size:" << mPageSize);
+            ResizePage(page, mPageSize, true, &thisLock);
         }
-        else ++it;
     }
 }
 
+/*****************************************************/
+void PageManager::ValidateDiskCache(const SharedLockW& thisLock)
+{
+    if (mDiskCache != nullptr && mPageBackend.ExistsOnBackend(thisLock))
+        mDiskCache->Validate(mPageBackend.GetFileID(), GetDiskInfo(thisLock));
+}
+
+/*****************************************************/
+AccessPattern::Stats PageManager::GetAccessStats(const SharedLock& thisLock)
+{
+    const UniqueLock pagesLock(mPagesMutex);
+    return mAccessPattern.GetStats();
+}
+
 } // namespace Filedata
 } // namespace Filesystem
 } // namespace Andromeda
@@ -2,23 +2,31 @@
 #ifndef LIBA2_PAGEMANAGER_H_
 #define LIBA2_PAGEMANAGER_H_
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <exception>
+#include <limits>
 #include <list>
 #include <map>
 #include <mutex>
 #include <shared_mutex>
-#include <thread>
+#include <unordered_map>
 
-#include "BandwidthMeasure.hpp"
+#include "AccessPattern.hpp"
+#include "DiskCache.hpp"
 #include "PageBackend.hpp"
+#include "PageTable.hpp"
 
 #include "andromeda/common.hpp"
 #include "andromeda/Debug.hpp"
+#include "andromeda/RangeMap.hpp"
 #include "andromeda/ScopeLocked.hpp"
 #include "andromeda/SharedMutex.hpp"
+#include "andromeda/ThreadPool.hpp"
+#include "andromeda/backend/RunnerPool.hpp"
 
 #include "andromeda/filesystem/File.hpp"
 
@@ -38,9 +46,16 @@ class Page;
  * Implements various tricks/caching to greatly increase speed:
  *  - caches pages read from the backend (see EvictPage)
  *  - reads ahead consecutive ranges of pages sized by bandwidth,
- *      doing so on a background thread to minimize waiting
+ *      doing so on the backend's thread pool to minimize waiting
+ *  - splits large read-aheads into concurrent requests (see ConfigOptions fetchStreams)
+ *  - adapts read-ahead to the detected access pattern (see AccessPattern)
+ *  - cancels the rest of read-aheads that become obsolete (see CancelFetches)
+ *  - fetches a page out of order if a reader would wait long for a read-ahead to reach it (see TryFetchOutOfOrder)
+ *  - takes prefetch/evict/read-ahead hints from applications (see SetAdvice, Prefetch, EvictPages)
+ *  - serves cache hits without the file-wide pages mutex (see PageTable::findShared)
  *  - caches writes until flushed (write-back cache) (see FlushPage)
  *  - writes back consecutive ranges of pages to maximize throughput
+ *  - flushes in the background without the file lock (see StartFlush), shadowing in-flight pages on write
  *  - supports delayed file Create to combine Create+Write to Upload
  * THREAD SAFE (FORCES EXTERNAL LOCKS) (use parent File's lock)
  */
@@ -65,6 +80,9 @@ public:
     /** Returns the page size in use */
     [[nodiscard]] size_t GetPageSize() const { return mPageSize; }
 
+    /** Returns the backend the file's pages are transferred with */
+    [[nodiscard]] inline Backend::BackendImpl& GetBackend() const { return mBackend; }
+
     /** Returns the current file size including dirty writes */
     [[nodiscard]] uint64_t GetFileSize(const SharedLock& thisLock) const { return mFileSize; }
 
@@ -84,6 +102,15 @@ public:
      */
     ScopeLocked TryLockScope() { return ScopeLocked(*this, mScopeMutex); }
 
+    /** The cache class of a file that hasn't been assigned one (CacheManager uses the default class) */
+    static constexpr size_t NO_CACHE_CLASS { std::numeric_limits<size_t>::max() };
+
+    /** Sets the CacheManager class for pages cached from now on (see CacheManager::GetCacheClass) - THREAD SAFE */
+    inline void SetCacheClass(const size_t cacheClass) { mCacheClass.store(cacheClass); }
+
+    /** Returns the CacheManager class for pages cached from now on, or NO_CACHE_CLASS - THREAD SAFE */
+    [[nodiscard]] inline size_t GetCacheClass() const { return mCacheClass.load(); }
+
     /** 
      * Reads data from the given page index into buffer
      * @throws BackendException for backend issues
@@ -103,6 +130,38 @@ public:
      */
     void EvictPage(uint64_t index, const SharedLockW& thisLock);
 
+    /** 
+     * Removes any existing pages in the given range, writing them if dirty
+     * @throws BackendException for backend issues (only if dirty)
+     */
+    void EvictPages(uint64_t index, size_t count, const SharedLockW& thisLock);
+
+    /** 
+     * Starts fetching the given range of pages in the background, except any already cached or pending
+     * Limited to the same share of the cache as a read-ahead (see ConfigOptions::readMaxCacheFrac)
+     */
+    void Prefetch(uint64_t index, size_t count, const SharedLock& thisLock);
+
+    /** 
+     * Cancels the rest of any pending fetches at or after the given page index (e.g. closing or truncating)
+     * Fetches stop at their next page, readers waiting on a cancelled page fetch it again
+     * Does not need (or want) the file lock as running fetches hold it - THREAD SAFE
+     */
+    void CancelFetches(uint64_t index);
+
+    /** 
+     * Informs us that the CacheManager is about to evict the given page - if it was read ahead and not 
+     * yet used, the rest of its fetch would only be evicted too, so it is cancelled
+     * Does not need (or want) the file lock as running fetches hold it - THREAD SAFE
+     */
+    void InformEvicting(uint64_t index);
+
+    /** Returns the total bytes of fetches that were cancelled before being downloaded */
+    uint64_t GetCancelledBytes(const SharedLock& thisLock);
+
+    /** Applies application advice for how the file will be read (see File::Advice) */
+    void SetAdvice(File::Advice advice, const SharedLock& thisLock);
+
     /** 
      * Flushes the given page if dirty, creating the file on the backend if necessary
      * Will also flush any dirty pages sequentially after this one
@@ -117,6 +176,13 @@ public:
      */
     void FlushPages(const SharedLockW& thisLock);
 
+    /** 
+     * Waits for all background flushes to finish - does not need (or want) the file lock
+     * Like fsync(), a failure is reported once, by the first wait after it happened
+     * @throws BackendException if any failed since the last wait (their pages will be made dirty again)
+     */
+    void WaitFlush();
+
     /**
      * Informs us of the file changing on the backend
      * @param backendSize new size according to the backend
@@ -130,6 +196,12 @@ public:
      */
     void Truncate(uint64_t newSize, const SharedLockW& thisLock);
 
+    /** Drops any disk cached pages that no longer match the file on the backend (call after a refresh) */
+    void ValidateDiskCache(const SharedLockW& thisLock);
+
+    /** Returns a copy of the access pattern/read-ahead statistics for debugging */
+    AccessPattern::Stats GetAccessStats(const SharedLock& thisLock);
+
 private:
 
     using UniqueLock = std::unique_lock<std::mutex>;
@@ -144,19 +216,30 @@ private:
     /** 
      * Returns the page at the given index and marks dirty/informs cacheMgr - use GetWriteLock() first! 
      * @param pageSize the desired size of the page for writing
-     * @param partial if true, pre-populate the page with backend data
+     * @param partial if true, pre-populate the page with backend data, or 
+     *   create a partial page if the write can be flushed alone (see CanWritePartial)
      * @throws BackendException for backend issues
      * @throws CacheManager::MemoryException
      */
     Page& GetPageWrite(uint64_t index, size_t pageSize, bool partial, const SharedLockW& thisLock);
 
     /** 
-     * Calls mCacheMgr->InformPage() on the given page and removes it from mPages if it fails, does not wait for cache space
+     * Calls mCacheMgr->InformPage() on the given (hidden) page and removes it from mPages if it fails, else publishes it
      * @param canWait if true, maybe wait for cache space (never synchronously)
      * @throws CacheManager::MemoryException if canWait
      */
     void InformNewPageRead(uint64_t index, const Page& page, bool dirty, bool canWait, const UniqueLock& pagesLock);
 
+    /** Returns true if partial writes can skip reading the page (must exist on the backend and random write) */
+    bool CanWritePartial(const SharedLockW& thisLock) const;
+
+    /** 
+     * Fills in the bytes of a partial page (see Page::isPartial) from the backend
+     * The page is already in mPages, and is modified only in bytes that readers can't be using
+     * @throws BackendException for backend issues
+     */
+    void ResolvePartial(uint64_t index, const SharedLock& thisLock);
+
     /** 
      * Calls mCacheMgr->InformPage() on the given page and removes it from mPages if it fails
      * maybe waits for cache space synchronously, for immediate error-catching
@@ -180,50 +263,141 @@ private:
      */
     void ResizePage(Page& page, size_t pageSize, bool cacheMgr, const SharedLockW* thisLock = nullptr);
 
-    /** Returns true if the page at the given index is pending download */
+    /** 
+     * Records a cache hit's access and does any read-ahead, without ever blocking on mPagesMutex
+     * If the mutex is busy, the access is deferred to mDeferredHits for the next thread that gets it
+     */
+    void RecordHit(uint64_t index, const SharedLock& thisLock);
+
+    /** Records and does read-ahead for any accesses deferred by RecordHit() */
+    void ReplayDeferredHits(const SharedLock& thisLock, const UniqueLock& pagesLock);
+
+    /** Returns true if the page at the given index is pending download (O(log n)) */
     bool isFetchPending(uint64_t index, const UniqueLock& pagesLock);
 
-    /** Returns an exception_ptr if the page at the given index failed download else nullptr */
+    /** Returns an exception_ptr if the page at the given index failed download else nullptr (O(log n)) */
     std::exception_ptr isFetchFailed(uint64_t index, const UniqueLock& pagesLock);
 
+    /** Returns the read-ahead window (number of pages) for the given access from mFetchSize - THREAD SAFE */
+    size_t GetReadAheadSize(const AccessPattern::Access& access);
+
+    /** Returns the number of pages to fetch on first access - all of them if the file fits in mFetchSize, else 1 - THREAD SAFE */
+    size_t GetSmallFileSize(const SharedLock& thisLock);
+
+    /** 
+     * Returns the number of pages (up to maxCount) to fetch starting at the given VALID (mFileSize) index 
+     * Returns 0 if the page exists or the index does not exist on the backend (see mBackendSize)
+     */
+    size_t GetFetchSize(uint64_t index, size_t maxCount, const SharedLock& thisLock, const UniqueLock& pagesLock);
+
     /** 
-     * Returns the read-ahead size to be used for the given VALID (mFileSize) index 
+     * Returns the number of pages (up to maxCount) to fetch ending at (including) the given index
      * Returns 0 if the page exists or the index does not exist on the backend (see mBackendSize)
      */
-    size_t GetFetchSize(uint64_t index, const SharedLock& thisLock, const UniqueLock& pagesLock);
+    size_t GetFetchSizeReverse(uint64_t index, size_t maxCount, const SharedLock& thisLock, const UniqueLock& pagesLock);
 
-    /** Starts a fetch if necessary to prepopulate some pages ahead of the given index (options.readAheadBuffer) */
-    void DoAdvanceRead(uint64_t index, const SharedLock& thisLock, const UniqueLock& pagesLock);
+    /** 
+     * Starts a fetch if necessary to prepopulate some pages around the given index according to its access pattern
+     * Sequential streams read ahead if the next options.readAheadBuffer pages are not all present, reverse
+     * streams the same but backwards, strided streams fetch the next few strided pages, random does nothing
+     */
+    void DoAdvanceRead(uint64_t index, const AccessPattern::Access& access, const SharedLock& thisLock, const UniqueLock& pagesLock);
 
-    /** Spawns a thread to read some # of pages starting at the given VALID (mBackendSize) index */
-    void StartFetch(uint64_t index, size_t readCount, const UniqueLock& pagesLock);
+    /** 
+     * Submits a job to read some # of pages starting at the given VALID (mBackendSize) index 
+     * @param priority the runner priority for the fetch - FOREGROUND if a reader is waiting for it
+     * @param readAhead if true, the fetch follows the access pattern and is cancelled if it becomes stale
+     *   (see CancelStaleFetches) - false for explicit prefetches
+     */
+    void StartFetch(uint64_t index, size_t readCount, const UniqueLock& pagesLock, 
+        Backend::RunnerPool::Priority priority = Backend::RunnerPool::Priority::READAHEAD, bool readAhead = true);
 
     /** 
-     * Reads count# pages from the backend at the given index, adding to the page map
+     * Runs a fetch job for the given pending index on this thread if no worker has started it yet
+     * Guarantees progress for a waiting reader even if all thread pool workers are busy/blocked
+     * @return true if pagesLock was released (caller must re-check the page state)
+     */
+    bool TryRunFetch(uint64_t index, UniqueLock& pagesLock);
+
+    /** 
+     * Starts a priority fetch of just the given pending page if the running fetch it is part of is
+     * estimated to take much longer to get to it than a new request would (see OUT_OF_ORDER_FACTOR)
+     * The original fetch then skips the page when it gets there (see FetchPages)
+     * @return true if a fetch was started
+     */
+    bool TryFetchOutOfOrder(uint64_t index, const UniqueLock& pagesLock);
+
+    /** 
+     * Reads count# pages from the disk cache/backend at the given index, adding to the page map
      * Gets its own R thisLock and informs the cacheManager of all new pages
      * Sets mFailedPages[idx] to any BackendException
      */
     void FetchPages(uint64_t index, size_t count) noexcept;
 
+    /** Removes the given range of indexes from the pending-read set and notifies waiters */
+    void RemovePendingFetch(uint64_t index, size_t count, const UniqueLock& pagesLock);
+
     /** 
-     * Removes the given start index from the pending-read list and notifies waiters
-     * @param idxOnly if true, adjust the entry start index to be the next index, else remove it
+     * Marks the pending pages in the given range as cancelled - their fetch stops before them and
+     * removes them from the pending set (see FetchPages).  Only pending pages are marked.
      */
-    void RemovePendingFetch(uint64_t index, bool idxOnly, const UniqueLock& pagesLock);
+    void CancelFetches(uint64_t index, uint64_t count, const UniqueLock& pagesLock);
+
+    /** 
+     * Cancels the rest of any read-ahead fetches that no recent access stream is near anymore
+     * (the reader seeked elsewhere, see AccessPattern::HasRecentStream)
+     */
+    void CancelStaleFetches(const UniqueLock& pagesLock);
+
+    /** Returns the backend file info that disk cached pages must match */
+    DiskCache::FileInfo GetDiskInfo(const SharedLock& thisLock) const;
+
+    /** 
+     * Reads consecutive pages from the disk cache, stopping at the first that isn't cached
+     * @return the number of pages read and passed to pageHandler
+     */
+    size_t FetchDiskPages(uint64_t index, size_t count, const PageBackend::PageHandler& pageHandler, const SharedLock& thisLock);
+
+    /** Returns the number of consecutive pages (at least 1) starting at index that are not disk cached */
+    size_t GetDiskMissCount(uint64_t index, size_t count, const SharedLock& thisLock);
+
+    /** 
+     * Stores an evicted clean page in the disk cache on the thread pool so the W lock isn't held for the disk I/O
+     * (on this thread if MAX_DISK_STORES are already queued).  The page must already be removed from the CacheManager.
+     */
+    void StoreDiskPage(uint64_t index, Page&& page, const SharedLockW& thisLock);
+
+    /** Cancels or waits for a queued disk store of the given page so it can't store a stale copy after a write */
+    void WaitDiskStore(uint64_t index, const SharedLockW& thisLock);
+
+    /** Returns the maximum number of concurrent requests for one fetch (ConfigOptions fetchStreams) */
+    size_t GetMaxStreams() const;
+
+    /** Returns the number of concurrent requests to fetch count pages with, sized from mFetchSize - THREAD SAFE */
+    size_t GetFetchStreams(size_t count);
 
-    /** Updates mFetchSize with the given bandwidth measurement - THREAD SAFE */
+    /** Adds the given per-stream bandwidth measurement to the backend's estimator and updates mFetchSize - THREAD SAFE */
     void UpdateBandwidth(size_t bytes, const std::chrono::steady_clock::duration& time);
 
-    /** Map of page index to page */
-    using PageMap = std::map<uint64_t, Page>;
+    /** Updates mFetchSize from the backend's bandwidth estimator - THREAD SAFE */
+    void UpdateFetchSize();
+
+    /** The maximum number of evicted pages to have queued for storing in the disk cache (see StoreDiskPage) */
+    static constexpr size_t MAX_DISK_STORES { 16 };
+
+    /** Fetch a waited-for page directly if a running fetch needs this many times as long as a new request to get to it */
+    static constexpr double OUT_OF_ORDER_FACTOR { 2 };
+
+    /** Table of page index to page (with dirty bitmap) */
+    using PageMap = PageTable<Page>;
 
     /** 
      * Returns a series of **consecutive** dirty pages (total bytes < size_t)
-     * @param[in,out] pageIt reference to the iterator to start with - will end as the next index not used
-     * @param[out] writeList reference to a list of pages to fill out - guaranteed not empty if pageIt is dirty
+     * @param[in,out] index reference to the index to start searching from - will end as the next index not used
+     * @param[out] writeList reference to a list of pages to fill out - guaranteed not empty if any page at/after index is dirty
      * @return uint64_t the start index of the write list (not valid if writeList is empty!)
      */
-    uint64_t GetWriteList(PageMap::iterator& pageIt, PageBackend::PagePtrList& writeList, const SharedLockW& thisLock);
+    uint64_t GetWriteList(uint64_t& index, PageBackend::PagePtrList& writeList, const SharedLockW& thisLock);
 
     /** 
      * Writes a series of **consecutive** pages (total < size_t)
@@ -235,6 +409,39 @@ private:
      */
     size_t FlushPageList(uint64_t index, const PageBackend::PagePtrList& pages, const SharedLockW& thisLock);
 
+    /** Returns true if flushes can be done in the background (must exist on the backend and random write) */
+    bool CanFlushAsync(const SharedLockW& thisLock) const;
+
+    /** 
+     * Marks a series of **consecutive** dirty pages clean and queues them to be written in the background
+     * The pages must not be changed or removed until written - see ShadowFlushPage() and FinishFlushes()
+     */
+    void StartFlush(uint64_t index, const PageBackend::PagePtrList& pages, const SharedLockW& thisLock);
+
+    /** Runs queued flush jobs in order until there are none left (on the thread pool) */
+    void RunFlushJobs() noexcept;
+
+    /** Waits until all flush jobs are done, running the flush task on this thread if not started */
+    void WaitFlushJobs(UniqueLock& flushLock);
+
+    /** Writes failed flush jobs again before their pages are dropped, logging if that fails too (destructor only) */
+    void RetryFailedFlushes() noexcept;
+
+    /** 
+     * Removes finished flush jobs, updating the backend size, or marking the pages dirty again on failure
+     * @param wait if true, wait for all flush jobs to be finished first
+     */
+    void FinishFlushes(bool wait, const SharedLockW& thisLock);
+
+    /** Returns true if the given page index is part of a flush job that is not finished */
+    bool isFlushing(uint64_t index, const UniqueLock& flushLock) const;
+
+    /** 
+     * Call before changing a page that may be in-flight - moves the original data to the
+     * flush job and gives the page a copy (shadow) that is then safe to change
+     */
+    void ShadowFlushPage(uint64_t index, Page& page, const SharedLockW& thisLock);
+
     /** 
      * Does FlushCreate() in case the file doesn't exist on the backend, then maybe truncates
      *    the file on the backend in case we did a truncate before it existed
@@ -250,47 +457,106 @@ private:
     Backend::BackendImpl& mBackend;
     /** Pointer to the cache manager to use */
     CacheManager* mCacheMgr { nullptr };
+    /** Pointer to the disk cache to use (null if not CacheType::DISK) */
+    DiskCache* mDiskCache { nullptr };
+    /** The CacheManager class for new pages (see CacheOptions::cacheClasses) */
+    std::atomic<size_t> mCacheClass { NO_CACHE_CLASS };
+    /** True if pages are demoted in the cache once read (see File::Advice::NOCACHE) */
+    std::atomic<bool> mNoCache { false };
     /** The size of each page - see description in ConfigOptions */
     const size_t mPageSize;
     /** The current size of the file including dirty extending writes */
     uint64_t mFileSize;
 
-    /** The current read-ahead window (number of pages) (dynamic) - NEVER zero */
+    /** The current read-ahead window (number of pages) for one stream (dynamic) - NEVER zero */
     size_t mFetchSize { 1 };
-    /** Mutex that protects mFetchSize and mBandwidthHistory */
+    /** Mutex that protects mFetchSize */
     std::mutex mFetchSizeMutex;
 
-    /** List of <index,count> pending reads */
-    using PendingMap = std::list<std::pair<uint64_t, size_t>>;
-    /** 
-     * Map of page index to exception thrown when reading 
-     * This is simpler but less efficient than storing a map of FetchPairs,
-     * but performance is not critical for the rare failure case
-     */
-    using FailureMap = std::map<uint64_t, std::exception_ptr>;
+    /** Set of page index ranges pending reads (coalesced) */
+    using PendingMap = RangeSet<uint64_t>;
+    /** Map of page index ranges to the exception thrown when reading */
+    using FailureMap = RangeMap<uint64_t, std::exception_ptr>;
 
-    /** The index based map of pages */
+    /** The index based table of pages - Page addresses are stable until erased */
     PageMap mPages;
     /** Unique set of page ranges being downloaded */
     PendingMap mPendingPages;
     /** Map of failures encountered while downloading pages */
     FailureMap mFailedPages;
+    /** Set of pending pages whose fetch should stop before them (always a subset of mPendingPages) */
+    PendingMap mCancelledPages;
+    /** The total bytes of fetches that were cancelled before being downloaded */
+    uint64_t mCancelledBytes { 0 };
     /** Condition variable for waiting for pages */
     std::condition_variable mPagesCV;
 
-    /** Lock for fetch threads to acquire (so destructor can wait) */
-    std::shared_mutex mFetchMutex;
+    /** A submitted fetch job and the range of pages it was started with */
+    struct FetchTask
+    {
+        /** The first page index of the fetch */
+        uint64_t mIndex;
+        /** The number of pages in the fetch */
+        size_t mCount;
+        /** True if the fetch is read-ahead and can be cancelled if stale (see StartFetch) */
+        bool mReadAhead;
+        /** Handle to the thread pool job */
+        ThreadPool::TaskPtr mTask;
+    };
+    /** List of fetch jobs that may not be done yet (so the destructor can wait) */
+    std::list<FetchTask> mFetchTasks;
+
+    /** A run of consecutive pages being written back in the background */
+    struct FlushJob
+    {
+        /** The first page index of the run */
+        uint64_t mIndex { 0 };
+        /** The pages being written - an entry is pointed at mRetired if the page changes first */
+        PageBackend::PagePtrList mPages;
+        /** Original pages that were replaced by a shadow copy while in flight */
+        std::list<Page> mRetired;
+        /** True once the write has started */
+        bool mStarted { false };
+        /** True once the write has finished */
+        bool mDone { false };
+        /** The byte ranges to write, from when the pages were marked clean */
+        PageBackend::ExtentList mExtents;
+        /** The exception from writing if it failed */
+        std::exception_ptr mError;
+    };
+    /** Queue of flush jobs in order (only added/removed with the W lock) */
+    std::list<FlushJob> mFlushJobs;
+    /** The task running RunFlushJobs() or nullptr if none */
+    ThreadPool::TaskPtr mFlushTask;
+    /** The first flush job failure not yet reported by WaitFlush() */
+    std::exception_ptr mFlushFailure;
+    /** Mutex that protects the flush jobs and their page lists */
+    std::mutex mFlushMutex;
+    /** Condition variable signaled when a flush job finishes */
+    std::condition_variable mFlushCV;
 
     /** List of pages we didn't evict due to requiring sequential writing */
     std::list<uint64_t> mDeferredEvicts;
 
+    /** Map of page index to its queued disk cache store (only used with the W lock) */
+    std::unordered_map<uint64_t, ThreadPool::TaskPtr> mDiskStores;
+
     /** Shared mutex that is grabbed exclusively when this class is destructed */
     std::shared_mutex mScopeMutex;
-    /** Mutex that protects the page maps between concurrent readers (not needed for writers) */
+    /** Mutex that protects the page maps between concurrent readers (not needed for writers or lock-free hits) */
     std::mutex mPagesMutex;
-
-    /** Bandwidth measurement tool for mFetchSize */
-    BandwidthMeasure mBandwidth;
+    /** Mutex that serializes ResolvePartial() between concurrent readers */
+    std::mutex mResolveMutex;
+
+    /** Ring of hit indexes (or PageMap::NONE) not yet given to mAccessPattern - overwritten if full */
+    std::array<std::atomic<uint64_t>, 64> mDeferredHits;
+    /** The next mDeferredHits slot to use (modulo its size) */
+    std::atomic<size_t> mDeferredNext { 0 };
+    /** True if mDeferredHits may have entries */
+    std::atomic<bool> mHasDeferredHits { false };
+
+    /** Read access stream detector for read-ahead (protected by mPagesMutex or W lock) */
+    AccessPattern mAccessPattern;
     /** Page to/from backend interface */
     PageBackend& mPageBackend;
 };
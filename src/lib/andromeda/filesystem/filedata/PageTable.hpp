@@ -0,0 +1,518 @@
+
+#ifndef LIBA2_PAGETABLE_H_
+#define LIBA2_PAGETABLE_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "andromeda/common.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/**
+ * A sparse radix tree of page index to T, with a dirty bitmap alongside
+ * Each level resolves 6 index bits, so lookups walk only as many levels as the highest index
+ * needs (two for the first 4096 pages), and present/dirty scans skip 64 pages per word and empty subtrees.
+ * Only the nodes and leaves along used paths are allocated, and leaves hold pointers to values
+ * allocated individually - so a file with few cached pages (or one far into a sparse file) stays small,
+ * and addresses are stable until erased.  The table's own memory is counted, see memory().
+ *
+ * Lookups of published values via findShared() are lock-free and may run concurrently with one
+ * (externally serialized) inserter - slots and published bits are atomic, and the tree only grows
+ * by adding a new root above the old one.  Erasing a published value frees its value and any
+ * emptied leaf/nodes and so requires that no findShared() can be running (exclusive lock).
+ * NOT THREAD SAFE (protect externally) except for findShared() as above
+ */
+template<typename T>
+class PageTable
+{
+private:
+
+    /** Number of index bits per tree level */
+    static constexpr size_t BITS { 6 };
+    /** Number of slots per node or leaf (one bitmap word) */
+    static constexpr size_t FANOUT { static_cast<size_t>(1) << BITS };
+    /** Mask of the index bits within a leaf */
+    static constexpr uint64_t MASK { FANOUT-1 };
+    /** The maximum number of node levels above the leaves */
+    static constexpr size_t MAX_DEPTH { (64+BITS-1)/BITS };
+    /** A bitmap word with all bits set */
+    static constexpr uint64_t ALL { ~static_cast<uint64_t>(0) };
+
+    /** A block of value pointers and their bitmaps */
+    struct Leaf
+    {
+        /** Values allocated individually, non-null where present */
+        std::array<T*, FANOUT> values { };
+        /** Bitmap of present values */
+        uint64_t present { 0 };
+        /** Bitmap of values marked dirty */
+        uint64_t dirty { 0 };
+        /** Bitmap of present values visible to findShared() */
+        std::atomic<uint64_t> published { 0 };
+    };
+
+    /** An interior node, its children are leaves if shift == BITS else nodes */
+    struct Node
+    {
+        explicit Node(const size_t nodeShift) : shift(nodeShift) { }
+        /** The position of the index bits that select a slot */
+        const size_t shift;
+        /** Bitmap of non-null slots */
+        uint64_t used { 0 };
+        /** Child leaves or nodes, owned by the table */
+        std::array<std::atomic<void*>, FANOUT> slots { };
+    };
+
+    /** The nodes walked to reach a leaf and the slot taken in each, root first */
+    struct Path
+    {
+        std::array<std::pair<Node*, size_t>, MAX_DEPTH> nodes { };
+        size_t depth { 0 };
+    };
+
+public:
+
+    /** Returned by index scans when nothing is found */
+    static constexpr uint64_t NONE { std::numeric_limits<uint64_t>::max() };
+
+    /** @param memoryTotal if not null, a shared total to also add the table's memory() to */
+    explicit PageTable(std::atomic<size_t>* memoryTotal = nullptr) : mMemoryTotal(memoryTotal) { }
+    virtual ~PageTable() { clear(); }
+    DELETE_COPY(PageTable)
+    DELETE_MOVE(PageTable)
+
+    /** Returns the number of values present */
+    [[nodiscard]] size_t size() const { return mSize; }
+    /** Returns true if no values are present */
+    [[nodiscard]] bool empty() const { return !mSize; }
+
+    /** Returns the bytes allocated by the table itself (nodes, leaves and value objects, not what they own) */
+    [[nodiscard]] size_t memory() const { return mMemory; }
+
+    /** Returns a pointer to the value at index, or nullptr if not present */
+    [[nodiscard]] T* find(const uint64_t index)
+    {
+        Leaf* leaf { GetLeaf(index) };
+        return (leaf != nullptr) ? leaf->values[GetOffset(index)] : nullptr;
+    }
+
+    /** Returns a pointer to the value at index, or nullptr if not present */
+    [[nodiscard]] const T* find(const uint64_t index) const
+    {
+        const Leaf* leaf { GetLeaf(index) };
+        return (leaf != nullptr) ? leaf->values[GetOffset(index)] : nullptr;
+    }
+
+    /** Returns true if a value is present at index */
+    [[nodiscard]] bool contains(const uint64_t index) const { return find(index) != nullptr; }
+
+    /** 
+     * Returns the value at index, e.g. one found with next() or nextDirty()
+     * @throws std::out_of_range if not present
+     */
+    [[nodiscard]] T& at(const uint64_t index)
+    {
+        T* const value { find(index) };
+        if (value == nullptr) throw std::out_of_range("PageTable::at");
+        return *value;
+    }
+
+    /** 
+     * Returns the value at index, e.g. one found with next() or nextDirty()
+     * @throws std::out_of_range if not present
+     */
+    [[nodiscard]] const T& at(const uint64_t index) const
+    {
+        const T* const value { find(index) };
+        if (value == nullptr) throw std::out_of_range("PageTable::at");
+        return *value;
+    }
+
+    /**
+     * Returns a pointer to the published value at index, or nullptr if not present/published
+     * THREAD SAFE against a concurrent inserter (but not against erasing published values)
+     */
+    [[nodiscard]] const T* findShared(const uint64_t index) const
+    {
+        const Node* node { mRoot.load(std::memory_order_acquire) };
+        if (node == nullptr || !Covers(*node, index)) return nullptr;
+
+        for (const void* child; (child = node->slots[GetSlot(*node, index)].load(std::memory_order_acquire)) != nullptr; )
+        {
+            if (node->shift != BITS) { node = static_cast<const Node*>(child); continue; }
+
+            const Leaf* const leaf { static_cast<const Leaf*>(child) };
+            const size_t offset { GetOffset(index) };
+            if (!((leaf->published.load(std::memory_order_acquire) >> offset) & 1)) return nullptr;
+            return leaf->values[offset]; // set before the bit was published
+        }
+        return nullptr;
+    }
+
+    /**
+     * Constructs and publishes a value at index from args if not already present
+     * @return pair of the value at index and true if it was inserted
+     */
+    template<typename... Args>
+    std::pair<T*, bool> try_emplace(const uint64_t index, Args&&... args) {
+        return Emplace(index, true, std::forward<Args>(args)...); }
+
+    /**
+     * Constructs a value at index from args if not already present, but does not publish it
+     * The value is visible to find() but not findShared() until publish() - it can also be
+     * erased while findShared() is running, as erasing a hidden value never frees its leaf
+     * @return pair of the value at index and true if it was inserted
+     */
+    template<typename... Args>
+    std::pair<T*, bool> emplaceHidden(const uint64_t index, Args&&... args) {
+        return Emplace(index, false, std::forward<Args>(args)...); }
+
+    /** Makes the present value at index visible to findShared() */
+    void publish(const uint64_t index)
+    {
+        Leaf* const leaf { GetLeaf(index) };
+        const size_t offset { GetOffset(index) };
+        if (leaf != nullptr && GetBit(leaf->present, offset))
+            leaf->published.fetch_or(GetMask(offset), std::memory_order_release);
+    }
+
+    /**
+     * Removes the value at index (and its dirty bit), returning true if it was present
+     * Frees the leaf and any emptied nodes if now empty, unless the value was hidden (see emplaceHidden())
+     */
+    bool erase(const uint64_t index)
+    {
+        Path path;
+        Leaf* const leaf { GetLeaf(index, &path) };
+        if (leaf == nullptr) return false;
+
+        const size_t offset { GetOffset(index) };
+        if (!GetBit(leaf->present, offset)) return false;
+
+        const uint64_t mask { GetMask(offset) };
+        const bool published { (leaf->published.fetch_and(~mask, std::memory_order_release) & mask) != 0 };
+
+        Free(leaf->values[offset]);
+        leaf->values[offset] = nullptr;
+        leaf->present &= ~mask;
+        leaf->dirty &= ~mask;
+        --mSize;
+
+        if (!leaf->present && published) // free empty leaves and the nodes above them
+        {
+            Free(leaf);
+            for (size_t level { path.depth }; level--; )
+            {
+                Node* const node { path.nodes[level].first };
+                const size_t slot { path.nodes[level].second };
+                node->slots[slot].store(nullptr, std::memory_order_release);
+                node->used &= ~GetMask(slot);
+                if (node->used) break;
+
+                if (!level) mRoot.store(nullptr, std::memory_order_release);
+                Free(node);
+            }
+        }
+        return true;
+    }
+
+    /** Removes all values and frees the tree (requires no concurrent findShared()) */
+    void clear()
+    {
+        Node* const root { mRoot.load(std::memory_order_relaxed) };
+        mRoot.store(nullptr, std::memory_order_release);
+        if (root != nullptr) FreeNode(root);
+        mSize = 0;
+    }
+
+    /** Sets or clears the dirty bit for the present value at index */
+    void setDirty(const uint64_t index, const bool dirty = true)
+    {
+        Leaf* const leaf { GetLeaf(index) };
+        const uint64_t mask { GetMask(GetOffset(index)) };
+        if (leaf == nullptr || !(leaf->present & mask)) return;
+        if (dirty) leaf->dirty |= mask; else leaf->dirty &= ~mask;
+    }
+
+    /** Returns true if the value at index is present and marked dirty */
+    [[nodiscard]] bool isDirty(const uint64_t index) const
+    {
+        const Leaf* leaf { GetLeaf(index) };
+        return leaf != nullptr && GetBit(leaf->dirty, GetOffset(index));
+    }
+
+    /** Returns the first present index >= index, or NONE */
+    [[nodiscard]] uint64_t next(const uint64_t index) const { return Next(index, &Leaf::present); }
+
+    /** Returns the first dirty index >= index, or NONE */
+    [[nodiscard]] uint64_t nextDirty(const uint64_t index) const { return Next(index, &Leaf::dirty); }
+
+    /** Returns the last present index < index, or NONE */
+    [[nodiscard]] uint64_t prev(const uint64_t index) const
+    {
+        const Node* const root { mRoot.load(std::memory_order_relaxed) };
+        if (!index || root == nullptr) return NONE;
+
+        const uint64_t last { index-1 }; // candidate
+        return PrevIn(*root, Covers(*root, last) ? last : // else start at the end
+            (static_cast<uint64_t>(1) << (root->shift+BITS))-1);
+    }
+
+    /** Calls func(index, T&) for every present value in index order (func must not insert/erase) */
+    template<typename Func>
+    void forEach(Func&& func)
+    {
+        for (uint64_t index { next(0) }; index != NONE; index = next(index+1))
+            func(index, at(index));
+    }
+
+    /** Calls func(index, const T&) for every present value in index order */
+    template<typename Func>
+    void forEach(Func&& func) const
+    {
+        for (uint64_t index { next(0) }; index != NONE; index = next(index+1))
+            func(index, at(index));
+    }
+
+private:
+
+    /** Returns the offset of index within its leaf */
+    static size_t GetOffset(const uint64_t index) { return static_cast<size_t>(index & MASK); }
+
+    /** Returns the slot of index within the given node */
+    static size_t GetSlot(const Node& node, const uint64_t index) {
+        return static_cast<size_t>((index >> node.shift) & MASK); }
+
+    /** Returns true if index is within the range of the given (root) node */
+    static bool Covers(const Node& node, const uint64_t index) {
+        return node.shift+BITS >= 64 || !(index >> (node.shift+BITS)); }
+
+    /** Returns the first index of the given node slot, within the node that index is in */
+    static uint64_t GetSlotStart(const Node& node, const uint64_t index, const size_t slot)
+    {
+        const size_t nodeBits { node.shift+BITS };
+        const uint64_t nodeStart { (nodeBits >= 64) ? 0 : (index >> nodeBits) << nodeBits };
+        return nodeStart | (static_cast<uint64_t>(slot) << node.shift);
+    }
+
+    /** Returns the mask for the given bit within a bitmap word */
+    static uint64_t GetMask(const size_t bit) { return static_cast<uint64_t>(1) << bit; }
+
+    static bool GetBit(const uint64_t bits, const size_t bit) { return (bits >> bit) & 1; }
+
+    /** Returns the position of the lowest set bit (word must not be 0) */
+    static size_t LowBit(const uint64_t word)
+    {
+    #if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_ctzll(word));
+    #else
+        size_t bit { 0 }; while (!((word >> bit) & 1)) ++bit; return bit;
+    #endif
+    }
+
+    /** Returns the position of the highest set bit (word must not be 0) */
+    static size_t HighBit(const uint64_t word)
+    {
+    #if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(63 - __builtin_clzll(word));
+    #else
+        size_t bit { 63 }; while (!((word >> bit) & 1)) --bit; return bit;
+    #endif
+    }
+
+    /** Adds to the table's memory and the shared total */
+    void AddMemory(const size_t bytes)
+    {
+        mMemory += bytes;
+        if (mMemoryTotal != nullptr) mMemoryTotal->fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /** Subtracts from the table's memory and the shared total */
+    void SubMemory(const size_t bytes)
+    {
+        mMemory -= bytes;
+        if (mMemoryTotal != nullptr) mMemoryTotal->fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    /** Allocates a new U from args, counting its memory */
+    template<typename U, typename... Args>
+    U* Allocate(Args&&... args)
+    {
+        U* const ptr { new U(std::forward<Args>(args)...) }; // NOLINT(cppcoreguidelines-owning-memory)
+        AddMemory(sizeof(U)); return ptr;
+    }
+
+    /** Deletes a U from Allocate() */
+    template<typename U>
+    void Free(U* const ptr)
+    {
+        delete ptr; // NOLINT(cppcoreguidelines-owning-memory)
+        SubMemory(sizeof(U));
+    }
+
+    /** Frees the given node and everything below it */
+    void FreeNode(Node* const node)
+    {
+        for (uint64_t used { node->used }; used; used &= used-1)
+        {
+            void* const child { node->slots[LowBit(used)].load(std::memory_order_relaxed) };
+            if (node->shift != BITS) { FreeNode(static_cast<Node*>(child)); continue; }
+
+            Leaf* const leaf { static_cast<Leaf*>(child) };
+            for (uint64_t present { leaf->present }; present; present &= present-1)
+                Free(leaf->values[LowBit(present)]);
+            Free(leaf);
+        }
+        Free(node);
+    }
+
+    /** Returns the leaf for the given index or nullptr if none, filling path if not null */
+    Leaf* GetLeaf(const uint64_t index, Path* const path = nullptr) const
+    {
+        Node* node { mRoot.load(std::memory_order_relaxed) };
+        if (node == nullptr || !Covers(*node, index)) return nullptr;
+
+        for (size_t depth { 0 }; ; ++depth)
+        {
+            const size_t slot { GetSlot(*node, index) };
+            if (path != nullptr) { path->nodes[depth] = { node, slot }; path->depth = depth+1; }
+
+            void* const child { node->slots[slot].load(std::memory_order_relaxed) };
+            if (child == nullptr) return nullptr;
+            if (node->shift == BITS) return static_cast<Leaf*>(child);
+            node = static_cast<Node*>(child);
+        }
+    }
+
+    /** Returns the leaf for the given index, adding a new root/nodes/leaf if needed */
+    Leaf& AddLeaf(const uint64_t index)
+    {
+        Node* node { mRoot.load(std::memory_order_relaxed) };
+        if (node == nullptr) // start at the height index needs
+        {
+            size_t shift { BITS };
+            while (shift+BITS < 64 && (index >> (shift+BITS))) shift += BITS;
+            node = Allocate<Node>(shift);
+            mRoot.store(node, std::memory_order_release);
+        }
+
+        while (!Covers(*node, index)) // grow upward - findShared() may still be using the old root
+        {
+            Node* const root { Allocate<Node>(node->shift+BITS) };
+            root->slots[0].store(node, std::memory_order_relaxed);
+            root->used = 1;
+            mRoot.store(root, std::memory_order_release);
+            node = root;
+        }
+
+        while (true)
+        {
+            const size_t slot { GetSlot(*node, index) };
+            std::atomic<void*>& slotRef { node->slots[slot] };
+            void* child { slotRef.load(std::memory_order_relaxed) };
+            if (child == nullptr)
+            {
+                if (node->shift == BITS) child = Allocate<Leaf>();
+                else child = Allocate<Node>(node->shift-BITS);
+                slotRef.store(child, std::memory_order_release);
+                node->used |= GetMask(slot);
+            }
+
+            if (node->shift == BITS) return *static_cast<Leaf*>(child);
+            node = static_cast<Node*>(child);
+        }
+    }
+
+    /** Constructs a value at index if not present, maybe publishing it */
+    template<typename... Args>
+    std::pair<T*, bool> Emplace(const uint64_t index, const bool publish, Args&&... args)
+    {
+        if (T* const existing { find(index) }) return { existing, false };
+
+        std::unique_ptr<T> value { std::make_unique<T>(std::forward<Args>(args)...) };
+        Leaf& leaf { AddLeaf(index) };
+
+        const size_t offset { GetOffset(index) };
+        T* const valuePtr { value.release() };
+        leaf.values[offset] = valuePtr; AddMemory(sizeof(T));
+        leaf.present |= GetMask(offset);
+        if (publish) leaf.published.fetch_or(GetMask(offset), std::memory_order_release);
+        ++mSize;
+        return { valuePtr, true };
+    }
+
+    /** Returns the first index >= index with a bit set in the given leaf bitmap, or NONE */
+    uint64_t Next(const uint64_t index, uint64_t Leaf::* bitmap) const
+    {
+        const Node* const root { mRoot.load(std::memory_order_relaxed) };
+        return (root != nullptr && Covers(*root, index)) ? NextIn(*root, index, bitmap) : NONE;
+    }
+
+    /** Returns the first index >= index (which must be within node) with a bit set, or NONE */
+    static uint64_t NextIn(const Node& node, const uint64_t index, uint64_t Leaf::* bitmap)
+    {
+        for (uint64_t used { node.used & (ALL << GetSlot(node, index)) }; used; used &= used-1)
+        {
+            const size_t slot { LowBit(used) };
+            const uint64_t from { std::max(index, GetSlotStart(node, index, slot)) };
+            const void* const child { node.slots[slot].load(std::memory_order_relaxed) };
+            if (node.shift != BITS)
+            {
+                const uint64_t found { NextIn(*static_cast<const Node*>(child), from, bitmap) };
+                if (found != NONE) return found;
+                continue;
+            }
+
+            const uint64_t masked { static_cast<const Leaf*>(child)->*bitmap & (ALL << GetOffset(from)) };
+            if (masked) return (from & ~MASK) + LowBit(masked);
+        }
+        return NONE;
+    }
+
+    /** Returns the last present index <= last (which must be within node), or NONE */
+    static uint64_t PrevIn(const Node& node, const uint64_t last)
+    {
+        const size_t lastSlot { GetSlot(node, last) };
+        for (uint64_t used { node.used & (ALL >> (63-lastSlot)) }; used; used &= ~GetMask(HighBit(used)))
+        {
+            const size_t slot { HighBit(used) };
+            const uint64_t start { GetSlotStart(node, last, slot) };
+            const uint64_t to { (slot == lastSlot) ? last : start + ((static_cast<uint64_t>(1) << node.shift)-1) };
+            const void* const child { node.slots[slot].load(std::memory_order_relaxed) };
+            if (node.shift != BITS)
+            {
+                const uint64_t found { PrevIn(*static_cast<const Node*>(child), to) };
+                if (found != NONE) return found;
+                continue;
+            }
+
+            const uint64_t masked { static_cast<const Leaf*>(child)->present & (ALL >> (63-GetOffset(to))) };
+            if (masked) return start + HighBit(masked);
+        }
+        return NONE;
+    }
+
+    /** The root of the tree or nullptr if none (read lock-free by findShared()) */
+    std::atomic<Node*> mRoot { nullptr };
+    /** The total number of values present */
+    size_t mSize { 0 };
+    /** The bytes allocated by the table, see memory() */
+    size_t mMemory { 0 };
+    /** A shared total to also add mMemory to (or nullptr) */
+    std::atomic<size_t>* const mMemoryTotal;
+};
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
+
+#endif // LIBA2_PAGETABLE_H_
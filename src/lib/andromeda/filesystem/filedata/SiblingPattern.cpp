@@ -0,0 +1,29 @@
+
+#include "SiblingPattern.hpp"
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/*****************************************************/
+bool SiblingPattern::RecordOpen(const std::string& name)
+{
+    // files are usually opened in readdir order, which is the folder's item order
+    if (!mLastOpened.empty() && name > mLastOpened) ++mOpenRun;
+    else { mOpenRun = 1; mPrefetchedTo.clear(); }
+    mLastOpened = name;
+
+    return mOpenRun >= OPEN_RUN;
+}
+
+/*****************************************************/
+bool SiblingPattern::StartPrefetch(const std::string& name)
+{
+    if (name <= mPrefetchedTo) return false; // already started
+    mPrefetchedTo = name;
+    return true;
+}
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
@@ -0,0 +1,53 @@
+
+#ifndef LIBA2_SIBLINGPATTERN_H_
+#define LIBA2_SIBLINGPATTERN_H_
+
+#include <string>
+
+namespace Andromeda {
+namespace Filesystem {
+namespace Filedata {
+
+/**
+ * Detects the files of one folder being opened in item (readdir) order, e.g. by cp -r, tar or grep -r,
+ * and tracks which of the following siblings have already been given a prefetch
+ * NOT THREAD SAFE (protect externally)
+ */
+class SiblingPattern
+{
+public:
+
+    /** The number of files opened in item order before prefetching the next ones */
+    static constexpr size_t OPEN_RUN { 3 };
+
+    /**
+     * Records that the given child file was opened
+     * An open out of item order starts a new run and forgets what was prefetched
+     * @return true if opens are in item order and the siblings after name should be prefetched
+     */
+    bool RecordOpen(const std::string& name);
+
+    /**
+     * Returns true if the given sibling (after the last opened, in item order) needs a prefetch started,
+     * and remembers it and everything before it as started
+     */
+    bool StartPrefetch(const std::string& name);
+
+    /** Returns the number of files opened in a row in item order */
+    inline size_t GetOpenRun() const { return mOpenRun; }
+
+private:
+
+    /** The name of the last child file opened */
+    std::string mLastOpened;
+    /** The number of files opened in a row in item order */
+    size_t mOpenRun { 0 };
+    /** The name of the last sibling file prefetched (don't prefetch up to it again) */
+    std::string mPrefetchedTo;
+};
+
+} // namespace Filedata
+} // namespace Filesystem
+} // namespace Andromeda
+
+#endif // LIBA2_SIBLINGPATTERN_H_